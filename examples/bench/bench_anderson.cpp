@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "pogs.h"
+#include "problems.h"
+#include "timer.h"
+
+using namespace pogs;
+
+// Compares plain ADMM to Anderson accelerated ADMM (type-I and type-II, with
+// several memory depths) in terms of iterations and wall-clock time.
+template <typename T>
+void BenchAnderson(const Problem<T> &p, AndersonType type, unsigned int mem) {
+  pogs::MatrixDense<T> A_('r', p.m, p.n, p.A.data());
+  pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_);
+  pogs_data.SetVerbose(0);
+  pogs_data.SetAndersonMem(mem);
+  pogs_data.SetAndersonType(type);
+
+  double t = timer<double>();
+  PogsStatus status = pogs_data.Solve(p.f, p.g);
+  t = timer<double>() - t;
+
+  printf("%-10s %-6s %4u %6u %10.3e %12.5e %s\n", p.name.c_str(),
+      mem == 0 ? "-" : (type == ANDERSON_TYPE_I ? "I" : "II"), mem,
+      pogs_data.GetFinalIter(), t, pogs_data.GetOptval(),
+      PogsStatusString(status).c_str());
+}
+
+int main() {
+  typedef double real_t;
+  const unsigned int kMem[] = { 3, 5, 10 };
+
+  printf("%-10s %-6s %4s %6s %10s %12s %s\n", "Problem", "Type", "Mem",
+      "Iter", "Time (s)", "Optval", "Status");
+  std::vector<Problem<real_t> > problems = AllProblems<real_t>();
+  for (size_t i = 0; i < problems.size(); ++i) {
+    BenchAnderson(problems[i], ANDERSON_TYPE_II, 0);
+    for (unsigned int j = 0; j < sizeof(kMem) / sizeof(kMem[0]); ++j) {
+      BenchAnderson(problems[i], ANDERSON_TYPE_I, kMem[j]);
+      BenchAnderson(problems[i], ANDERSON_TYPE_II, kMem[j]);
+    }
+  }
+
+  return 0;
+}
+
@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "matrix/matrix_dense_stream.h"
+#include "matrix/matrix_file.h"
+#include "matrix/matrix_sparse.h"
+#include "pogs.h"
+#include "problems.h"
+#include "timer.h"
+
+using namespace pogs;
+
+const char kPath[] = "bench_ata.pogsmat";
+
+// Two products by A and A^T, as MulAtA did before it was fused.
+template <typename T>
+class TwoPass : public Matrix<T> {
+ private:
+  const Matrix<T> &_A;
+
+ public:
+  explicit TwoPass(const Matrix<T> &A)
+      : Matrix<T>(A.Rows(), A.Cols()), _A(A) {
+    this->_done_init = true;
+  }
+  int Init() { return 0; }
+  int Equil(T *d, T *e) { return 0; }
+  int Mul(char trans, T alpha, const T *x, T beta, T *y) const {
+    return _A.Mul(trans, alpha, x, beta, y);
+  }
+};
+
+// Prints the time of y := A * x, z := A^T * y with two calls to Mul and with
+// MulAtA, for the initialized and equilibrated matrix A.
+template <typename T>
+void BenchAtA(const char *name, const Matrix<T> &A) {
+  std::vector<T> x(A.Cols(), static_cast<T>(1)), y(A.Rows()), z(A.Cols());
+  TwoPass<T> A_two(A);
+  const Matrix<T> *ops[] = { &A_two, &A };
+  double t_ops[2];
+  const unsigned int kReps = 20;
+  for (unsigned int k = 0; k < 2; ++k) {
+    double t = 0;
+    for (unsigned int r = 0; r <= kReps; ++r) {
+      // The first product touches the buffers and is not timed.
+      if (r == 1)
+        t = timer<double>();
+      ops[k]->MulAtA(static_cast<T>(1), x.data(), y.data(), static_cast<T>(0),
+          z.data());
+    }
+    t_ops[k] = (timer<double>() - t) / kReps;
+  }
+  printf("%-14s %10.3e %10.3e %7.2f\n", name, t_ops[0], t_ops[1],
+      t_ops[0] / t_ops[1]);
+}
+
+// Solves the problem p with CGLS and prints the iterations, the optimal
+// value and the total time.
+template <typename T, typename M>
+void Solve(const char *name, const Problem<T> &p, const M &A) {
+  PogsIndirect<T, M> pogs_data(A);
+  pogs_data.SetVerbose(0);
+  double t = timer<double>();
+  pogs_data.Solve(p.f, p.g);
+  t = timer<double>() - t;
+  printf("%-14s %6u %13.6e %10.3e\n", name, pogs_data.GetFinalIter(),
+      static_cast<double>(pogs_data.GetOptval()), t);
+}
+
+int main() {
+  typedef double real_t;
+  const size_t m = 20000, n = 1000;
+  Problem<real_t> p = Lasso<real_t>(m, n);
+
+  // Sparse copy of A with about 10% of its entries.
+  std::vector<real_t> val;
+  std::vector<POGS_INT> ind, ptr(1, 0);
+  for (size_t i = 0; i < m; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      if (rand() % 10 == 0) {
+        val.push_back(p.A[i * n + j]);
+        ind.push_back(static_cast<POGS_INT>(j));
+      }
+    }
+    ptr.push_back(static_cast<POGS_INT>(val.size()));
+  }
+
+  std::vector<real_t> d(m), e(n);
+  MatrixDense<real_t> A_dense('r', m, n, p.A.data());
+  A_dense.Init();
+  A_dense.Equil(d.data(), e.data());
+  MatrixSparse<real_t> A_sparse('r', m, n, static_cast<POGS_INT>(val.size()),
+      val.data(), ptr.data(), ind.data());
+  A_sparse.Init();
+  A_sparse.Equil(d.data(), e.data());
+  {
+    MatrixDense<real_t> A('r', m, n, p.A.data());
+    A.Init();
+    WriteMatrixFile(kPath, A);
+  }
+  MatrixDenseStream<real_t> A_stream(kPath, 2500);
+  A_stream.Init();
+  A_stream.Equil(d.data(), e.data());
+
+  printf("%-14s %10s %10s %7s\n", "Matrix", "Two (s)", "Fused (s)", "Speedup");
+  BenchAtA("Dense", A_dense);
+  BenchAtA("Sparse", A_sparse);
+  BenchAtA("Stream", A_stream);
+
+  printf("\n%-14s %6s %13s %10s\n", "Matrix", "Iter", "Optval", "Time (s)");
+  Solve("Dense", p, MatrixDense<real_t>('r', m, n, p.A.data()));
+  Solve("Stream", p, MatrixDenseStream<real_t>(kPath, 2500));
+
+  remove(kPath);
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "function_soa.h"
+#include "matrix/matrix_dense.h"
+#include "pogs.h"
+#include "timer.h"
+
+using namespace pogs;
+
+// Solves (1/2) ||Ax - b||_2^2 + g(x), where g is given by FunctionSoA, and
+// reports the size of A, iterations, multiplications by A and time.
+template <typename T>
+void BenchBlock(const char *name, size_t m, size_t n, const std::vector<T> &A,
+                const FunctionSoA<T> &f, const FunctionSoA<T> &g) {
+  pogs::MatrixDense<T> A_('r', m, n, A.data());
+  pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_);
+  pogs_data.SetVerbose(0);
+
+  double t = timer<double>();
+  PogsStatus status = pogs_data.Solve(f, g);
+  t = timer<double>() - t;
+
+  printf("%-18s %6lu %6lu %6u %8lu %10.3e %12.5e %s\n", name,
+      static_cast<unsigned long>(m), static_cast<unsigned long>(n),
+      pogs_data.GetFinalIter(),
+      static_cast<unsigned long>(pogs_data.GetNumMul()), t,
+      pogs_data.GetOptval(), PogsStatusString(status).c_str());
+}
+
+int main() {
+  typedef double real_t;
+  const size_t m = 500, n = 1000, kGroup = 10;
+
+  std::default_random_engine generator;
+  std::normal_distribution<real_t> n_dist(static_cast<real_t>(0),
+                                          static_cast<real_t>(1));
+  std::vector<real_t> A(m * n), b(m);
+  for (size_t i = 0; i < m * n; ++i)
+    A[i] = n_dist(generator);
+  for (size_t i = 0; i < m; ++i)
+    b[i] = n_dist(generator);
+
+  FunctionSoA<real_t> f(m), g(n);
+  f.SetH(kSquare);
+  f.SetB(b.data());
+
+  printf("%-18s %6s %6s %6s %8s %10s %12s %s\n", "Problem", "m", "n", "Iter",
+      "Mul", "Time (s)", "Optval", "Status");
+
+  // Least squares over the probability simplex, with the constraint
+  // sum_i x_i = 1 modeled as an additional row of A, and as a block.
+  std::vector<real_t> A_lift(A);
+  A_lift.resize((m + 1) * n, static_cast<real_t>(1));
+  FunctionSoA<real_t> f_lift(m + 1), g_lift(n);
+  std::vector<Function> h_lift(m + 1, kSquare);
+  std::vector<real_t> b_lift(b);
+  h_lift[m] = kIndEq0;
+  b_lift.push_back(static_cast<real_t>(1));
+  f_lift.SetH(h_lift.data());
+  f_lift.SetB(b_lift.data());
+  g_lift.SetH(kIndGe0);
+  BenchBlock("Simplex (lifted)", m + 1, n, A_lift, f_lift, g_lift);
+
+  g.AddBlock(kBlockIndSimplex, 0, n);
+  BenchBlock("Simplex (block)", m, n, A, f, g);
+
+  // Group lasso with groups of kGroup elements.
+  real_t lambda = static_cast<real_t>(2);
+  g.Resize(n);
+  for (size_t i = 0; i < n; i += kGroup)
+    g.AddBlock(kBlockNorm2, i, i + kGroup, lambda);
+  BenchBlock("Group lasso", m, n, A, f, g);
+
+  // Least squares over second order cones of kGroup elements, plus the sum
+  // of the first element of each cone.
+  std::vector<real_t> d(n, static_cast<real_t>(0));
+  g.Resize(n);
+  for (size_t i = 0; i < n; i += kGroup) {
+    g.AddBlock(kBlockIndSoc, i, i + kGroup);
+    d[i] = static_cast<real_t>(1);
+  }
+  g.SetD(d.data());
+  BenchBlock("SOC", m, n, A, f, g);
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "function_soa.h"
+#include "timer.h"
+
+// The Huber function as a custom function, with the same arithmetic as
+// kHuber in prox_lib.h.
+struct HuberCustom {
+  template <typename T>
+  T Prox(T v, T rho) const {
+    return std::abs(v) < 1 + 1 / rho ? v * rho / (1 + rho)
+        : v - (v < 0 ? -1 : 1) / rho;
+  }
+  template <typename T>
+  T Func(T x) const {
+    T x_abs = std::abs(x);
+    return x_abs < 1 ? x_abs * x_abs / 2 : x_abs - static_cast<T>(0.5);
+  }
+  template <typename T>
+  T ProjSubgrad(T v, T x) const {
+    return std::max(static_cast<T>(-1), std::min(static_cast<T>(1), x));
+  }
+};
+
+// Pinball loss h(x) = max(tau * x, (tau - 1) * x) of quantile regression,
+// which is not a built-in function.
+struct Pinball {
+  double tau;
+  explicit Pinball(double tau) : tau(tau) { }
+  template <typename T>
+  T Prox(T v, T rho) const {
+    T hi = static_cast<T>(tau) / rho, lo = static_cast<T>(tau - 1) / rho;
+    return v > hi ? v - hi : (v < lo ? v - lo : static_cast<T>(0));
+  }
+  template <typename T>
+  T Func(T x) const {
+    return std::max(static_cast<T>(tau) * x, static_cast<T>(tau - 1) * x);
+  }
+  template <typename T>
+  T ProjSubgrad(T v, T x) const {
+    T hi = static_cast<T>(tau), lo = static_cast<T>(tau - 1);
+    return x > 0 ? hi : (x < 0 ? lo : std::min(std::max(v, lo), hi));
+  }
+};
+
+// Measures the per-element cost of ProxEval and FuncEval over FunctionSoA<T>
+// for the built-in function c * h and for the same function given as the
+// custom function object hf. The last column is the largest difference
+// between the two.
+template <typename T, typename HF>
+void BenchCustom(const char *name, Function h, T c, const HF &hf, size_t size,
+                 unsigned int reps) {
+  FunctionSoA<T> f(size), f_custom(size);
+  std::vector<T> a(size);
+  for (size_t i = 0; i < size; ++i)
+    a[i] = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) + 0.5;
+  f.SetH(h);
+  f.SetA(a.data());
+  f.SetC(c);
+  f_custom.SetA(a.data());
+  f_custom.AddCustom(hf, 0, size);
+
+  std::vector<T> x(size), y(size), y_custom(size);
+  for (size_t i = 0; i < size; ++i)
+    x[i] = 4 * static_cast<T>(rand()) / static_cast<T>(RAND_MAX) - 2;
+  const T kRho = static_cast<T>(1.);
+  double scale = 1e9 / (static_cast<double>(size) * reps);
+
+  double t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f, kRho, x.data(), y.data());
+  double t_prox = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f_custom, kRho, x.data(), y_custom.data());
+  double t_prox_custom = (timer<double>() - t) * scale;
+
+  T sum = 0, sum_custom = 0;
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    sum += FuncEval(f, y.data());
+  double t_func = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    sum_custom += FuncEval(f_custom, y.data());
+  double t_func_custom = (timer<double>() - t) * scale;
+
+  T diff = std::abs(sum - sum_custom) / std::max(static_cast<T>(1), sum);
+  for (size_t i = 0; i < size; ++i)
+    diff = std::max(diff, std::abs(y[i] - y_custom[i]));
+
+  printf("%-10s %8.2f %8.2f %8.2f %8.2f %10.3e\n", name, t_prox,
+      t_prox_custom, t_func, t_func_custom, diff);
+}
+
+int main() {
+  const size_t kSize = 1000000;
+  const unsigned int kReps = 20;
+
+  printf("Time per element (ns)\n");
+  printf("%-10s %8s %8s %8s %8s %10s\n", "Function", "Prox", "Custom", "Func",
+      "Custom", "Max diff");
+  BenchCustom<double>("Huber", kHuber, 1., HuberCustom(), kSize, kReps);
+  BenchCustom<float>("Huber", kHuber, 1.f, HuberCustom(), kSize, kReps);
+  // With tau = 1/2, the pinball loss is |x| / 2.
+  BenchCustom<double>("Pinball", kAbs, 0.5, Pinball(0.5), kSize, kReps);
+
+  return 0;
+}
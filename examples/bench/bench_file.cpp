@@ -0,0 +1,97 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "matrix/matrix_file.h"
+#include "matrix/matrix_sparse.h"
+#include "pogs.h"
+#include "problems.h"
+#include "timer.h"
+
+using namespace pogs;
+
+const char kPath[] = "bench_file.pogsmat";
+
+// Solves the problem p with the matrix A and prints the time to set up A
+// (t_setup), the iterations and the optimal value.
+template <typename T, typename M>
+void Solve(const char *name, const Problem<T> &p, const M &A, double t_setup) {
+  PogsIndirect<T, M> pogs_data(A);
+  pogs_data.SetVerbose(0);
+  pogs_data.Solve(p.f, p.g);
+  printf("%-20s %10.3e %6u %12.5e\n", name, t_setup,
+      pogs_data.GetFinalIter(), pogs_data.GetOptval());
+}
+
+// Compares the setup of A (Init and Equil) from an array with that from an
+// equilibrated matrix file, for A dense and A with the entries of magnitude
+// below 1 dropped, in CSR form.
+template <typename T>
+void BenchFile(const Problem<T> &p) {
+  size_t m = p.m, n = p.n;
+  std::vector<T> d(m), e(n);
+
+  double t = timer<double>();
+  MatrixDense<T> A('r', m, n, p.A.data());
+  A.Init();
+  A.Equil(d.data(), e.data());
+  double t_array = timer<double>() - t;
+  WriteMatrixFile(kPath, A, d.data(), e.data());
+  Solve("Dense (array)", p, MatrixDense<T>('r', m, n, p.A.data()), t_array);
+  {
+    t = timer<double>();
+    MatrixFile<T> F(kPath);
+    if (!F.IsValid())
+      return;
+    MatrixDense<T> B(F);
+    B.Init();
+    B.Equil(d.data(), e.data());
+    double t_file = timer<double>() - t;
+    Solve("Dense (file)", p, MatrixDense<T>(F), t_file);
+  }
+
+  std::vector<T> val;
+  std::vector<POGS_INT> ptr(1, 0), ind;
+  for (size_t i = 0; i < m; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      if (std::abs(p.A[i * n + j]) >= 1) {
+        val.push_back(p.A[i * n + j]);
+        ind.push_back(static_cast<POGS_INT>(j));
+      }
+    }
+    ptr.push_back(static_cast<POGS_INT>(val.size()));
+  }
+  POGS_INT nnz = static_cast<POGS_INT>(val.size());
+
+  t = timer<double>();
+  MatrixSparse<T> S('r', m, n, nnz, val.data(), ptr.data(), ind.data());
+  S.Init();
+  S.Equil(d.data(), e.data());
+  t_array = timer<double>() - t;
+  WriteMatrixFile(kPath, S, d.data(), e.data());
+  Solve("Sparse (array)", p, MatrixSparse<T>('r', m, n, nnz, val.data(),
+      ptr.data(), ind.data()), t_array);
+  {
+    t = timer<double>();
+    MatrixFile<T> F(kPath);
+    if (!F.IsValid())
+      return;
+    MatrixSparse<T> B(F);
+    B.Init();
+    B.Equil(d.data(), e.data());
+    double t_file = timer<double>() - t;
+    Solve("Sparse (file)", p, MatrixSparse<T>(F), t_file);
+  }
+
+  remove(kPath);
+}
+
+int main() {
+  typedef double real_t;
+
+  printf("%-20s %10s %6s %12s\n", "Matrix", "Setup (s)", "Iter", "Optval");
+  BenchFile(Lasso<real_t>(20000, 1000));
+
+  return 0;
+}
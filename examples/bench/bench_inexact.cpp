@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "pogs.h"
+#include "problems.h"
+#include "timer.h"
+
+using namespace pogs;
+
+// Compares exact and inexact proximal operators (SetInexactProx) in terms of
+// iterations, inner steps of the proximal operators, time spent in them and
+// in total, and the objective.
+template <typename T>
+void BenchInexact(const Problem<T> &p, const char *prec, bool inexact) {
+  pogs::MatrixDense<T> A_('r', p.m, p.n, p.A.data());
+  pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_);
+  pogs_data.SetVerbose(0);
+  pogs_data.SetCollectStats(true);
+  pogs_data.SetInexactProx(inexact);
+
+  double t = timer<double>();
+  PogsStatus status = pogs_data.Solve(p.f, p.g);
+  t = timer<double>() - t;
+
+  const PogsStats &stats = pogs_data.GetStats();
+  printf("%-10s %-6s %-8s %6u %10lu %10lu %10.3e %10.3e %12.5e %s\n",
+      p.name.c_str(), prec, inexact ? "inexact" : "exact",
+      pogs_data.GetFinalIter(), static_cast<unsigned long>(stats.prox_iter),
+      static_cast<unsigned long>(stats.prox_iter_exact), stats.prox.time, t,
+      pogs_data.GetOptval(), PogsStatusString(status).c_str());
+}
+
+int main() {
+  const size_t m = 10000, n = 200;
+
+  printf("%-10s %-6s %-8s %6s %10s %10s %10s %10s %12s %s\n", "Problem",
+      "Prec", "Prox", "Iter", "Prox iter", "If exact", "Prox (s)",
+      "Time (s)", "Optval", "Status");
+  Problem<double> p_double = Logistic<double>(m, n);
+  BenchInexact(p_double, "double", false);
+  BenchInexact(p_double, "double", true);
+  Problem<float> p_float = Logistic<float>(m, n);
+  BenchInexact(p_float, "float", false);
+  BenchInexact(p_float, "float", true);
+
+  return 0;
+}
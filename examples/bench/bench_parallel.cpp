@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "function_soa.h"
+#include "timer.h"
+
+// Measures the time per element of ProxEval and FuncEval over FunctionSoA<T>
+// and of ProxEval over std::vector<FunctionObj<T> > with the given number of
+// threads, and the speedup over one thread (t1, of the same three). Loops
+// shorter than kParallelMinSize run serially, regardless of the threads.
+template <typename T>
+void BenchParallel(size_t size, int threads, unsigned int reps, double *t1) {
+#ifdef _OPENMP
+  omp_set_num_threads(threads);
+#else
+  if (threads > 1)
+    return;
+#endif
+  FunctionSoA<T> f(size);
+  std::vector<FunctionObj<T> > f_obj(size);
+  std::vector<T> a(size), x(size), y(size);
+  for (size_t i = 0; i < size; ++i) {
+    a[i] = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) + 0.5;
+    x[i] = 4 * static_cast<T>(rand()) / static_cast<T>(RAND_MAX) - 2;
+    f_obj[i] = FunctionObj<T>(kHuber, a[i]);
+  }
+  f.SetH(kHuber);
+  f.SetA(a.data());
+  const T kRho = static_cast<T>(1.);
+  double scale = 1e9 / (static_cast<double>(size) * reps);
+
+  double t[3];
+  double t0 = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f, kRho, x.data(), y.data());
+  t[0] = (timer<double>() - t0) * scale;
+
+  T sum = 0;
+  t0 = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    sum += FuncEval(f, y.data());
+  t[1] = (timer<double>() - t0) * scale;
+
+  t0 = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f_obj, kRho, x.data(), y.data());
+  t[2] = (timer<double>() - t0) * scale;
+
+  if (threads == 1) {
+    for (int i = 0; i < 3; ++i)
+      t1[i] = t[i];
+  }
+  printf("%10lu %7d %8.3f %6.2f %8.3f %6.2f %8.3f %6.2f\n",
+      static_cast<unsigned long>(size), threads, t[0], t1[0] / t[0], t[1],
+      t1[1] / t[1], t[2], t1[2] / t[2]);
+  if (sum == static_cast<T>(-1))
+    printf("\n");
+}
+
+int main() {
+  const size_t kSizes[] = { 1000, 100000, 10000000 };
+  const int kThreads[] = { 1, 2, 4, 8, 16, 32, 64 };
+  const size_t kElements = 100000000;
+
+#ifdef _OPENMP
+  int procs = omp_get_num_procs();
+#else
+  int procs = 1;
+#endif
+  printf("Time per element (ns) and speedup over one thread, %d processors\n",
+      procs);
+  printf("%10s %7s %8s %6s %8s %6s %8s %6s\n", "Size", "Threads", "Prox",
+      "Speed", "Func", "Speed", "ProxObj", "Speed");
+  for (size_t i = 0; i < sizeof(kSizes) / sizeof(kSizes[0]); ++i) {
+    double t1[3];
+    unsigned int reps = static_cast<unsigned int>(kElements / kSizes[i]);
+    for (size_t j = 0; j < sizeof(kThreads) / sizeof(kThreads[0]); ++j)
+      BenchParallel<double>(kSizes[i], kThreads[j], reps, t1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "function_soa.h"
+#include "matrix/matrix_dense.h"
+#include "pogs.h"
+#include "timer.h"
+
+using namespace pogs;
+
+// Measures the per-element cost of ProxEval and FuncEval over FunctionSoA<T>
+// for the built-in function h and for the same function given as the
+// piecewise function hf. The last column is the largest difference between
+// the two.
+template <typename T>
+void BenchEval(const char *name, Function h, const PiecewiseFunction<T> &hf,
+               size_t size, unsigned int reps) {
+  FunctionSoA<T> f(size), f_pw(size);
+  std::vector<T> a(size);
+  for (size_t i = 0; i < size; ++i)
+    a[i] = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) + 0.5;
+  f.SetH(h);
+  f.SetA(a.data());
+  f_pw.SetA(a.data());
+  f_pw.AddCustom(hf, 0, size);
+
+  std::vector<T> x(size), y(size), y_pw(size);
+  for (size_t i = 0; i < size; ++i)
+    x[i] = 4 * static_cast<T>(rand()) / static_cast<T>(RAND_MAX) - 2;
+  const T kRho = static_cast<T>(1.);
+  double scale = 1e9 / (static_cast<double>(size) * reps);
+
+  double t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f, kRho, x.data(), y.data());
+  double t_prox = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f_pw, kRho, x.data(), y_pw.data());
+  double t_prox_pw = (timer<double>() - t) * scale;
+
+  T sum = 0, sum_pw = 0;
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    sum += FuncEval(f, y.data());
+  double t_func = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    sum_pw += FuncEval(f_pw, y.data());
+  double t_func_pw = (timer<double>() - t) * scale;
+
+  T diff = std::abs(sum - sum_pw) / std::max(static_cast<T>(1), sum);
+  for (size_t i = 0; i < size; ++i)
+    diff = std::max(diff, std::abs(y[i] - y_pw[i]));
+
+  printf("%-10s %8.2f %8.2f %8.2f %8.2f %10.3e\n", name, t_prox, t_prox_pw,
+      t_func, t_func_pw, diff);
+}
+
+// Solves min f(Ax) + g(x) and reports the size of A, iterations,
+// multiplications by A and time.
+template <typename T>
+void BenchSolve(const char *name, size_t m, size_t n, const std::vector<T> &A,
+                const FunctionSoA<T> &f, const FunctionSoA<T> &g) {
+  pogs::MatrixDense<T> A_('r', m, n, A.data());
+  pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_);
+  pogs_data.SetVerbose(0);
+
+  double t = timer<double>();
+  PogsStatus status = pogs_data.Solve(f, g);
+  t = timer<double>() - t;
+
+  printf("%-18s %6lu %6lu %6u %8lu %10.3e %12.5e %s\n", name,
+      static_cast<unsigned long>(m), static_cast<unsigned long>(n),
+      pogs_data.GetFinalIter(),
+      static_cast<unsigned long>(pogs_data.GetNumMul()), t,
+      pogs_data.GetOptval(), PogsStatusString(status).c_str());
+}
+
+int main() {
+  typedef double real_t;
+  const size_t kSize = 1000000;
+  const unsigned int kReps = 20;
+
+  // The Huber function, with pieces -x - 1/2, x^2 / 2 and x - 1/2.
+  printf("Time per element (ns)\n");
+  printf("%-10s %8s %8s %8s %8s %10s\n", "Function", "Prox", "Pwise", "Func",
+      "Pwise", "Max diff");
+  BenchEval<double>("Huber", kHuber, PiecewiseFunction<double>({-1., 1.},
+      {-1., 0., 1.}, {0., 1., 0.}), kSize, kReps);
+  BenchEval<float>("Huber", kHuber, PiecewiseFunction<float>({-1.f, 1.f},
+      {-1.f, 0.f, 1.f}, {0.f, 1.f, 0.f}), kSize, kReps);
+  BenchEval<double>("Abs", kAbs, PiecewiseFunction<double>({0.}, {-1., 1.}),
+      kSize, kReps);
+  printf("\n");
+
+  // Tiered cost sum_i h(a_i^T x - b_i) - sum_j x_j + (lambda / 2) ||x||_2^2,
+  // where h(u) = sum_k s_k max(0, u - t_k). Lifted, each row of A is repeated
+  // once per breakpoint, with f = s_k * kMaxPos0(y - b_i - t_k).
+  const size_t m = 2000, n = 200;
+  const real_t t_tier[] = { 0., 1., 2., 4. };
+  const real_t s_tier[] = { 1., 1., 2., 4. };
+  const size_t kTier = sizeof(t_tier) / sizeof(t_tier[0]);
+  const real_t lambda = static_cast<real_t>(0.1);
+
+  std::default_random_engine generator;
+  std::normal_distribution<real_t> n_dist(static_cast<real_t>(0),
+                                          static_cast<real_t>(1));
+  std::vector<real_t> A(m * n), b(m);
+  for (size_t i = 0; i < m * n; ++i)
+    A[i] = n_dist(generator) / std::sqrt(static_cast<real_t>(n));
+  for (size_t i = 0; i < m; ++i)
+    b[i] = n_dist(generator);
+
+  FunctionSoA<real_t> g(n);
+  g.SetH(kSquare);
+  g.SetC(lambda);
+  g.SetD(static_cast<real_t>(-1));
+
+  printf("%-18s %6s %6s %6s %8s %10s %12s %s\n", "Problem", "m", "n", "Iter",
+      "Mul", "Time (s)", "Optval", "Status");
+
+  std::vector<real_t> A_lift(m * kTier * n), b_lift(m * kTier),
+      c_lift(m * kTier);
+  for (size_t i = 0; i < m; ++i) {
+    for (size_t k = 0; k < kTier; ++k) {
+      std::copy(A.begin() + i * n, A.begin() + (i + 1) * n,
+          A_lift.begin() + (i * kTier + k) * n);
+      b_lift[i * kTier + k] = b[i] + t_tier[k];
+      c_lift[i * kTier + k] = s_tier[k];
+    }
+  }
+  FunctionSoA<real_t> f_lift(m * kTier);
+  f_lift.SetH(kMaxPos0);
+  f_lift.SetB(b_lift.data());
+  f_lift.SetC(c_lift.data());
+  BenchSolve("Tiered (lifted)", m * kTier, n, A_lift, f_lift, g);
+
+  std::vector<real_t> t_pw(t_tier, t_tier + kTier), l_pw(1, 0);
+  for (size_t k = 0; k < kTier; ++k)
+    l_pw.push_back(l_pw.back() + s_tier[k]);
+  FunctionSoA<real_t> f(m);
+  f.SetB(b.data());
+  f.AddCustom(PiecewiseFunction<real_t>(t_pw, l_pw), 0, m);
+  BenchSolve("Tiered (piecewise)", m, n, A, f, g);
+
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "pogs.h"
+#include "problems.h"
+#include "timer.h"
+
+using namespace pogs;
+
+// Solves the problem p with A stored at the given precision, and prints the
+// time per product by A or A^T, the iterations, the optimal value, its
+// relative error to optval_full (the optimal value at full precision) and
+// the total time. Returns the optimal value.
+template <typename T, typename P>
+T Solve(const char *name, const char *projector, const Problem<T> &p,
+        typename MatrixDense<T>::Precision precision, T optval_full) {
+  MatrixDense<T> A('r', p.m, p.n, p.A.data());
+  A.SetPrecision(precision);
+  Pogs<T, MatrixDense<T>, P> pogs_data(A);
+  pogs_data.SetVerbose(0);
+
+  double t = timer<double>();
+  pogs_data.Solve(p.f, p.g);
+  t = timer<double>() - t;
+
+  // Mul reads the reduced precision copy after Equil.
+  MatrixDense<T> A_mul(A);
+  A_mul.Init();
+  std::vector<T> d(p.m), e(p.n);
+  A_mul.Equil(d.data(), e.data());
+  std::vector<T> x(p.n, static_cast<T>(1)), y(p.m);
+  const unsigned int kReps = 10;
+  double t_mul = 0;
+  for (unsigned int r = 0; r <= kReps; ++r) {
+    // The first pair of products touches the buffers and is not timed.
+    if (r == 1)
+      t_mul = timer<double>();
+    A_mul.Mul('n', static_cast<T>(1), x.data(), static_cast<T>(0), y.data());
+    A_mul.Mul('t', static_cast<T>(1), y.data(), static_cast<T>(0), x.data());
+  }
+  t_mul = (timer<double>() - t_mul) / (2 * kReps);
+
+  T optval = pogs_data.GetOptval();
+  double err = optval_full == static_cast<T>(0) ? 0. :
+      std::abs(static_cast<double>(optval - optval_full) / optval_full);
+  printf("%-10s %-8s %-6s %10.3e %6u %13.6e %10.3e %10.3e\n", p.name.c_str(),
+      projector, name, t_mul, pogs_data.GetFinalIter(),
+      static_cast<double>(optval), err, t);
+  return optval;
+}
+
+template <typename T>
+void BenchPrecision(const Problem<T> &p) {
+  const char *names[] = { "Full", "BF16", "FP16", "INT8" };
+  const typename MatrixDense<T>::Precision precisions[] = {
+      MatrixDense<T>::FULL, MatrixDense<T>::BF16, MatrixDense<T>::FP16,
+      MatrixDense<T>::INT8 };
+
+  T optval_full = static_cast<T>(0);
+  for (unsigned int k = 0; k < 4; ++k) {
+    T optval = Solve<T, ProjectorCgls<T, MatrixDense<T> > >(names[k], "CGLS",
+        p, precisions[k], optval_full);
+    if (k == 0)
+      optval_full = optval;
+  }
+  for (unsigned int k = 0; k < 4; ++k) {
+    T optval = Solve<T, ProjectorDirect<T, MatrixDense<T> > >(names[k],
+        "Direct", p, precisions[k], optval_full);
+    if (k == 0)
+      optval_full = optval;
+  }
+}
+
+int main() {
+  printf("%-10s %-8s %-6s %10s %6s %13s %10s %10s\n", "Problem", "Proj",
+      "Prec", "Mul (s)", "Iter", "Optval", "Rel err", "Time (s)");
+  printf("double\n");
+  BenchPrecision(Lasso<double>(10000, 1000));
+  BenchPrecision(Logistic<double>(10000, 1000));
+  printf("float\n");
+  BenchPrecision(Lasso<float>(10000, 1000));
+  BenchPrecision(Logistic<float>(10000, 1000));
+
+  return 0;
+}
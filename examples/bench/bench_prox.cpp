@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "function_soa.h"
+#include "prox_lib.h"
+#include "timer.h"
+
+// Measures the per-element cost of ProxEval, FuncEval and ProjSubgradEval
+// over std::vector<FunctionObj<T> > (which dispatches on h for every element)
+// and over FunctionSoA<T> (which dispatches once per segment of equal h).
+template <typename T>
+void BenchProx(const char *name, const std::vector<FunctionObj<T> > &f,
+               unsigned int reps) {
+  size_t size = f.size();
+  FunctionSoA<T> f_soa;
+  f_soa.Assign(f);
+
+  std::vector<T> x(size), v(size), w(size), y(size), y_soa(size);
+  for (size_t i = 0; i < size; ++i) {
+    x[i] = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) + 0.5;
+    v[i] = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) - 0.5;
+  }
+  const T kRho = static_cast<T>(1.);
+  double scale = 1e9 / (static_cast<double>(size) * reps);
+
+  // std::vector<FunctionObj<T> >.
+  double t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f, kRho, x.data(), y.data());
+  double t_prox_aos = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    FuncEval(f, x.data());
+  double t_func_aos = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProjSubgradEval(f, x.data(), v.data(), w.data());
+  double t_subg_aos = (timer<double>() - t) * scale;
+
+  // FunctionSoA<T>.
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f_soa, kRho, x.data(), y_soa.data());
+  double t_prox_soa = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    FuncEval(f_soa, x.data());
+  double t_func_soa = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProjSubgradEval(f_soa, x.data(), v.data(), w.data());
+  double t_subg_soa = (timer<double>() - t) * scale;
+
+  // Largest difference between the two proximal operator evaluations.
+  T diff = 0;
+  for (size_t i = 0; i < size; ++i)
+    diff = std::max(diff, std::abs(y[i] - y_soa[i]));
+
+  printf("%-10s %8lu %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %10.3e\n", name,
+      static_cast<unsigned long>(f_soa.NumSegments()), t_prox_aos, t_prox_soa,
+      t_func_aos, t_func_soa, t_subg_aos, t_subg_soa, diff);
+}
+
+// Functions with the same h for all elements, with random parameters.
+template <typename T>
+std::vector<FunctionObj<T> > Uniform(Function h, size_t size) {
+  std::vector<FunctionObj<T> > f;
+  f.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    T a = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) + 0.5;
+    T b = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) - 0.5;
+    f.push_back(FunctionObj<T>(h, a, b, static_cast<T>(1.)));
+  }
+  return f;
+}
+
+// Functions cycling through the given h's, one element at a time.
+template <typename T>
+std::vector<FunctionObj<T> > Mixed(const std::vector<Function> &h,
+                                   size_t size) {
+  std::vector<FunctionObj<T> > f = Uniform<T>(kZero, size);
+  for (size_t i = 0; i < size; ++i)
+    f[i].h = h[i % h.size()];
+  return f;
+}
+
+int main() {
+  typedef double real_t;
+  const size_t kSize = 1000000;
+  const unsigned int kReps = 50;
+
+  printf("Time per element (ns)\n");
+  printf("%-10s %8s %8s %8s %8s %8s %8s %8s %10s\n", "Function", "Segments",
+      "Prox", "Prox SoA", "Func", "Func SoA", "Subg", "Subg SoA", "Prox diff");
+  BenchProx<real_t>("Abs", Uniform<real_t>(kAbs, kSize), kReps);
+  BenchProx<real_t>("Square", Uniform<real_t>(kSquare, kSize), kReps);
+  BenchProx<real_t>("IndGe0", Uniform<real_t>(kIndGe0, kSize), kReps);
+  BenchProx<real_t>("MaxPos0", Uniform<real_t>(kMaxPos0, kSize), kReps);
+  BenchProx<real_t>("Huber", Uniform<real_t>(kHuber, kSize), kReps);
+  BenchProx<real_t>("Logistic", Uniform<real_t>(kLogistic, kSize), kReps);
+
+  // Two long runs, as in the g of a problem with non-negative variables
+  // followed by free variables.
+  std::vector<FunctionObj<real_t> > runs = Uniform<real_t>(kIndGe0, kSize);
+  for (size_t i = kSize / 2; i < kSize; ++i)
+    runs[i].h = kZero;
+  BenchProx<real_t>("Runs", runs, kReps);
+
+  // Worst case, no two consecutive elements have the same h.
+  std::vector<Function> h;
+  h.push_back(kAbs);
+  h.push_back(kSquare);
+  h.push_back(kIndGe0);
+  BenchProx<real_t>("Mixed", Mixed<real_t>(h, kSize), kReps);
+
+  return 0;
+}
+
@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "pogs.h"
+#include "problems.h"
+#include "timer.h"
+
+using namespace pogs;
+
+// Compares the rho policies (and fixed rho) in terms of iterations and
+// wall-clock time.
+template <typename T>
+void BenchRho(const Problem<T> &p, bool adaptive, RhoPolicyType type,
+              const char *name) {
+  pogs::MatrixDense<T> A_('r', p.m, p.n, p.A.data());
+  pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_);
+  pogs_data.SetVerbose(0);
+  pogs_data.SetAdaptiveRho(adaptive);
+  pogs_data.SetRhoPolicy(type);
+
+  double t = timer<double>();
+  PogsStatus status = pogs_data.Solve(p.f, p.g);
+  t = timer<double>() - t;
+
+  printf("%-10s %-10s %6u %10.3e %10.3e %12.5e %s\n", p.name.c_str(), name,
+      pogs_data.GetFinalIter(), pogs_data.GetRho(), t, pogs_data.GetOptval(),
+      PogsStatusString(status).c_str());
+}
+
+int main() {
+  typedef double real_t;
+
+  printf("%-10s %-10s %6s %10s %10s %12s %s\n", "Problem", "Policy", "Iter",
+      "Rho", "Time (s)", "Optval", "Status");
+  std::vector<Problem<real_t> > problems = AllProblems<real_t>();
+  for (size_t i = 0; i < problems.size(); ++i) {
+    BenchRho(problems[i], false, RHO_HEURISTIC, "fixed");
+    BenchRho(problems[i], true, RHO_HEURISTIC, "heuristic");
+    BenchRho(problems[i], true, RHO_RESIDUAL_BALANCING, "balancing");
+    BenchRho(problems[i], true, RHO_SPECTRAL, "spectral");
+  }
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include <cstdio>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "pogs.h"
+#include "problems.h"
+#include "timer.h"
+
+using namespace pogs;
+
+// Compares the stopping-check modes in terms of iterations, multiplications
+// by A (in total and for the exact residuals) and wall-clock time.
+template <typename T, typename P>
+void BenchStop(const Problem<T> &p, const char *proj, StopCheckType type,
+               const char *name) {
+  pogs::MatrixDense<T> A_('r', p.m, p.n, p.A.data());
+  pogs::Pogs<T, pogs::MatrixDense<T>, P> pogs_data(A_);
+  pogs_data.SetVerbose(0);
+  pogs_data.SetStopCheck(type);
+
+  double t = timer<double>();
+  PogsStatus status = pogs_data.Solve(p.f, p.g);
+  t = timer<double>() - t;
+
+  printf("%-10s %-6s %-9s %6u %8lu %8lu %10.3e %12.5e %s\n", p.name.c_str(),
+      proj, name, pogs_data.GetFinalIter(),
+      static_cast<unsigned long>(pogs_data.GetNumMul()),
+      static_cast<unsigned long>(pogs_data.GetNumMulResidual()), t,
+      pogs_data.GetOptval(), PogsStatusString(status).c_str());
+}
+
+template <typename T, typename P>
+void BenchStopAll(const Problem<T> &p, const char *proj) {
+  BenchStop<T, P>(p, proj, STOP_CHECK_ALWAYS, "always");
+  BenchStop<T, P>(p, proj, STOP_CHECK_PERIODIC, "periodic");
+  BenchStop<T, P>(p, proj, STOP_CHECK_CHEAP, "cheap");
+  BenchStop<T, P>(p, proj, STOP_CHECK_ADAPTIVE, "adaptive");
+}
+
+int main() {
+  typedef double real_t;
+  typedef pogs::MatrixDense<real_t> M;
+
+  printf("%-10s %-6s %-9s %6s %8s %8s %10s %12s %s\n", "Problem", "Proj",
+      "Check", "Iter", "Mul", "Mul res", "Time (s)", "Optval", "Status");
+  std::vector<Problem<real_t> > problems = AllProblems<real_t>();
+  for (size_t i = 0; i < problems.size(); ++i) {
+    BenchStopAll<real_t, ProjectorDirect<real_t, M> >(problems[i], "direct");
+    BenchStopAll<real_t, ProjectorCgls<real_t, M> >(problems[i], "cgls");
+  }
+
+  return 0;
+}
@@ -0,0 +1,41 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "timer.h"
+
+using namespace pogs;
+
+// Measures the time of Init and Equil and the memory allocated by the matrix
+// for the COPY and IN_PLACE storage of an m x n matrix.
+template <typename T>
+void BenchStorage(const char *name, size_t m, size_t n,
+                  typename MatrixDense<T>::Storage storage) {
+  std::vector<T> A(m * n), d(m), e(n);
+  for (size_t i = 0; i < m * n; ++i)
+    A[i] = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) - 0.5;
+
+  double t = timer<double>();
+  MatrixDense<T> A_('r', m, n, A.data(), storage);
+  A_.Init();
+  double t_init = timer<double>() - t;
+  t = timer<double>();
+  A_.Equil(d.data(), e.data());
+  double t_equil = timer<double>() - t;
+
+  printf("%-10s %6lu %6lu %10.3e %10.3e %10.1f\n", name,
+      static_cast<unsigned long>(m), static_cast<unsigned long>(n), t_init,
+      t_equil, static_cast<double>(A_.BytesAlloc()) / (1 << 20));
+}
+
+int main() {
+  const size_t m = 20000, n = 1000;
+
+  printf("%-10s %6s %6s %10s %10s %10s\n", "Storage", "m", "n", "Init (s)",
+      "Equil (s)", "Alloc (MB)");
+  BenchStorage<double>("Copy", m, n, MatrixDense<double>::COPY);
+  BenchStorage<double>("In place", m, n, MatrixDense<double>::IN_PLACE);
+
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <vector>
+
+#include "matrix/matrix_dense.h"
+#include "matrix/matrix_dense_stream.h"
+#include "matrix/matrix_file.h"
+#include "pogs.h"
+#include "problems.h"
+#include "timer.h"
+
+using namespace pogs;
+
+const char kPath[] = "bench_stream.pogsmat";
+
+// Solves the problem p with the matrix A and prints the number of panels,
+// the time per product by A or A^T, the iterations, the optimal value and
+// the total time.
+template <typename T, typename M>
+void Solve(const char *name, size_t num_panels, const Problem<T> &p,
+           const M &A) {
+  PogsIndirect<T, M> pogs_data(A);
+  pogs_data.SetVerbose(0);
+
+  double t = timer<double>();
+  pogs_data.Solve(p.f, p.g);
+  t = timer<double>() - t;
+
+  M A_mul(A);
+  A_mul.Init();
+  std::vector<T> x(p.n, static_cast<T>(1)), y(p.m);
+  const unsigned int kReps = 10;
+  double t_mul = 0;
+  for (unsigned int r = 0; r <= kReps; ++r) {
+    // The first pair of products touches the buffers and is not timed.
+    if (r == 1)
+      t_mul = timer<double>();
+    A_mul.Mul('n', static_cast<T>(1), x.data(), static_cast<T>(0), y.data());
+    A_mul.Mul('t', static_cast<T>(1), y.data(), static_cast<T>(0), x.data());
+  }
+  t_mul = (timer<double>() - t_mul) / (2 * kReps);
+
+  printf("%-18s %7lu %10.3e %6u %12.5e %10.3e\n", name,
+      static_cast<unsigned long>(num_panels), t_mul,
+      pogs_data.GetFinalIter(), pogs_data.GetOptval(), t);
+}
+
+int main() {
+  typedef double real_t;
+  Problem<real_t> p = Lasso<real_t>(20000, 1000);
+
+  {
+    MatrixDense<real_t> A('r', p.m, p.n, p.A.data());
+    A.Init();
+    WriteMatrixFile(kPath, A);
+  }
+
+  printf("%-18s %7s %10s %6s %12s %10s\n", "Matrix", "Panels", "Mul (s)",
+      "Iter", "Optval", "Time (s)");
+  Solve("Dense", 1, p, MatrixDense<real_t>('r', p.m, p.n, p.A.data()));
+  const size_t panel_rows[] = { 20000, 2500, 625 };
+  for (size_t k = 0; k < sizeof(panel_rows) / sizeof(panel_rows[0]); ++k) {
+    MatrixDenseStream<real_t> A(kPath, panel_rows[k]);
+    Solve("Stream", A.NumPanels(), p, A);
+  }
+
+  remove(kPath);
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "function_soa.h"
+#include "prox_lib.h"
+#include "timer.h"
+
+// Measures the per-element cost of the proximal operators that call exp and
+// log (kLogistic, kNegEntr and kExp), evaluated with the scalar functions of
+// prox_lib.h over std::vector<FunctionObj<T> > and with the vectorized
+// functions of prox_lib_simd.h over FunctionSoA<T>. The last two columns give
+// the largest difference between the two, relative to max(1, |x|), and the
+// tolerance Tol<T>() that it should not exceed.
+template <typename T>
+void BenchTranscendental(const char *name, Function h, size_t size,
+                         unsigned int reps) {
+  // Arguments spread over [-20, 20] and parameters a over [0.5, 1.5], so that
+  // the proximal operators are evaluated with rho = 1 / a^2 in [0.4, 4].
+  std::vector<FunctionObj<T> > f;
+  f.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    T a = static_cast<T>(rand()) / static_cast<T>(RAND_MAX) + 0.5;
+    f.push_back(FunctionObj<T>(h, a, static_cast<T>(0.)));
+  }
+  FunctionSoA<T> f_soa;
+  f_soa.Assign(f);
+
+  std::vector<T> x(size), y(size), y_soa(size);
+  for (size_t i = 0; i < size; ++i)
+    x[i] = 40 * static_cast<T>(rand()) / static_cast<T>(RAND_MAX) - 20;
+  const T kRho = static_cast<T>(1.);
+  double scale = 1e9 / (static_cast<double>(size) * reps);
+
+  double t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f, kRho, x.data(), y.data());
+  double t_prox = (timer<double>() - t) * scale;
+
+  t = timer<double>();
+  for (unsigned int r = 0; r < reps; ++r)
+    ProxEval(f_soa, kRho, x.data(), y_soa.data());
+  double t_prox_soa = (timer<double>() - t) * scale;
+
+  T diff = 0;
+  for (size_t i = 0; i < size; ++i)
+    diff = std::max(diff, std::abs(y[i] - y_soa[i]) /
+        std::max(static_cast<T>(1.), std::abs(y[i])));
+
+  printf("%-10s %-6s %8.2f %8.2f %8.2f %10.3e %10.3e\n", name,
+      sizeof(T) == sizeof(double) ? "double" : "float", t_prox, t_prox_soa,
+      t_prox / t_prox_soa, diff, static_cast<double>(Tol<T>()));
+}
+
+int main() {
+  const size_t kSize = 1000000;
+  const unsigned int kReps = 10;
+
+  printf("Time per element (ns)\n");
+  printf("%-10s %-6s %8s %8s %8s %10s %10s\n", "Function", "Type", "Prox",
+      "Prox SoA", "Speedup", "Max diff", "Tol");
+  BenchTranscendental<double>("Logistic", kLogistic, kSize, kReps);
+  BenchTranscendental<float>("Logistic", kLogistic, kSize, kReps);
+  BenchTranscendental<double>("NegEntr", kNegEntr, kSize, kReps);
+  BenchTranscendental<float>("NegEntr", kNegEntr, kSize, kReps);
+  BenchTranscendental<double>("Exp", kExp, kSize, kReps);
+  BenchTranscendental<float>("Exp", kExp, kSize, kReps);
+
+  return 0;
+}
+
@@ -0,0 +1,238 @@
+#ifndef PROBLEMS_H_
+#define PROBLEMS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "prox_lib.h"
+
+// Test problems for the benchmarks, generated as in <pogs>/examples/cpp. The
+// matrix A is stored in row major order.
+template <typename T>
+struct Problem {
+  std::string name;
+  size_t m, n;
+  std::vector<T> A;
+  std::vector<FunctionObj<T> > f, g;
+};
+
+// Lasso
+//   minimize    (1/2) ||Ax - b||_2^2 + \lambda ||x||_1
+template <typename T>
+Problem<T> Lasso(size_t m, size_t n) {
+  Problem<T> p = { "Lasso", m, n, std::vector<T>(m * n) };
+  std::vector<T> b(m);
+
+  std::default_random_engine generator;
+  std::uniform_real_distribution<T> u_dist(static_cast<T>(0),
+                                           static_cast<T>(1));
+  std::normal_distribution<T> n_dist(static_cast<T>(0),
+                                     static_cast<T>(1));
+
+  for (unsigned int i = 0; i < m * n; ++i)
+    p.A[i] = n_dist(generator);
+
+  std::vector<T> x_true(n);
+  for (unsigned int i = 0; i < n; ++i)
+    x_true[i] = u_dist(generator) < static_cast<T>(0.8)
+        ? static_cast<T>(0) : n_dist(generator) / static_cast<T>(std::sqrt(n));
+
+  for (unsigned int i = 0; i < m; ++i) {
+    for (unsigned int j = 0; j < n; ++j)
+      b[i] += p.A[i * n + j] * x_true[j];
+    b[i] += static_cast<T>(0.5) * n_dist(generator);
+  }
+
+  T lambda_max = static_cast<T>(0);
+  for (unsigned int j = 0; j < n; ++j) {
+    T u = 0;
+    for (unsigned int i = 0; i < m; ++i)
+      u += p.A[i * n + j] * b[i];
+    lambda_max = std::max(lambda_max, std::abs(u));
+  }
+
+  for (unsigned int i = 0; i < m; ++i)
+    p.f.emplace_back(kSquare, static_cast<T>(1), b[i]);
+  for (unsigned int i = 0; i < n; ++i)
+    p.g.emplace_back(kAbs, static_cast<T>(0.2) * lambda_max);
+  return p;
+}
+
+// Logistic regression
+//   minimize    \sum_i log(1 + e^{a_i^T x}) - d_i a_i^T x + \lambda ||x||_1
+template <typename T>
+Problem<T> Logistic(size_t m, size_t n) {
+  Problem<T> p = { "Logistic", m, n + 1, std::vector<T>(m * (n + 1)) };
+  std::vector<T> d(m);
+
+  std::default_random_engine generator;
+  std::uniform_real_distribution<T> u_dist(static_cast<T>(0),
+                                           static_cast<T>(1));
+  std::normal_distribution<T> n_dist(static_cast<T>(0),
+                                     static_cast<T>(1));
+
+  for (unsigned int i = 0; i < m; ++i) {
+    for (unsigned int j = 0; j < n; ++j)
+      p.A[i * (n + 1) + j] = n_dist(generator);
+    p.A[i * (n + 1) + n] = 1;
+  }
+
+  std::vector<T> x_true(n + 1);
+  for (unsigned int i = 0; i < n; ++i)
+    x_true[i] = u_dist(generator) < 0.8 ? 0 : n_dist(generator) / n;
+  x_true[n] = n_dist(generator) / n;
+
+  for (unsigned int i = 0; i < m; ++i) {
+    d[i] = 0;
+    for (unsigned int j = 0; j < n + 1; ++j)
+      d[i] += p.A[i * (n + 1) + j] * x_true[j];
+  }
+  for (unsigned int i = 0; i < m; ++i)
+    d[i] = 1 / (1 + std::exp(-d[i])) > u_dist(generator);
+
+  T lambda_max = static_cast<T>(0);
+  for (unsigned int j = 0; j < n; ++j) {
+    T u = 0;
+    for (unsigned int i = 0; i < m; ++i)
+      u += p.A[i * (n + 1) + j] * (static_cast<T>(0.5) - d[i]);
+    lambda_max = std::max(lambda_max, std::abs(u));
+  }
+
+  for (unsigned int i = 0; i < m; ++i)
+    p.f.emplace_back(kLogistic, 1, 0, 1, -d[i]);
+  for (unsigned int i = 0; i < n; ++i)
+    p.g.emplace_back(kAbs, static_cast<T>(0.5) * lambda_max);
+  p.g.emplace_back(kZero);
+  return p;
+}
+
+// Linear program in equality form
+//   minimize    c^T x
+//   subject to  Ax = b, x >= 0
+template <typename T>
+Problem<T> LpEq(size_t m, size_t n) {
+  Problem<T> p = { "LpEq", m + 1, n, std::vector<T>((m + 1) * n) };
+
+  std::default_random_engine generator;
+  std::uniform_real_distribution<T> u_dist(static_cast<T>(0),
+                                           static_cast<T>(1));
+
+  for (unsigned int i = 0; i < (m + 1) * n; ++i)
+    p.A[i] = u_dist(generator) / static_cast<T>(n);
+
+  std::vector<T> v(n);
+  for (unsigned int i = 0; i < n; ++i)
+    v[i] = u_dist(generator);
+
+  for (unsigned int i = 0; i < m; ++i) {
+    T b_i = static_cast<T>(0);
+    for (unsigned int j = 0; j < n; ++j)
+      b_i += p.A[i * n + j] * v[j];
+    p.f.emplace_back(kIndEq0, static_cast<T>(1), b_i);
+  }
+  p.f.emplace_back(kIdentity);
+  for (unsigned int i = 0; i < n; ++i)
+    p.g.emplace_back(kIndGe0);
+  return p;
+}
+
+// Linear program in inequality form
+//   minimize    c^T x
+//   subject to  Ax <= b
+template <typename T>
+Problem<T> LpIneq(size_t m, size_t n) {
+  Problem<T> p = { "LpIneq", m, n, std::vector<T>(m * n) };
+
+  std::default_random_engine generator;
+  std::uniform_real_distribution<T> u_dist(static_cast<T>(0),
+                                           static_cast<T>(1));
+
+  for (unsigned int i = 0; i < (m - n) * n; ++i)
+    p.A[i] = -static_cast<T>(1) / static_cast<T>(n) * u_dist(generator);
+  for (unsigned int i = static_cast<unsigned int>((m - n) * n); i < m * n; ++i)
+    p.A[i] = (i - (m - n) * n) % (n + 1) == 0 ? -1 : 0;
+
+  for (unsigned int i = 0; i < m; ++i) {
+    T b_i = static_cast<T>(0);
+    for (unsigned int j = 0; j < n; ++j)
+      b_i += p.A[i * n + j] * u_dist(generator);
+    b_i += static_cast<T>(0.2) * u_dist(generator);
+    p.f.emplace_back(kIndLe0, static_cast<T>(1), b_i);
+  }
+  for (unsigned int i = 0; i < n; ++i)
+    p.g.emplace_back(kIdentity, u_dist(generator) / n);
+  return p;
+}
+
+// Non-negative least squares
+//   minimize    (1/2) ||Ax - b||_2^2
+//   subject to  x >= 0
+template <typename T>
+Problem<T> NonNegL2(size_t m, size_t n) {
+  Problem<T> p = { "NonNegL2", m, n, std::vector<T>(m * n) };
+
+  std::default_random_engine generator;
+  std::uniform_real_distribution<T> u_dist(static_cast<T>(0),
+                                           static_cast<T>(1));
+  std::normal_distribution<T> n_dist(static_cast<T>(0),
+                                     static_cast<T>(1));
+
+  for (unsigned int i = 0; i < m * n; ++i)
+    p.A[i] = static_cast<T>(1) / static_cast<T>(n) * u_dist(generator);
+
+  for (unsigned int i = 0; i < m; ++i) {
+    T b_i = static_cast<T>(0);
+    for (unsigned int j = 0; j < n; j++)
+      b_i += 3 * j < 2 * n ? p.A[i * n + j] : -p.A[i * n + j];
+    b_i += static_cast<T>(0.01) * n_dist(generator);
+    p.f.emplace_back(kSquare, static_cast<T>(1), b_i);
+  }
+  for (unsigned int i = 0; i < n; ++i)
+    p.g.emplace_back(kIndGe0);
+  return p;
+}
+
+// Support vector machine
+//   minimize    (1/2) ||w||_2^2 + \lambda \sum_i max(0, 1 - y_i (a_i^T w + b))
+template <typename T>
+Problem<T> Svm(size_t m, size_t n) {
+  Problem<T> p = { "Svm", m, n + 1, std::vector<T>(m * (n + 1)) };
+
+  std::default_random_engine generator;
+  std::normal_distribution<T> n_dist(static_cast<T>(0),
+                                     static_cast<T>(1));
+
+  for (unsigned int i = 0; i < m; ++i) {
+    T sign_yi = i < m / 2 ? static_cast<T>(1) : static_cast<T>(-1);
+    for (unsigned int j = 0; j < n; ++j)
+      p.A[i * (n + 1) + j] = -sign_yi * (n_dist(generator) + sign_yi);
+    p.A[i * (n + 1) + n] = -sign_yi;
+  }
+
+  T lambda = static_cast<T>(1);
+  for (unsigned int i = 0; i < m; ++i)
+    p.f.emplace_back(kMaxPos0, static_cast<T>(1), static_cast<T>(-1), lambda);
+  for (unsigned int i = 0; i < n; ++i)
+    p.g.emplace_back(kSquare);
+  p.g.emplace_back(kZero);
+  return p;
+}
+
+// The problems of <pogs>/examples/cpp/run_all.cpp.
+template <typename T>
+std::vector<Problem<T> > AllProblems() {
+  std::vector<Problem<T> > problems;
+  problems.push_back(Lasso<T>(200, 2000));
+  problems.push_back(Logistic<T>(1000, 100));
+  problems.push_back(LpEq<T>(1000, 200));
+  problems.push_back(LpIneq<T>(1000, 200));
+  problems.push_back(NonNegL2<T>(1000, 200));
+  problems.push_back(Svm<T>(1000, 200));
+  return problems;
+}
+
+#endif  // PROBLEMS_H_
+
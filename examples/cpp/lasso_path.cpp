@@ -1,35 +1,14 @@
-#include <limits>
+#include <cstdio>
 #include <random>
 #include <vector>
 
 #include "matrix/matrix_dense.h"
 #include "pogs.h"
+#include "pogs_path.h"
 #include "timer.h"
 
 using namespace pogs;
 
-template <typename T>
-T MaxDiff(std::vector<T> *v1, std::vector<T> *v2) {
-  T max_diff = 0;
-#ifdef _OPENMP
-#pragma omp parallel for reduction(max : max_diff)
-#endif
-  for (unsigned int i = 0; i < v1->size(); ++i)
-    max_diff = std::max(max_diff, std::abs((*v1)[i] - (*v2)[i]));
-  return max_diff;
-}
-
-template <typename T>
-T Asum(std::vector<T> *v) {
-  T asum = 0;
-#ifdef _OPENMP
-#pragma omp parallel for reduction(+ : asum)
-#endif
-  for (unsigned int i = 0; i < v->size(); ++i)
-    asum += std::abs((*v)[i]);
-  return asum;
-}
-
 // LassoPath
 //   minimize    (1/2) ||Ax - b||_2^2 + \lambda ||x||_1
 //
@@ -40,7 +19,6 @@ double LassoPath(size_t m, size_t n) {
   unsigned int nlambda = 100;
   std::vector<T> A(m * n);
   std::vector<T> b(m);
-  std::vector<T> x_last(n, std::numeric_limits<T>::max());
 
   // Generate data
   std::default_random_engine generator;
@@ -74,7 +52,8 @@ double LassoPath(size_t m, size_t n) {
 
   // Set up pogs datastructure.
   pogs::MatrixDense<T> A_('r', m, n, A.data());
-  pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_);
+  pogs::PogsPath<T, pogs::MatrixDense<T>,
+      pogs::ProjectorDirect<T, pogs::MatrixDense<T> > > pogs_path(A_);
   std::vector<FunctionObj<T> > f;
   std::vector<FunctionObj<T> > g;
   f.reserve(m);
@@ -85,27 +64,37 @@ double LassoPath(size_t m, size_t n) {
 
   for (unsigned int i = 0; i < n; ++i)
     g.emplace_back(kAbs);
-  
-  double t = timer<double>();
-  for (unsigned int i = 0; i < nlambda; ++i) {
-    T lambda = std::exp((std::log(lambda_max) * (nlambda - 1 - i) +
-        static_cast<T>(1e-2) * std::log(lambda_max) * i) / (nlambda - 1));
-
-    for (unsigned int i = 0; i < n; ++i)
-      g[i].c = lambda;
 
-    pogs_data.Solve(f, g);
-
-    std::vector<T> x(n);
-    for (unsigned int i = 0; i < n; ++i)
-      x[i] = pogs_data.GetX()[i];
+  std::vector<T> lambda(nlambda);
+  for (unsigned int i = 0; i < nlambda; ++i)
+    lambda[i] = std::exp((std::log(lambda_max) * (nlambda - 1 - i) +
+        static_cast<T>(1e-2) * std::log(lambda_max) * i) / (nlambda - 1));
+  
+  // Stop once the solution no longer changes.
+  pogs_path.SetStopTol(static_cast<T>(1e-3));
 
-    if (MaxDiff(&x, &x_last) < 1e-3 * Asum(&x))
-      break;
-    x_last = x;
+  double t = timer<double>();
+  pogs_path.Solve(f, g, lambda);
+  t = timer<double>() - t;
+
+  unsigned int num_solved = static_cast<unsigned int>(pogs_path.GetNumSolved());
+  unsigned int num_iter = 0, num_screened = 0, num_violations = 0;
+  for (unsigned int i = 0; i < num_solved; ++i) {
+    num_iter += pogs_path.GetFinalIter(i);
+    num_screened += pogs_path.GetNumScreened(i);
+    num_violations += pogs_path.GetNumViolations(i);
   }
+  printf("Path: %u of %u points, %u iterations, %u variables screened, "
+      "%u KKT violations\n", num_solved, nlambda, num_iter, num_screened,
+      num_violations);
+
+  // Only the first solve should allocate.
+  unsigned int num_alloc = 0;
+  for (unsigned int i = 1; i < num_solved; ++i)
+    num_alloc += pogs_path.GetNumAlloc(i);
+  printf("Allocations after the first solve: %u\n", num_alloc);
 
-  return timer<double>() - t;
+  return t;
 }
 
 template double LassoPath<double>(size_t m, size_t n);
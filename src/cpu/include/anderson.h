@@ -0,0 +1,171 @@
+#ifndef ANDERSON_H_
+#define ANDERSON_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "parallel.h"
+#include "pogs.h"
+
+namespace pogs {
+
+// Anderson acceleration for a fixed-point iteration u := F(u).
+//
+// Keeps the differences of the last mem iterates dU = [u_i+1 - u_i] and of
+// their residuals dF = [f_i+1 - f_i], where f_i = F(u_i) - u_i, and
+// extrapolates
+//
+//   u+ = F(u) - (dU + dF) gamma,
+//
+// where gamma solves the (mem x mem) system
+//
+//   Type-I:  dU^T dF gamma = dU^T f,
+//   Type-II: dF^T dF gamma = dF^T f   (ie. least squares min ||dF gamma - f||).
+//
+// All vectors, and the small system, live in borrowed workspace of length
+// WorkspaceSize(size, mem), so that a solve does not allocate.
+template <typename T>
+class Anderson {
+ private:
+  const size_t _size, _mem;
+  const AndersonType _type;
+  T *_dU, *_dF, *_u_prev, *_f_prev, *_f;
+  size_t _count, _head;
+
+  // Small dense system, of size at most mem x mem.
+  T *_M, *_rhs;
+
+  // Solves _M gamma = _rhs in place (gamma overwrites _rhs) using Gaussian
+  // elimination with partial pivoting. Returns false if _M is singular.
+  bool SolveSmall(size_t k) {
+    for (size_t j = 0; j < k; ++j) {
+      size_t p = j;
+      for (size_t i = j + 1; i < k; ++i)
+        if (std::abs(_M[i * k + j]) > std::abs(_M[p * k + j]))
+          p = i;
+      if (!(std::abs(_M[p * k + j]) > static_cast<T>(0)))
+        return false;
+      if (p != j) {
+        std::swap_ranges(_M + j * k, _M + (j + 1) * k, _M + p * k);
+        std::swap(_rhs[j], _rhs[p]);
+      }
+      for (size_t i = j + 1; i < k; ++i) {
+        T l = _M[i * k + j] / _M[j * k + j];
+        for (size_t jj = j; jj < k; ++jj)
+          _M[i * k + jj] -= l * _M[j * k + jj];
+        _rhs[i] -= l * _rhs[j];
+      }
+    }
+    for (size_t j = k; j-- > 0;) {
+      for (size_t jj = j + 1; jj < k; ++jj)
+        _rhs[j] -= _M[j * k + jj] * _rhs[jj];
+      _rhs[j] /= _M[j * k + j];
+    }
+    for (size_t j = 0; j < k; ++j)
+      if (!std::isfinite(_rhs[j]))
+        return false;
+    return true;
+  }
+
+  T Dot(const T *x, const T *y) const {
+    T dot = static_cast<T>(0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(_size)) \
+    reduction(+:dot) if (_size >= kParallelMinSize)
+#endif
+    for (size_t i = 0; i < _size; ++i)
+      dot += x[i] * y[i];
+    return dot;
+  }
+
+ public:
+  Anderson(size_t size, size_t mem, AndersonType type, T *work)
+      : _size(size), _mem(mem), _type(type),
+        _dU(work), _dF(work + size * mem), _u_prev(work + 2 * size * mem),
+        _f_prev(work + (2 * mem + 1) * size), _f(work + (2 * mem + 2) * size),
+        _count(0), _head(0), _M(work + (2 * mem + 3) * size),
+        _rhs(work + (2 * mem + 3) * size + mem * mem) { }
+
+  static size_t WorkspaceSize(size_t size, size_t mem) {
+    return (2 * mem + 3) * size + mem * mem + mem;
+  }
+
+  // Discards the history, eg. after a change of rho.
+  void Reset() { _count = 0; _head = 0; }
+
+  // Computes and stores the residual f = fu - u, returns ||f||.
+  T Residual(const T *u, const T *fu) {
+    T ssq = static_cast<T>(0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(_size)) \
+    reduction(+:ssq) if (_size >= kParallelMinSize)
+#endif
+    for (size_t i = 0; i < _size; ++i) {
+      T f_i = fu[i] - u[i];
+      _f[i] = f_i;
+      ssq += f_i * f_i;
+    }
+    return std::sqrt(ssq);
+  }
+
+  // Appends (u, f) to the history, with f from the last call to Residual,
+  // and overwrites fu = F(u) with the extrapolated iterate. Returns false
+  // (leaving fu unchanged) if there is no history yet or the system is
+  // singular.
+  bool Apply(const T *u, T *fu) {
+    if (_count > 0) {
+      T *du = _dU + _head * _size;
+      T *df = _dF + _head * _size;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(_size)) \
+    if (_size >= kParallelMinSize)
+#endif
+      for (size_t i = 0; i < _size; ++i) {
+        du[i] = u[i] - _u_prev[i];
+        df[i] = _f[i] - _f_prev[i];
+      }
+      _head = (_head + 1) % _mem;
+    }
+    memcpy(_u_prev, u, _size * sizeof(T));
+    memcpy(_f_prev, _f, _size * sizeof(T));
+    size_t k = std::min(_count, _mem);
+    ++_count;
+    if (k == 0)
+      return false;
+
+    // Form the small system, with Tikhonov regularization for stability.
+    const T *V = _type == ANDERSON_TYPE_I ? _dU : _dF;
+    T trace = static_cast<T>(0);
+    for (size_t i = 0; i < k; ++i) {
+      for (size_t j = 0; j < k; ++j)
+        _M[i * k + j] = Dot(V + i * _size, _dF + j * _size);
+      _rhs[i] = Dot(V + i * _size, _f);
+      trace += std::abs(_M[i * k + i]);
+    }
+    T reg = std::sqrt(std::numeric_limits<T>::epsilon()) * trace;
+    for (size_t i = 0; i < k; ++i)
+      _M[i * k + i] += reg;
+    if (!SolveSmall(k))
+      return false;
+
+    // fu := fu - (dU + dF) gamma.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(_size)) \
+    if (_size >= kParallelMinSize)
+#endif
+    for (size_t i = 0; i < _size; ++i) {
+      T s = static_cast<T>(0);
+      for (size_t j = 0; j < k; ++j)
+        s += (_dU[j * _size + i] + _dF[j * _size + i]) * _rhs[j];
+      fu[i] -= s;
+    }
+    return true;
+  }
+};
+
+}  // namespace pogs
+
+#endif  // ANDERSON_H_
+
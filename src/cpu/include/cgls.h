@@ -31,9 +31,11 @@
 //
 //    min. ||Ax - b||_2^2 + s ||x||_2^2
 //
-//  using the Conjugate Gradient for Least Squares method. This is more stable
-//  than applying CG to the normal equations. Supports both generic operators
-//  for computing Ax and A^Tx as well as a sparse matrix version.
+//  using the Conjugate Gradient for Least Squares method. The gradient
+//  s = A^T(b - Ax) - shift x is updated by a recurrence, which only needs A^TAp
+//  at each iteration, and is recomputed from the residual b - Ax every
+//  kResidualPeriod iterations to keep it from drifting. Supports both generic
+//  operators for computing Ax and A^Tx as well as a sparse matrix version.
 //
 //  ------------------------------ GENERIC  ------------------------------------
 //
@@ -44,7 +46,11 @@
 //               int gemv(char op, T alpha, const T *x, T beta, T *y). Upon
 //               exit, y should take on the value y := alpha*op(A)x + beta*y.
 //               If successful the functor must return 0, otherwise a non-zero
-//               value should be returned.
+//               value should be returned. The functor may also have a method
+//               int AtA(const T *x, T *y, T *z) that sets y := Ax and
+//               z := A^Ty, in which case it is used to compute both products
+//               in one call. Otherwise they are computed with two calls to
+//               gemv.
 //
 //  Function Arguments:
 //  A          - Operator that computes Ax and A^Tx.
@@ -64,6 +70,12 @@
 //
 //  quiet      - Disable printing to console.
 //
+//  work       - Optional pointer to scratch space of length m + 3 * n, which
+//               holds one vector of length m and three of length n. If null,
+//               the scratch space is allocated (and freed) internally.
+//
+//  num_iter   - Optional pointer, set to the number of iterations performed.
+//
 //  ------------------------------ SPARSE --------------------------------------
 //
 //  Template Arguments:
@@ -135,7 +147,7 @@ enum CGLS_ORD { CSC, CSR };
 // changes their API (a la MKL).
 typedef int INT;
 
-// Abstract GEMV-like operator.
+// Abstract GEMV-like operator. Subclasses may also define AtA (see F above).
 template <typename T>
 struct Gemv {
   virtual ~Gemv() { };
@@ -143,6 +155,9 @@ struct Gemv {
                          T *y) const = 0;
 };
 
+// Number of iterations between explicit computations of the residual.
+const int kResidualPeriod = 50;
+
 // File-level functions and classes.
 namespace {
 
@@ -194,30 +209,54 @@ inline double Epsilon<std::complex<float> >() {
   return std::numeric_limits<float>::epsilon();
 }
 
+// Sets y := Ax and z := A^Ty, with F::AtA if F has it and with two calls to
+// the functor otherwise.
+template <typename T, typename F>
+auto AtA(const F& A, const T *x, T *y, T *z, int)
+    -> decltype(A.AtA(x, y, z)) {
+  return A.AtA(x, y, z);
+}
+
+template <typename T, typename F>
+int AtA(const F& A, const T *x, T *y, T *z, long) {
+  int err = A('n', StaticCast<T>(1.), x, StaticCast<T>(0.), y);
+  return err ? err : A('t', StaticCast<T>(1.), y, StaticCast<T>(0.), z);
+}
+
 }  // namespace
 
 // Conjugate Gradient Least Squares.
 template <typename T, typename F>
 int Solve(const F& A, const INT m, const INT n, const T *b, T *x,
-          const double shift, const double tol, const int maxit, bool quiet) {
+          const double shift, const double tol, const int maxit, bool quiet,
+          T *work = 0, int *num_iter = 0) {
   // Variable declarations.
-  gsl::vector<T> p, q, r, s, x_vec;
+  gsl::vector<T> p, q, r, s, t, x_vec;
   double gamma, normp, normq, norms, norms0, normx, xmax;
   char fmt[] = "%5d %9.2e %12.5g\n";
   int err = 0, k = 0, flag = 0, indefinite = 0;
 
   // Constant declarations.
   const T kNegOne   = StaticCast<T>(-1.);
-  const T kZero     = StaticCast<T>( 0.);
   const T kOne      = StaticCast<T>( 1.);
   const T kNegShift = StaticCast<T>(-shift);
   const double kEps = Epsilon<T>();
 
-  // Memory Allocation.
-  p = gsl::vector_alloc<T>(n);
-  q = gsl::vector_alloc<T>(m);
-  r = gsl::vector_alloc<T>(m);
-  s = gsl::vector_alloc<T>(n);
+  // Memory Allocation (or views into work). The residual r is only needed
+  // to compute s, after which s is updated from t = A'*q, so r shares its
+  // storage with q.
+  if (work) {
+    p = gsl::vector_view_array(work, n);
+    q = gsl::vector_view_array(work + n, m);
+    s = gsl::vector_view_array(work + n + m, n);
+    t = gsl::vector_view_array(work + 2 * n + m, n);
+  } else {
+    p = gsl::vector_alloc<T>(n);
+    q = gsl::vector_alloc<T>(m);
+    s = gsl::vector_alloc<T>(n);
+    t = gsl::vector_alloc<T>(n);
+  }
+  r = q;
 
   gsl::vector_memcpy(&r, b);
   gsl::vector_memcpy(&s, x);
@@ -252,9 +291,15 @@ int Solve(const F& A, const INT m, const INT n, const T *b, T *x,
   if (!quiet)
     printf("    k     normx        resNE\n");
 
+  if (num_iter)
+    *num_iter = 0;
+
   for (k = 0; k < maxit && !flag; ++k) {
-    // q = A * p.
-    err = A('n', kOne, p.data, kZero, q.data);
+    if (num_iter)
+      ++*num_iter;
+
+    // q = A * p and t = A' * q, in one pass over A.
+    err = AtA<T>(A, p.data, q.data, t.data, 0);
     if (err) {
       flag = 5;
       break;
@@ -271,18 +316,31 @@ int Solve(const F& A, const INT m, const INT n, const T *b, T *x,
       delta = kEps;
     T alpha = StaticCast<T>(gamma / delta);
     T neg_alpha = StaticCast<T>(-gamma / delta);
+    T neg_alpha_shift = StaticCast<T>(-gamma / delta * shift);
 
     // x = x + alpha*p.
-    // r = r - alpha*q.
     gsl::blas_axpy(alpha, &p, &x_vec);
-    gsl::blas_axpy(neg_alpha, &q, &r);
 
-    // s = A'*r - shift*x.
-    gsl::vector_memcpy(&s, &x_vec);
-    err = A('t', kOne, r.data, kNegShift, s.data);
-    if (err) {
-      flag = 6;
-      break;
+    // s = A'*r - shift*x, where r = r - alpha*q and x = x + alpha*p, ie.
+    // s = s - alpha*(t + shift*p).
+    gsl::blas_axpy(neg_alpha, &t, &s);
+    gsl::blas_axpy(neg_alpha_shift, &p, &s);
+
+    // Replace s by A'*r - shift*x, with r = b - A*x, to discard the rounding
+    // errors accumulated by the recurrence.
+    if ((k + 1) % kResidualPeriod == 0) {
+      gsl::vector_memcpy(&r, b);
+      err = A('n', kNegOne, x_vec.data, kOne, r.data);
+      if (err) {
+        flag = 5;
+        break;
+      }
+      gsl::vector_memcpy(&s, &x_vec);
+      err = A('t', kOne, r.data, kNegShift, s.data);
+      if (err) {
+        flag = 6;
+        break;
+      }
     }
 
     // Compute beta.
@@ -291,9 +349,9 @@ int Solve(const F& A, const INT m, const INT n, const T *b, T *x,
     gamma = norms * norms;
     T beta = StaticCast<T>(gamma / gamma1);
 
-    // p = s + beta*p.
-    gsl::blas_axpy(beta, &p, &s);
-    gsl::vector_memcpy(&p, &s);
+    // p = s + beta*p, keeping s for the next update.
+    gsl::vector_scale(&p, beta);
+    gsl::blas_axpy(kOne, &s, &p);
 
     // Convergence check.
     normx = gsl::blas_nrm2(&x_vec);
@@ -315,10 +373,12 @@ int Solve(const F& A, const INT m, const INT n, const T *b, T *x,
     flag = 4;
 
   // Free variables and return;
-  gsl::vector_free(&p);
-  gsl::vector_free(&q);
-  gsl::vector_free(&r);
-  gsl::vector_free(&s);
+  if (!work) {
+    gsl::vector_free(&p);
+    gsl::vector_free(&q);
+    gsl::vector_free(&s);
+    gsl::vector_free(&t);
+  }
   return flag;
 }
 
@@ -63,7 +63,7 @@ void SetSign(T* x, unsigned char *sign, size_t size, F f) {
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-  for (unsigned int t = 0; t < size; ++t) {
+  for (size_t t = 0; t < size; ++t) {
     sign[t] = 0;
     for (unsigned int i = 0; i < 8; ++i) {
       sign[t] |= static_cast<unsigned char>((x[8 * t + i] < 0) << i);
@@ -86,7 +86,7 @@ void UnSetSign(T* x, unsigned char *sign, size_t size, F f) {
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-  for (unsigned int t = 0; t < size; ++t) {
+  for (size_t t = 0; t < size; ++t) {
     for (unsigned int i = 0; i < 8; ++i) {
       x[8 * t + i] = (1 - 2 * static_cast<int>((sign[t] >> i) & 1)) *
           f(x[8 * t + i]);
@@ -111,14 +111,17 @@ T Norm2Est(const Matrix<T> *A) {
 
   T norm_est = 0, norm_est_last;
   gsl::vector<T> x = gsl::vector_alloc<T>(A->Cols());
+  gsl::vector<T> StSx = gsl::vector_alloc<T>(A->Cols());
   gsl::vector<T> Sx = gsl::vector_alloc<T>(A->Rows());
   gsl::rand(x.data, x.size);
 
   unsigned int i = 0;
   for (i = 0; i < kNormEstMaxIter; ++i) {
     norm_est_last = norm_est;
-    A->Mul('n', static_cast<T>(1.), x.data, static_cast<T>(0.), Sx.data);
-    A->Mul('t', static_cast<T>(1.), Sx.data, static_cast<T>(0.), x.data);
+    // Sx := A * x and StSx := A^T * Sx, in one pass over A.
+    A->MulAtA(static_cast<T>(1.), x.data, Sx.data, static_cast<T>(0.),
+        StSx.data);
+    std::swap(x, StSx);
     T normx = gsl::blas_nrm2(&x);
     T normSx = gsl::blas_nrm2(&Sx);
     gsl::vector_scale(&x, 1 / normx);
@@ -129,6 +132,7 @@ T Norm2Est(const Matrix<T> *A) {
   DEBUG_EXPECT_LT(i, kNormEstMaxIter);
 
   gsl::vector_free(&x);
+  gsl::vector_free(&StSx);
   gsl::vector_free(&Sx);
   return norm_est;
 }
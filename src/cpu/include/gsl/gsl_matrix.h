@@ -111,6 +111,28 @@ matrix<T, O> matrix_view_array(T *base, size_t n1, size_t n2) {
   return mat;
 }
 
+template <typename T, CBLAS_ORDER O>
+matrix<T, O> matrix_view_array_with_tda(const T *base, size_t n1, size_t n2,
+                                        size_t tda) {
+  matrix<T, O> mat;
+  mat.size1 = n1;
+  mat.size2 = n2;
+  mat.tda = tda;
+  mat.data = const_cast<T*>(base);
+  return mat;
+}
+
+template <typename T, CBLAS_ORDER O>
+matrix<T, O> matrix_view_array_with_tda(T *base, size_t n1, size_t n2,
+                                        size_t tda) {
+  matrix<T, O> mat;
+  mat.size1 = n1;
+  mat.size2 = n2;
+  mat.tda = tda;
+  mat.data = base;
+  return mat;
+}
+
 template <typename T, CBLAS_ORDER O>
 inline T matrix_get(const matrix<T, O> *A, size_t i, size_t j) {
   if (O == CblasRowMajor)
@@ -0,0 +1,233 @@
+#ifndef POGS_HELPER_H_
+#define POGS_HELPER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "parallel.h"
+
+namespace pogs {
+namespace {
+
+// Fused vector kernels for the ADMM loop in Pogs::Solve. Each kernel makes a
+// single streaming pass over its operands and replaces a sequence of
+// memcpy/axpy/nrm2/dot calls, while performing the same floating point
+// operations per element (up to reassociation of the reductions).
+//
+// Vectors are laid out as z = (x, y), with x of length n and y of length m.
+
+// Sums of squares and inner products computed by ProxUpdate.
+template <typename T>
+struct ProxSums {
+  T dot;         // <z - z12, z12>
+  T ssq_x;       // ||x - x12||^2
+  T ssq_y;       // ||y - y12||^2
+  T ssq_x12;     // ||x12||^2
+  T ssq_y12;     // ||y12||^2
+};
+
+// zprev := z, z := z - zt.
+template <typename T>
+void ProxPrepare(size_t size, const T *zt, T *z, T *zprev) {
+#ifdef _OPENMP
+#pragma omp parallel for simd schedule(static, ParallelChunk<T>(size)) \
+    if (size >= kParallelMinSize)
+#endif
+  for (size_t i = 0; i < size; ++i) {
+    zprev[i] = z[i];
+    z[i] -= zt[i];
+  }
+}
+
+// Splits the range [begin, begin + chunk) of the partition of z = (x, y) of
+// length size (see parallel.h) into [begin, *mid) in x and [*mid, *end) in y.
+inline void SplitRange(size_t size, size_t n, size_t begin, size_t chunk,
+                       size_t *mid, size_t *end) {
+  *end = std::min(begin + chunk, size);
+  *mid = std::min(std::max(begin, n), *end);
+}
+
+// Computes z := z - z12 and ztemp := zt + alpha z12 + (1 - alpha) zprev over
+// [begin, end), accumulating <z, z12>, ||z||^2 and ||z12||^2 along the way.
+template <typename T>
+void ProxUpdateRange(size_t begin, size_t end, T alpha, const T *z12,
+                     const T *zprev, const T *zt, T *z, T *ztemp, T *dot,
+                     T *ssq_z, T *ssq_z12) {
+  const T kOneMinusAlpha = static_cast<T>(1) - alpha;
+  T dot_ = 0, ssq_z_ = 0, ssq_z12_ = 0;
+#pragma omp simd reduction(+:dot_, ssq_z_, ssq_z12_)
+  for (size_t i = begin; i < end; ++i) {
+    T z12_i = z12[i];
+    T z_i = z[i] - z12_i;
+    z[i] = z_i;
+    dot_ += z_i * z12_i;
+    ssq_z_ += z_i * z_i;
+    ssq_z12_ += z12_i * z12_i;
+    T ztemp_i = zt[i] + alpha * z12_i;
+    ztemp[i] = ztemp_i + kOneMinusAlpha * zprev[i];
+  }
+  *dot += dot_;
+  *ssq_z += ssq_z_;
+  *ssq_z12 += ssq_z12_;
+}
+
+// Everything that happens between the prox and the projection step: updates
+// z := z - z12, applies over-relaxation to form the projection input ztemp,
+// and returns the sums needed for the gap and tolerances. Each thread takes
+// its range of the partition of z and splits it into its x and y parts.
+template <typename T>
+ProxSums<T> ProxUpdate(size_t m, size_t n, T alpha, const T *z12,
+                       const T *zprev, const T *zt, T *z, T *ztemp) {
+  size_t size = m + n;
+  size_t chunk = ParallelChunk<T>(size);
+  T dot = 0, ssq_x = 0, ssq_y = 0, ssq_x12 = 0, ssq_y12 = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) \
+    reduction(+:dot, ssq_x, ssq_y, ssq_x12, ssq_y12) \
+    if (size >= kParallelMinSize)
+#endif
+  for (size_t begin = 0; begin < size; begin += chunk) {
+    size_t mid, end;
+    SplitRange(size, n, begin, chunk, &mid, &end);
+    ProxUpdateRange(begin, mid, alpha, z12, zprev, zt, z, ztemp, &dot,
+        &ssq_x, &ssq_x12);
+    ProxUpdateRange(mid, end, alpha, z12, zprev, zt, z, ztemp, &dot,
+        &ssq_y, &ssq_y12);
+  }
+  ProxSums<T> sums = { dot, ssq_x, ssq_y, ssq_x12, ssq_y12 };
+  return sums;
+}
+
+// Returns ||zprev - z||^2 and ||z12 - z||^2. If exact is true, also sets
+// xtemp := x12 + xt - xprev and ytemp := y12, which are the inputs for the
+// exact residual computation.
+template <typename T>
+void ResidualNorms(size_t m, size_t n, bool exact, const T *z, const T *z12,
+                   const T *zprev, const T *zt, T *ztemp, T *ssq_s,
+                   T *ssq_r) {
+  size_t size = m + n;
+  T ssq_s_ = 0, ssq_r_ = 0;
+  if (exact) {
+    size_t chunk = ParallelChunk<T>(size);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) reduction(+:ssq_s_, ssq_r_) \
+    if (size >= kParallelMinSize)
+#endif
+    for (size_t begin = 0; begin < size; begin += chunk) {
+      size_t mid, end;
+      SplitRange(size, n, begin, chunk, &mid, &end);
+#pragma omp simd reduction(+:ssq_s_, ssq_r_)
+      for (size_t i = begin; i < mid; ++i) {
+        T s_i = zprev[i] - z[i];
+        T r_i = z12[i] - z[i];
+        ssq_s_ += s_i * s_i;
+        ssq_r_ += r_i * r_i;
+        ztemp[i] = (z12[i] + zt[i]) - zprev[i];
+      }
+#pragma omp simd reduction(+:ssq_s_, ssq_r_)
+      for (size_t i = mid; i < end; ++i) {
+        T s_i = zprev[i] - z[i];
+        T r_i = z12[i] - z[i];
+        ssq_s_ += s_i * s_i;
+        ssq_r_ += r_i * r_i;
+        ztemp[i] = z12[i];
+      }
+    }
+  } else {
+#ifdef _OPENMP
+#pragma omp parallel for simd schedule(static, ParallelChunk<T>(size)) \
+    reduction(+:ssq_s_, ssq_r_) if (size >= kParallelMinSize)
+#endif
+    for (size_t i = 0; i < size; ++i) {
+      T s_i = zprev[i] - z[i];
+      T r_i = z12[i] - z[i];
+      ssq_s_ += s_i * s_i;
+      ssq_r_ += r_i * r_i;
+    }
+  }
+  *ssq_s = ssq_s_;
+  *ssq_r = ssq_r_;
+}
+
+// Sets xtemp := x12 + xt - xprev and ytemp := y12 (see ResidualNorms).
+template <typename T>
+void ResidualPrepare(size_t m, size_t n, const T *z12, const T *zprev,
+                     const T *zt, T *ztemp) {
+  size_t size = m + n;
+  size_t chunk = ParallelChunk<T>(size);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) if (size >= kParallelMinSize)
+#endif
+  for (size_t begin = 0; begin < size; begin += chunk) {
+    size_t mid, end;
+    SplitRange(size, n, begin, chunk, &mid, &end);
+#pragma omp simd
+    for (size_t i = begin; i < mid; ++i)
+      ztemp[i] = (z12[i] + zt[i]) - zprev[i];
+#pragma omp simd
+    for (size_t i = mid; i < end; ++i)
+      ztemp[i] = z12[i];
+  }
+}
+
+// Returns ||ytemp||^2 and then sets ytemp := y12 + yt - yprev. All pointers
+// are offset to the y component.
+template <typename T>
+T ResidualSwap(size_t m, const T *y12, const T *yprev, const T *yt,
+               T *ytemp) {
+  T ssq = 0;
+#ifdef _OPENMP
+#pragma omp parallel for simd schedule(static, ParallelChunk<T>(m)) \
+    reduction(+:ssq) if (m >= kParallelMinSize)
+#endif
+  for (size_t i = 0; i < m; ++i) {
+    T r_i = ytemp[i];
+    ssq += r_i * r_i;
+    ytemp[i] = (y12[i] + yt[i]) - yprev[i];
+  }
+  return ssq;
+}
+
+// Dual update zt := scale * (zt + alpha z12 + (1 - alpha) zprev - z), where
+// scale accounts for a change in rho.
+template <typename T>
+void DualUpdate(size_t size, T alpha, T scale, const T *z, const T *z12,
+                const T *zprev, T *zt) {
+  const T kOneMinusAlpha = static_cast<T>(1) - alpha;
+  if (scale == static_cast<T>(1)) {
+#ifdef _OPENMP
+#pragma omp parallel for simd schedule(static, ParallelChunk<T>(size)) \
+    if (size >= kParallelMinSize)
+#endif
+    for (size_t i = 0; i < size; ++i)
+      zt[i] = ((zt[i] + alpha * z12[i]) + kOneMinusAlpha * zprev[i]) - z[i];
+  } else {
+#ifdef _OPENMP
+#pragma omp parallel for simd schedule(static, ParallelChunk<T>(size)) \
+    if (size >= kParallelMinSize)
+#endif
+    for (size_t i = 0; i < size; ++i)
+      zt[i] = scale *
+          (((zt[i] + alpha * z12[i]) + kOneMinusAlpha * zprev[i]) - z[i]);
+  }
+}
+
+// Returns ||x||_inf.
+template <typename T>
+T NormInf(size_t size, const T *x) {
+  T nrm = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(size)) \
+    reduction(max:nrm) if (size >= kParallelMinSize)
+#endif
+  for (size_t i = 0; i < size; ++i)
+    nrm = std::max(nrm, std::abs(x[i]));
+  return nrm;
+}
+
+}  // namespace
+}  // namespace pogs
+
+#endif  // POGS_HELPER_H_
+
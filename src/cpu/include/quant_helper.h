@@ -0,0 +1,165 @@
+#ifndef QUANT_HELPER_H_
+#define QUANT_HELPER_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "parallel.h"
+#include "prox_lib_simd.h"
+
+namespace pogs {
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+///////////////////////// Reduced Precision Formats ////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Each format has a storage type S, Encode, which rounds a float to the
+// nearest value of the format, and Decode, which is branch free, so that the
+// loops over A vectorize.
+
+// bfloat16, the upper 16 bits of a float (8 bit exponent, 7 bit mantissa).
+struct Bf16 {
+  typedef uint16_t S;
+  static S Encode(float x) {
+    uint32_t b = AsBits(x);
+    return static_cast<S>((b + 0x7fffu + ((b >> 16) & 1u)) >> 16);
+  }
+  static __SIMD_INLINE__ float Decode(S q) {
+    return FloatFromBits(static_cast<uint32_t>(q) << 16);
+  }
+};
+
+// IEEE half precision (5 bit exponent, 10 bit mantissa). Values beyond the
+// range of the format (65504) are not handled, as A is normalized.
+struct Fp16 {
+  typedef uint16_t S;
+  static S Encode(float x) {
+    uint32_t sign = (AsBits(x) >> 16) & 0x8000u;
+    float x_abs = std::abs(x);
+    // Subnormals are multiples of 2^-24.
+    if (x_abs < 6.103515625e-05f)
+      return static_cast<S>(sign | static_cast<uint32_t>(
+          std::nearbyint(x_abs * 16777216.f)));
+    uint32_t b = AsBits(x_abs);
+    b += 0xfffu + ((b >> 13) & 1u);
+    return static_cast<S>(sign | ((b >> 13) - (112u << 10)));
+  }
+  // Shifts the exponent and mantissa into place, then rebiases the exponent
+  // by a multiplication by 2^112, which also handles subnormals.
+  static __SIMD_INLINE__ float Decode(S q) {
+    uint32_t b = static_cast<uint32_t>(q);
+    float x_abs = FloatFromBits((b & 0x7fffu) << 13) * 5.192296858534828e+33f;
+    return FloatFromBits(AsBits(x_abs) | ((b & 0x8000u) << 16));
+  }
+};
+
+// 8 bit integers, which are scaled by a factor per row of A.
+struct Int8 {
+  typedef int8_t S;
+  static S Encode(float x) {
+    return static_cast<S>(std::max(-127.f, std::min(127.f,
+        std::nearbyint(x))));
+  }
+  static __SIMD_INLINE__ float Decode(S q) { return static_cast<float>(q); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////// Kernels ////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// Q holds lines (rows or columns) of length len, one after another. The
+// kernels scale line l by a_l and element k of each line by b_k, where a null
+// a or b is taken to be all ones, so that y is computed without a workspace.
+
+// y_l := alpha * a_l * sum_k b_k * Q_lk * x_k + beta * y_l for each line l.
+template <typename T, typename F>
+void QuantDots(size_t lines, size_t len, const typename F::S *Q, const T *a,
+               const T *b, T alpha, const T *x, T beta, T *y) {
+#ifdef _OPENMP
+#pragma omp parallel for if (lines * len >= kParallelMinSize)
+#endif
+  for (size_t l = 0; l < lines; ++l) {
+    const typename F::S *q = Q + l * len;
+    T sum = static_cast<T>(0);
+    if (b) {
+#pragma omp simd reduction(+:sum)
+      for (size_t k = 0; k < len; ++k)
+        sum += static_cast<T>(F::Decode(q[k])) * (b[k] * x[k]);
+    } else {
+#pragma omp simd reduction(+:sum)
+      for (size_t k = 0; k < len; ++k)
+        sum += static_cast<T>(F::Decode(q[k])) * x[k];
+    }
+    T y_l = alpha * (a ? a[l] : static_cast<T>(1)) * sum;
+    y[l] = beta == static_cast<T>(0) ? y_l : y_l + beta * y[l];
+  }
+}
+
+// y_k := alpha * b_k * sum_l a_l * x_l * Q_lk + beta * y_k for each k. Each
+// thread sweeps all lines for its own range of y.
+template <typename T, typename F>
+void QuantAxpys(size_t lines, size_t len, const typename F::S *Q, const T *a,
+                const T *b, T alpha, const T *x, T beta, T *y) {
+  size_t chunk = ParallelChunk<T>(len);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) \
+    if (lines * len >= kParallelMinSize)
+#endif
+  for (size_t begin = 0; begin < len; begin += chunk) {
+    size_t end = std::min(begin + chunk, len);
+    if (beta == static_cast<T>(0))
+      std::fill(y + begin, y + end, static_cast<T>(0));
+    else if (beta != static_cast<T>(1))
+      for (size_t k = begin; k < end; ++k)
+        y[k] *= beta;
+    for (size_t l = 0; l < lines; ++l) {
+      const typename F::S *q = Q + l * len;
+      T w_l = alpha * (a ? a[l] : static_cast<T>(1)) * x[l];
+      if (b) {
+#pragma omp simd
+        for (size_t k = begin; k < end; ++k)
+          y[k] += w_l * (b[k] * static_cast<T>(F::Decode(q[k])));
+      } else {
+#pragma omp simd
+        for (size_t k = begin; k < end; ++k)
+          y[k] += w_l * static_cast<T>(F::Decode(q[k]));
+      }
+    }
+  }
+}
+
+// Computes Q = A ./ s in the format F, where s_i is the scale of row i of the
+// m x n matrix A (1 if scale is false, else max_j |a_ij| / 127), and rounds A
+// to s .* Q. If round is false, A is left unchanged.
+template <typename T, typename F>
+void Quantize(bool row, size_t m, size_t n, bool scale, bool round, T *A,
+              typename F::S *Q, T *s) {
+  std::fill(s, s + m, static_cast<T>(1));
+  if (scale) {
+    std::fill(s, s + m, static_cast<T>(0));
+    for (size_t i = 0; i < m; ++i)
+      for (size_t j = 0; j < n; ++j)
+        s[i] = std::max(s[i], std::abs(A[row ? i * n + j : i + j * m]));
+    for (size_t i = 0; i < m; ++i)
+      s[i] = s[i] > 0 ? s[i] / static_cast<T>(127) : static_cast<T>(1);
+  }
+
+#ifdef _OPENMP
+#pragma omp parallel for if (m * n >= kParallelMinSize)
+#endif
+  for (size_t i = 0; i < m; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      size_t k = row ? i * n + j : i + j * m;
+      Q[k] = F::Encode(static_cast<float>(A[k] / s[i]));
+      if (round)
+        A[k] = s[i] * static_cast<T>(F::Decode(Q[k]));
+    }
+  }
+}
+
+}  // namespace
+}  // namespace pogs
+
+#endif  // QUANT_HELPER_H_
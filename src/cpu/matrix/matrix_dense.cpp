@@ -7,6 +7,9 @@
 #include "equil_helper.h"
 #include "matrix/matrix.h"
 #include "matrix/matrix_dense.h"
+#include "matrix/matrix_file.h"
+#include "parallel.h"
+#include "quant_helper.h"
 #include "util.h"
 
 namespace pogs {
@@ -20,10 +23,20 @@ namespace {
 const NormTypes kNormEquilibrate = kNorm2; 
 const NormTypes kNormNormalize   = kNormFro;
 
+// Size of the row panels of MulAtA, which should stay in the L2 cache.
+const size_t kAtAPanelBytes = static_cast<size_t>(1) << 18;
+
 template<typename T>
 struct CpuData {
   const T *orig_data;
-  CpuData(const T *orig_data) : orig_data(orig_data) { }
+  // Equilibration vectors of a matrix file, if orig_data is equilibrated.
+  const T *equil_d, *equil_e;
+  // Reduced precision copy of A and its row scales (0 at full precision).
+  char *quant;
+  T *quant_scale;
+  CpuData(const T *orig_data, const T *equil_d = 0, const T *equil_e = 0)
+      : orig_data(orig_data), equil_d(equil_d), equil_e(equil_e), quant(0),
+        quant_scale(0) { }
 };
 
 CBLAS_TRANSPOSE_t OpToCblasOp(char trans) {
@@ -38,6 +51,15 @@ template <typename T>
 void MultDiag(const T *d, const T *e, size_t m, size_t n,
               typename MatrixDense<T>::Ord ord, T *data);
 
+template <typename T>
+size_t Compress(typename MatrixDense<T>::Precision precision, bool row,
+                size_t m, size_t n, bool round, T *data, CpuData<T> *info);
+
+template <typename T>
+void QuantMul(typename MatrixDense<T>::Precision precision, bool row,
+              size_t m, size_t n, bool trans_n, T alpha, const T *x, T beta,
+              T *y, const CpuData<T> *info);
+
 }  // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -45,7 +67,7 @@ void MultDiag(const T *d, const T *e, size_t m, size_t n,
 ////////////////////////////////////////////////////////////////////////////////
 template <typename T>
 MatrixDense<T>::MatrixDense(char ord, size_t m, size_t n, const T *data)
-    : Matrix<T>(m, n), _data(0) {
+    : Matrix<T>(m, n), _data(0), _storage(COPY), _precision(FULL) {
   ASSERT(ord == 'r' || ord == 'R' || ord == 'c' || ord == 'C');
   _ord = (ord == 'r' || ord == 'R') ? ROW : COL;
 
@@ -54,20 +76,63 @@ MatrixDense<T>::MatrixDense(char ord, size_t m, size_t n, const T *data)
   this->_info = reinterpret_cast<void*>(info);
 }
 
+template <typename T>
+MatrixDense<T>::MatrixDense(char ord, size_t m, size_t n, T *data,
+                            Storage storage)
+    : Matrix<T>(m, n), _data(0), _storage(storage), _precision(FULL) {
+  ASSERT(ord == 'r' || ord == 'R' || ord == 'c' || ord == 'C');
+  _ord = (ord == 'r' || ord == 'R') ? ROW : COL;
+
+  CpuData<T> *info = new CpuData<T>(data);
+  this->_info = reinterpret_cast<void*>(info);
+}
+
+template <typename T>
+MatrixDense<T>::MatrixDense(const MatrixFile<T>& F)
+    : Matrix<T>(F.Rows(), F.Cols()), _data(0),
+      _ord(F.Order() == 'r' ? ROW : COL),
+      _storage(F.IsEquil() ? IN_PLACE : COPY),
+      _precision(FULL) {
+  ASSERT(!F.IsValid() || !F.IsSparse());
+
+  // An equilibrated matrix is adopted from the (read-only) map, as Equil
+  // does not modify it.
+  CpuData<T> *info = new CpuData<T>(F.Data(), F.D(), F.E());
+  this->_info = reinterpret_cast<void*>(info);
+}
+
 template <typename T>
 MatrixDense<T>::MatrixDense(const MatrixDense<T>& A)
-    : Matrix<T>(A._m, A._n), _data(0), _ord(A._ord) {
+    : Matrix<T>(A._m, A._n), _data(0), _ord(A._ord), _storage(COPY),
+      _precision(A._precision) {
 
+  // An IN_PLACE buffer is handed over to a copy (eg. the one kept by a
+  // solver) made before A is initialized, and A is left without data, so
+  // that the buffer is never shared. Only an equilibrated matrix file, which
+  // Equil does not modify, is shared.
   CpuData<T> *info_A = reinterpret_cast<CpuData<T>*>(A._info);
-  CpuData<T> *info = new CpuData<T>(info_A->orig_data);
+  CpuData<T> *info = new CpuData<T>(info_A->orig_data, info_A->equil_d,
+      info_A->equil_e);
   this->_info = reinterpret_cast<void*>(info);
+  if (A._storage == IN_PLACE && (info_A->equil_d || !A._done_init)) {
+    _storage = IN_PLACE;
+    if (!info_A->equil_d)
+      info_A->orig_data = 0;
+  }
 }
 
 template <typename T>
 MatrixDense<T>::~MatrixDense() {
   CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  delete [] info->quant;
+  delete [] info->quant_scale;
   delete info;
   this->_info = 0;
+
+  if (this->_done_init && _data && _storage == COPY) {
+    ParallelFree(_data);
+    _data = 0;
+  }
 }
 
 template <typename T>
@@ -75,14 +140,27 @@ int MatrixDense<T>::Init() {
   DEBUG_EXPECT(!this->_done_init);
   if (this->_done_init)
     return 1;
-  this->_done_init = true;
 
+  // A matrix constructed from an invalid matrix file has no data.
   CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  if (info->orig_data == 0)
+    return 1;
+  this->_done_init = true;
+
+  // Adopt the caller's buffer, which was passed as non-const to the IN_PLACE
+  // constructor (or is an equilibrated matrix file).
+  if (_storage == IN_PLACE) {
+    _data = const_cast<T*>(info->orig_data);
+    return 0;
+  }
 
   // Copy Matrix to GPU.
-  _data = new T[this->_m * this->_n];
+  _data = ParallelAlloc<T>(this->_m * this->_n);
   ASSERT(_data != 0);
-  memcpy(_data, info->orig_data, this->_m * this->_n * sizeof(T));
+  // Copy with the partition of the parallel loops, so that with first-touch
+  // page placement the pages of A are spread over the threads' memory.
+  ParallelCopy(this->_m * this->_n, info->orig_data, _data);
+  this->_bytes_alloc += this->_m * this->_n * sizeof(T);
 
   return 0;
 }
@@ -92,6 +170,15 @@ int MatrixDense<T>::Mul(char trans, T alpha, const T *x, T beta, T *y) const {
   DEBUG_EXPECT(this->_done_init);
   if (!this->_done_init)
     return 1;
+  ++this->_num_mul;
+
+  const CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  if (info->quant) {
+    ASSERT(trans == 'n' || trans == 'N' || trans == 't' || trans == 'T');
+    QuantMul(_precision, _ord == ROW, this->_m, this->_n,
+        trans == 'n' || trans == 'N', alpha, x, beta, y, info);
+    return 0;
+  }
 
   const gsl::vector<T> x_vec = gsl::vector_view_array<T>(x, this->_n);
   gsl::vector<T> y_vec = gsl::vector_view_array<T>(y, this->_m);
@@ -110,12 +197,93 @@ int MatrixDense<T>::Mul(char trans, T alpha, const T *x, T beta, T *y) const {
   return 0;
 }
 
+template <typename T>
+int MatrixDense<T>::MulBatch(char trans, T alpha, size_t K, const T *x,
+                             size_t ldx, T beta, T *y, size_t ldy) const {
+  DEBUG_EXPECT(this->_done_init);
+  if (!this->_done_init)
+    return 1;
+
+  // The reduced precision kernels are matrix-vector products.
+  if (reinterpret_cast<CpuData<T>*>(this->_info)->quant)
+    return Matrix<T>::MulBatch(trans, alpha, K, x, ldx, beta, y, ldy);
+  this->_num_mul += K;
+
+  // The vectors are stored as the columns of column major matrices, so a row
+  // major A is viewed as its (column major) transpose.
+  CBLAS_TRANSPOSE_t op = OpToCblasOp(trans);
+  size_t x_dim = op == CblasNoTrans ? this->_n : this->_m;
+  size_t y_dim = op == CblasNoTrans ? this->_m : this->_n;
+  const gsl::matrix<T, CblasColMajor> X =
+      gsl::matrix_view_array_with_tda<T, CblasColMajor>(x, x_dim, K, ldx);
+  gsl::matrix<T, CblasColMajor> Y =
+      gsl::matrix_view_array_with_tda<T, CblasColMajor>(y, y_dim, K, ldy);
+
+  if (_ord == ROW) {
+    const gsl::matrix<T, CblasColMajor> At =
+        gsl::matrix_view_array<T, CblasColMajor>(_data, this->_n, this->_m);
+    op = op == CblasNoTrans ? CblasTrans : CblasNoTrans;
+    gsl::blas_gemm(op, CblasNoTrans, alpha, &At, &X, beta, &Y);
+  } else {
+    const gsl::matrix<T, CblasColMajor> A =
+        gsl::matrix_view_array<T, CblasColMajor>(_data, this->_m, this->_n);
+    gsl::blas_gemm(op, CblasNoTrans, alpha, &A, &X, beta, &Y);
+  }
+
+  return 0;
+}
+
+template <typename T>
+int MatrixDense<T>::MulAtA(T alpha, const T *x, T *y, T beta, T *z) const {
+  DEBUG_EXPECT(this->_done_init);
+  if (!this->_done_init)
+    return 1;
+
+  // The rows of a column major A are not contiguous, and the reduced
+  // precision kernels are matrix-vector products, so these take two passes.
+  const CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  if (_ord == COL || info->quant)
+    return Matrix<T>::MulAtA(alpha, x, y, beta, z);
+  this->_num_mul += 2;
+
+  // Compute y_P := P * x and z := alpha * P^T * y_P + z for each panel P of
+  // rows, while P is still in cache.
+  size_t m = this->_m, n = this->_n;
+  size_t panel_rows = std::max(kAtAPanelBytes / (n * sizeof(T)),
+      static_cast<size_t>(1));
+  const gsl::vector<T> x_vec = gsl::vector_view_array<T>(x, n);
+  gsl::vector<T> z_vec = gsl::vector_view_array<T>(z, n);
+  for (size_t row = 0; row < m; row += panel_rows) {
+    size_t rows = std::min(panel_rows, m - row);
+    const gsl::matrix<T, CblasRowMajor> P =
+        gsl::matrix_view_array<T, CblasRowMajor>(_data + row * n, rows, n);
+    gsl::vector<T> y_vec = gsl::vector_view_array<T>(y + row, rows);
+    gsl::blas_gemv(CblasNoTrans, static_cast<T>(1), &P, &x_vec,
+        static_cast<T>(0), &y_vec);
+    gsl::blas_gemv(CblasTrans, alpha, &P, &y_vec,
+        row == 0 ? beta : static_cast<T>(1), &z_vec);
+  }
+
+  return 0;
+}
+
 template <typename T>
 int MatrixDense<T>::Equil(T *d, T *e) {
   DEBUG_ASSERT(this->_done_init);
   if (!this->_done_init)
     return 1;
 
+  // A matrix file may hold the equilibrated matrix and its d and e.
+  CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  if (info->equil_d) {
+    memcpy(d, info->equil_d, this->_m * sizeof(T));
+    memcpy(e, info->equil_e, this->_n * sizeof(T));
+    // The map is read-only, so A itself is not rounded.
+    this->_bytes_alloc += Compress(_precision, _ord == ROW, this->_m,
+        this->_n, false, _data, info);
+    return 0;
+  }
+
   // Number of elements in matrix.
   size_t num_el = this->_m * this->_n;
 
@@ -125,6 +293,7 @@ int MatrixDense<T>::Equil(T *d, T *e) {
   size_t num_sign_bytes = (num_el + 7) / 8;
   sign = new unsigned char[num_sign_bytes];
   ASSERT(sign != 0);
+  this->_bytes_alloc += num_sign_bytes;
 
   // Fill sign bits, assigning each thread a multiple of 8 elements.
   size_t num_chars = num_el / 8;
@@ -193,9 +362,22 @@ int MatrixDense<T>::Equil(T *d, T *e) {
 
   delete [] sign;
 
+  // Store the equilibrated A at reduced precision, if requested.
+  this->_bytes_alloc += Compress(_precision, _ord == ROW, this->_m, this->_n,
+      true, _data, info);
+
   return 0;
 }
 
+template <typename T>
+void MatrixDense<T>::FreeData() {
+  const CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  if (!this->_done_init || !info->quant || _storage != COPY || !_data)
+    return;
+  ParallelFree(_data);
+  _data = 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /////////////////////// Equilibration Helpers //////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -227,7 +409,8 @@ T NormEst(NormTypes norm_type, const MatrixDense<T>& A) {
 template <typename T>
 void MultRow(size_t m, size_t n, const T *d, const T *e, T *data) {
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel for schedule(static, ParallelChunk<T>(m * n)) \
+    if (m * n >= kParallelMinSize)
 #endif
   for (size_t t = 0; t < m * n; ++t)
     data[t] *= d[t / n] * e[t % n];
@@ -237,7 +420,8 @@ void MultRow(size_t m, size_t n, const T *d, const T *e, T *data) {
 template <typename T>
 void MultCol(size_t m, size_t n, const T *d, const T *e, T *data) {
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel for schedule(static, ParallelChunk<T>(m * n)) \
+    if (m * n >= kParallelMinSize)
 #endif
   for (size_t t = 0; t < m * n; ++t)
     data[t] *= d[t % m] * e[t / m];
@@ -253,6 +437,82 @@ void MultDiag(const T *d, const T *e, size_t m, size_t n,
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/////////////////////// Reduced Precision Helpers //////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+
+// Stores A in the format F in info, and returns the number of bytes
+// allocated.
+template <typename T, typename F>
+size_t CompressF(bool row, size_t m, size_t n, bool scale, bool round,
+                 T *data, CpuData<T> *info) {
+  typedef typename F::S S;
+  info->quant = new char[m * n * sizeof(S)];
+  info->quant_scale = new T[m];
+  ASSERT(info->quant != 0 && info->quant_scale != 0);
+  Quantize<T, F>(row, m, n, scale, round, data,
+      reinterpret_cast<S*>(info->quant), info->quant_scale);
+  return m * n * sizeof(S) + m * sizeof(T);
+}
+
+template <typename T>
+size_t Compress(typename MatrixDense<T>::Precision precision, bool row,
+                size_t m, size_t n, bool round, T *data, CpuData<T> *info) {
+  switch (precision) {
+    case MatrixDense<T>::BF16:
+      return CompressF<T, Bf16>(row, m, n, false, round, data, info);
+    case MatrixDense<T>::FP16:
+      return CompressF<T, Fp16>(row, m, n, false, round, data, info);
+    case MatrixDense<T>::INT8:
+      return CompressF<T, Int8>(row, m, n, true, round, data, info);
+    case MatrixDense<T>::FULL:
+    default:
+      return 0;
+  }
+}
+
+// Computes y := alpha * S * Q * x + beta * y (trans_n) or
+// y := alpha * Q^T * S * x + beta * y, where A = S * Q and S = diag(s). Mul
+// is const and may run concurrently, so the kernels use no workspace.
+template <typename T, typename F>
+void QuantMulF(bool row, size_t m, size_t n, bool trans_n, T alpha,
+               const T *x, T beta, T *y, const CpuData<T> *info) {
+  const typename F::S *Q = reinterpret_cast<const typename F::S*>(info->quant);
+  const T *s = info->quant_scale;
+
+  if (trans_n) {
+    if (row)
+      QuantDots<T, F>(m, n, Q, s, 0, alpha, x, beta, y);
+    else
+      QuantAxpys<T, F>(n, m, Q, 0, s, alpha, x, beta, y);
+  } else {
+    if (row)
+      QuantAxpys<T, F>(m, n, Q, s, 0, alpha, x, beta, y);
+    else
+      QuantDots<T, F>(n, m, Q, 0, s, alpha, x, beta, y);
+  }
+}
+
+template <typename T>
+void QuantMul(typename MatrixDense<T>::Precision precision, bool row,
+              size_t m, size_t n, bool trans_n, T alpha, const T *x, T beta,
+              T *y, const CpuData<T> *info) {
+  switch (precision) {
+    case MatrixDense<T>::BF16:
+      QuantMulF<T, Bf16>(row, m, n, trans_n, alpha, x, beta, y, info);
+      break;
+    case MatrixDense<T>::FP16:
+      QuantMulF<T, Fp16>(row, m, n, trans_n, alpha, x, beta, y, info);
+      break;
+    case MatrixDense<T>::INT8:
+      QuantMulF<T, Int8>(row, m, n, trans_n, alpha, x, beta, y, info);
+      break;
+    case MatrixDense<T>::FULL:
+    default:
+      ASSERT(false);
+  }
+}
+
 }  // namespace
 
 // Explicit template instantiation.
@@ -0,0 +1,384 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "gsl/gsl_blas.h"
+#include "gsl/gsl_matrix.h"
+#include "gsl/gsl_vector.h"
+#include "equil_helper.h"
+#include "interface_defs.h"
+#include "matrix/matrix.h"
+#include "matrix/matrix_dense_stream.h"
+#include "matrix/matrix_file.h"
+#include "parallel.h"
+#include "util.h"
+
+namespace pogs {
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////// Helper Functions ////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+// Reads size bytes at offset of the file fd into buf, retrying reads that
+// are interrupted by a signal. Returns 0 on success and 1 if the file cannot
+// be read or ends early.
+int ReadAll(int fd, size_t offset, size_t size, char *buf) {
+  while (size > 0) {
+    ssize_t num_read = pread(fd, buf, size, static_cast<off_t>(offset));
+    if (num_read < 0 && errno == EINTR)
+      continue;
+    if (num_read <= 0)
+      return 1;
+    buf += num_read;
+    offset += static_cast<size_t>(num_read);
+    size -= static_cast<size_t>(num_read);
+  }
+  return 0;
+}
+
+// Reads the header of the matrix file at path, which must hold a row major
+// dense matrix of T. Returns an all zero header (ie. an empty matrix) if it
+// does not.
+template <typename T>
+MatrixFileHeader ReadStreamHeader(const char *path) {
+  MatrixFileHeader hdr;
+  if (ReadMatrixFileHeader(path, &hdr) != 0) {
+    memset(&hdr, 0, sizeof(hdr));
+  } else if (hdr.sparse || hdr.ord != 'r' || hdr.real_size != sizeof(T)) {
+    Printf("ERROR Matrix file %s: not a row major dense matrix of this type\n",
+        path);
+    memset(&hdr, 0, sizeof(hdr));
+  }
+  return hdr;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+/////////////////// MatrixDenseStream Implementation ///////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+MatrixDenseStream<T>::MatrixDenseStream(const char *path, size_t panel_rows)
+    : MatrixDenseStream(ReadStreamHeader<T>(path), path, panel_rows) { }
+
+template <typename T>
+MatrixDenseStream<T>::MatrixDenseStream(const MatrixFileHeader& hdr,
+                                        const char *path, size_t panel_rows)
+    : Matrix<T>(hdr.m, hdr.n), _path(path), _hdr(hdr),
+      _panel_rows(panel_rows), _fd(-1), _d(0), _e(0), _work(0),
+      _squared(false) {
+  if (_panel_rows == 0 && this->_n > 0)
+    _panel_rows = std::max(kStreamPanelBytes / (this->_n * sizeof(T)),
+        static_cast<size_t>(1));
+  _panel_rows = std::min(_panel_rows, this->_m);
+  _buf[0] = _buf[1] = 0;
+}
+
+template <typename T>
+MatrixDenseStream<T>::MatrixDenseStream(const MatrixDenseStream<T>& A)
+    : Matrix<T>(A._m, A._n), _path(A._path), _hdr(A._hdr),
+      _panel_rows(A._panel_rows), _fd(-1), _d(0), _e(0), _work(0),
+      _squared(false) {
+  _buf[0] = _buf[1] = 0;
+}
+
+template <typename T>
+MatrixDenseStream<T>::~MatrixDenseStream() {
+  if (this->_done_init) {
+    close(_fd);
+    delete [] _buf[0];
+    delete [] _buf[1];
+    delete [] _d;
+    delete [] _e;
+    delete [] _work;
+    _buf[0] = _buf[1] = _d = _e = _work = 0;
+  }
+}
+
+template <typename T>
+int MatrixDenseStream<T>::Init() {
+  DEBUG_EXPECT(!this->_done_init);
+  if (this->_done_init)
+    return 1;
+
+  // The file could not be read (see ReadStreamHeader).
+  if (this->_m == 0)
+    return 1;
+  _fd = open(_path.c_str(), O_RDONLY);
+  if (_fd == -1) {
+    Printf("ERROR Cannot open matrix file %s\n", _path.c_str());
+    return 1;
+  }
+  this->_done_init = true;
+
+  size_t panel_size = _panel_rows * this->_n;
+  _buf[0] = new T[panel_size];
+  _buf[1] = new T[panel_size];
+  _work = new T[this->_m + 2 * this->_n];
+  ASSERT(_buf[0] != 0 && _buf[1] != 0 && _work != 0);
+  this->_bytes_alloc += (2 * panel_size + this->_m + 2 * this->_n) *
+      sizeof(T);
+
+  // A matrix of at most two panels stays in the buffers.
+  int err = 0;
+  for (size_t p = 0; p < NumPanels() && NumPanels() <= 2; ++p)
+    ReadPanel(p, _buf[p], &err);
+
+  return err;
+}
+
+template <typename T>
+void MatrixDenseStream<T>::ReadPanel(size_t p, T *buf, int *err) const {
+  size_t row = p * _panel_rows;
+  size_t rows = std::min(_panel_rows, this->_m - row);
+  if (ReadAll(_fd, _hdr.data_offset + row * this->_n * sizeof(T),
+      rows * this->_n * sizeof(T), reinterpret_cast<char*>(buf)) != 0) {
+    Printf("ERROR Cannot read matrix file %s\n", _path.c_str());
+    *err = 1;
+  }
+}
+
+template <typename T>
+void MatrixDenseStream<T>::MulPanel(char trans, const T *panel, size_t rows,
+                                    const T *x, T *y) const {
+  size_t n = this->_n;
+  if (!_squared) {
+    const gsl::matrix<T, CblasRowMajor> P =
+        gsl::matrix_view_array<T, CblasRowMajor>(panel, rows, n);
+    if (trans == 'n') {
+      const gsl::vector<T> x_vec = gsl::vector_view_array<T>(x, n);
+      gsl::vector<T> y_vec = gsl::vector_view_array<T>(y, rows);
+      gsl::blas_gemv(CblasNoTrans, static_cast<T>(1), &P, &x_vec,
+          static_cast<T>(0), &y_vec);
+    } else {
+      const gsl::vector<T> x_vec = gsl::vector_view_array<T>(x, rows);
+      gsl::vector<T> y_vec = gsl::vector_view_array<T>(y, n);
+      gsl::blas_gemv(CblasTrans, static_cast<T>(1), &P, &x_vec,
+          static_cast<T>(1), &y_vec);
+    }
+  } else if (trans == 'n') {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(rows)) \
+    if (rows * n >= kParallelMinSize)
+#endif
+    for (size_t i = 0; i < rows; ++i) {
+      T y_i = static_cast<T>(0);
+      for (size_t j = 0; j < n; ++j)
+        y_i += panel[i * n + j] * panel[i * n + j] * x[j];
+      y[i] = y_i;
+    }
+  } else {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(n)) \
+    if (rows * n >= kParallelMinSize)
+#endif
+    for (size_t j = 0; j < n; ++j) {
+      T y_j = static_cast<T>(0);
+      for (size_t i = 0; i < rows; ++i)
+        y_j += panel[i * n + j] * panel[i * n + j] * x[i];
+      y[j] += y_j;
+    }
+  }
+}
+
+template <typename T>
+int MatrixDenseStream<T>::Mul(char trans, T alpha, const T *x, T beta,
+                              T *y) const {
+  DEBUG_EXPECT(this->_done_init);
+  if (!this->_done_init)
+    return 1;
+  ++this->_num_mul;
+
+  size_t m = this->_m, n = this->_n;
+  bool trans_n = trans == 'n' || trans == 'N';
+  ASSERT(trans_n || trans == 't' || trans == 'T');
+
+  // With equilibration, D * A * E * x = D * (A * (E * x)) and
+  // E * A^T * D * x = E * (A^T * (D * x)). The scaled input goes to xs and
+  // the output of the panels to ys.
+  T *xs = _work, *ys = _work + (trans_n ? n : m);
+  if (trans_n) {
+    for (size_t j = 0; j < n; ++j)
+      xs[j] = _e ? _e[j] * x[j] : x[j];
+  } else {
+    for (size_t i = 0; i < m; ++i)
+      xs[i] = alpha * (_d ? _d[i] * x[i] : x[i]);
+    std::fill(ys, ys + n, static_cast<T>(0));
+  }
+
+  // Read panel p + 1 while multiplying by panel p.
+  size_t num_panels = NumPanels();
+  bool resident = num_panels <= 2;
+  // The reader only sets err, which is checked once it has been joined.
+  std::thread reader;
+  int err = 0;
+  if (!resident)
+    reader = std::thread(&MatrixDenseStream<T>::ReadPanel, this, 0, _buf[0],
+        &err);
+  for (size_t p = 0; p < num_panels; ++p) {
+    if (!resident) {
+      reader.join();
+      if (err)
+        return 1;
+      if (p + 1 < num_panels)
+        reader = std::thread(&MatrixDenseStream<T>::ReadPanel, this, p + 1,
+            _buf[(p + 1) % 2], &err);
+    }
+    const T *panel = _buf[p % 2];
+    size_t row = p * _panel_rows;
+    size_t rows = std::min(_panel_rows, m - row);
+
+    if (trans_n) {
+      MulPanel('n', panel, rows, xs, ys);
+      for (size_t i = 0; i < rows; ++i) {
+        T y_i = alpha * (_d ? _d[row + i] * ys[i] : ys[i]);
+        y[row + i] = beta == static_cast<T>(0) ? y_i : y_i + beta * y[row + i];
+      }
+    } else {
+      MulPanel('t', panel, rows, xs + row, ys);
+    }
+  }
+
+  if (!trans_n) {
+    for (size_t j = 0; j < n; ++j) {
+      T y_j = _e ? _e[j] * ys[j] : ys[j];
+      y[j] = beta == static_cast<T>(0) ? y_j : y_j + beta * y[j];
+    }
+  }
+
+  return 0;
+}
+
+template <typename T>
+int MatrixDenseStream<T>::MulAtA(T alpha, const T *x, T *y, T beta,
+                                 T *z) const {
+  DEBUG_EXPECT(this->_done_init);
+  if (!this->_done_init)
+    return 1;
+  this->_num_mul += 2;
+
+  size_t m = this->_m, n = this->_n;
+
+  // Read A once, computing y_P := D_P * P * (E * x) and adding P^T * D_P * y_P
+  // to ys for each panel P, then z := alpha * E * ys + beta * z. The scaled
+  // input goes to xs and D * y to dy.
+  T *xs = _work, *ys = _work + n, *dy = _work + 2 * n;
+  for (size_t j = 0; j < n; ++j)
+    xs[j] = _e ? _e[j] * x[j] : x[j];
+  std::fill(ys, ys + n, static_cast<T>(0));
+
+  size_t num_panels = NumPanels();
+  bool resident = num_panels <= 2;
+  // The reader only sets err, which is checked once it has been joined.
+  std::thread reader;
+  int err = 0;
+  if (!resident)
+    reader = std::thread(&MatrixDenseStream<T>::ReadPanel, this, 0, _buf[0],
+        &err);
+  for (size_t p = 0; p < num_panels; ++p) {
+    if (!resident) {
+      reader.join();
+      if (err)
+        return 1;
+      if (p + 1 < num_panels)
+        reader = std::thread(&MatrixDenseStream<T>::ReadPanel, this, p + 1,
+            _buf[(p + 1) % 2], &err);
+    }
+    const T *panel = _buf[p % 2];
+    size_t row = p * _panel_rows;
+    size_t rows = std::min(_panel_rows, m - row);
+
+    MulPanel('n', panel, rows, xs, y + row);
+    for (size_t i = row; i < row + rows; ++i) {
+      y[i] = _d ? _d[i] * y[i] : y[i];
+      dy[i] = _d ? _d[i] * y[i] : y[i];
+    }
+    MulPanel('t', panel, rows, dy + row, ys);
+  }
+
+  for (size_t j = 0; j < n; ++j) {
+    T z_j = alpha * (_e ? _e[j] * ys[j] : ys[j]);
+    z[j] = beta == static_cast<T>(0) ? z_j : z_j + beta * z[j];
+  }
+
+  return 0;
+}
+
+template <typename T>
+int MatrixDenseStream<T>::Equil(T *d, T *e) {
+  DEBUG_ASSERT(this->_done_init);
+  if (!this->_done_init)
+    return 1;
+
+  size_t m = this->_m, n = this->_n;
+
+  // The file may hold the equilibrated matrix and its d and e.
+  if (_hdr.equil) {
+    if (ReadAll(_fd, _hdr.d_offset, m * sizeof(T),
+        reinterpret_cast<char*>(d)) != 0 || ReadAll(_fd, _hdr.e_offset,
+        n * sizeof(T), reinterpret_cast<char*>(e)) != 0) {
+      Printf("ERROR Cannot read matrix file %s\n", _path.c_str());
+      return 1;
+    }
+    return 0;
+  }
+
+  // Perform Sinkhorn-Knopp equilibration on A.^2, then compute
+  // D := sqrt(D), E := sqrt(E), as MatrixDense does.
+  _squared = true;
+  SinkhornKnopp(this, d, e);
+  std::transform(d, d + m, d, SqrtF<T>());
+  std::transform(e, e + n, e, SqrtF<T>());
+
+  // Scale A to have Frobenius norm 1 (divided by sqrt(min(m, n))), where
+  // ||D * A * E||_F^2 = (d.^2)^T * A.^2 * (e.^2).
+  std::vector<T> d2(m), e2(n);
+  for (size_t i = 0; i < m; ++i)
+    d2[i] = d[i] * d[i];
+  for (size_t j = 0; j < n; ++j)
+    e2[j] = e[j] * e[j];
+  std::vector<T> Ae2(m);
+  Mul('n', static_cast<T>(1), e2.data(), static_cast<T>(0), Ae2.data());
+  _squared = false;
+  T normA = static_cast<T>(0);
+  for (size_t i = 0; i < m; ++i)
+    normA += d2[i] * Ae2[i];
+  normA = std::sqrt(normA) / std::sqrt(static_cast<T>(std::min(m, n)));
+
+  // Scale d and e to account for normalization of A.
+  gsl::vector<T> d_vec = gsl::vector_view_array<T>(d, m);
+  gsl::vector<T> e_vec = gsl::vector_view_array<T>(e, n);
+  gsl::vector_scale(&d_vec, 1 / std::sqrt(normA));
+  gsl::vector_scale(&e_vec, 1 / std::sqrt(normA));
+
+  // Mul applies D and E from here on.
+  _d = new T[m];
+  _e = new T[n];
+  ASSERT(_d != 0 && _e != 0);
+  this->_bytes_alloc += (m + n) * sizeof(T);
+  std::copy(d, d + m, _d);
+  std::copy(e, e + n, _e);
+
+  DEBUG_PRINTF("norm A = %e, normd = %e, norme = %e\n", normA,
+      gsl::blas_nrm2(&d_vec), gsl::blas_nrm2(&e_vec));
+
+  return 0;
+}
+
+// Explicit template instantiation.
+#if !defined(POGS_DOUBLE) || POGS_DOUBLE==1
+template class MatrixDenseStream<double>;
+#endif
+
+#if !defined(POGS_SINGLE) || POGS_SINGLE==1
+template class MatrixDenseStream<float>;
+#endif
+
+}  // namespace pogs
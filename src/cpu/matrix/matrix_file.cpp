@@ -0,0 +1,307 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "interface_defs.h"
+#include "matrix/matrix_dense.h"
+#include "matrix/matrix_file.h"
+#include "matrix/matrix_sparse.h"
+#include "util.h"
+
+namespace pogs {
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////// Helper Functions ////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+uint64_t AlignUp(uint64_t offset) {
+  return (offset + kMatrixFileAlign - 1) / kMatrixFileAlign * kMatrixFileAlign;
+}
+
+// Appends the array x of size bytes at the next aligned offset of the file,
+// and returns the offset.
+uint64_t AppendArray(FILE *fp, uint64_t *offset, const void *x, size_t size) {
+  static const char kZero[kMatrixFileAlign] = { 0 };
+  uint64_t begin = AlignUp(*offset);
+  if (fwrite(kZero, 1, begin - *offset, fp) != begin - *offset ||
+      fwrite(x, 1, size, fp) != size)
+    return 0;
+  *offset = begin + size;
+  return begin;
+}
+
+// Returns true if the array of count elements of elem_size bytes at offset is
+// aligned and lies within the first file_size bytes of the file.
+bool ArrayInFile(uint64_t offset, uint64_t count, uint64_t elem_size,
+                 uint64_t file_size) {
+  return offset != 0 && offset % kMatrixFileAlign == 0 &&
+      offset <= file_size && count <= (file_size - offset) / elem_size;
+}
+
+// Checks that the header hdr of a file of file_size bytes describes a matrix
+// whose arrays lie within the file. Returns 0 on success, otherwise prints an
+// error and returns 1.
+int CheckHeader(const MatrixFileHeader &hdr, uint64_t file_size,
+                const char *path) {
+  const uint64_t kMax = std::numeric_limits<uint64_t>::max();
+  const char *err = 0;
+  if (memcmp(hdr.magic, kMatrixFileMagic, sizeof(hdr.magic)) != 0) {
+    err = "not a matrix file";
+  } else if (hdr.version != kMatrixFileVersion) {
+    err = "unsupported version";
+  } else if ((hdr.real_size != sizeof(float) &&
+      hdr.real_size != sizeof(double)) || hdr.int_size != sizeof(POGS_INT) ||
+      hdr.sparse > 1 || hdr.equil > 1 || (hdr.ord != 'r' && hdr.ord != 'c')) {
+    err = "invalid header";
+  } else if (hdr.file_size > file_size) {
+    err = "truncated file";
+  } else if (hdr.m == 0 || hdr.n == 0 || hdr.m > kMax / hdr.n ||
+      hdr.m + hdr.n + 2 < hdr.m) {
+    err = "invalid dimensions";
+  } else if (hdr.sparse && (hdr.nnz > hdr.m * hdr.n || hdr.nnz >
+      static_cast<uint64_t>(std::numeric_limits<POGS_INT>::max()))) {
+    err = "invalid number of nonzeros";
+  } else {
+    uint64_t size = hdr.file_size;
+    bool ok = hdr.sparse ?
+        ArrayInFile(hdr.data_offset, 2 * hdr.nnz, hdr.real_size, size) &&
+        ArrayInFile(hdr.ind_offset, 2 * hdr.nnz, hdr.int_size, size) &&
+        ArrayInFile(hdr.ptr_offset, hdr.m + hdr.n + 2, hdr.int_size, size) :
+        ArrayInFile(hdr.data_offset, hdr.m * hdr.n, hdr.real_size, size);
+    if (hdr.equil) {
+      ok = ok && ArrayInFile(hdr.d_offset, hdr.m, hdr.real_size, size) &&
+          ArrayInFile(hdr.e_offset, hdr.n, hdr.real_size, size);
+    }
+    if (!ok)
+      err = "array outside of the file";
+  }
+  if (err) {
+    Printf("ERROR Matrix file %s: %s\n", path, err);
+    return 1;
+  }
+  return 0;
+}
+
+// Returns true if ptr (of size num_ptr) and ind describe one compressed form
+// of a matrix with nnz nonzeros, whose minor dimension is size: ptr rises from
+// 0 to nnz and every index lies in [0, size).
+bool CheckCompressed(const POGS_INT *ptr, size_t num_ptr, const POGS_INT *ind,
+                     POGS_INT nnz, uint64_t size) {
+  if (ptr[0] != 0 || ptr[num_ptr - 1] != nnz)
+    return false;
+  for (size_t i = 0; i + 1 < num_ptr; ++i) {
+    if (ptr[i + 1] < ptr[i])
+      return false;
+  }
+  for (POGS_INT k = 0; k < nnz; ++k) {
+    if (ind[k] < 0 || static_cast<uint64_t>(ind[k]) >= size)
+      return false;
+  }
+  return true;
+}
+
+// Checks the arrays ptr and ind of the sparse matrix of header hdr, which
+// hold the form ord followed by the other form, so that Mul does not index
+// outside of them. Returns 0 on success, otherwise prints an error and
+// returns 1.
+int CheckSparse(const MatrixFileHeader &hdr, const POGS_INT *ptr,
+                const POGS_INT *ind, const char *path) {
+  POGS_INT nnz = static_cast<POGS_INT>(hdr.nnz);
+  size_t num_major = static_cast<size_t>(hdr.ord == 'r' ? hdr.m : hdr.n);
+  size_t num_minor = static_cast<size_t>(hdr.ord == 'r' ? hdr.n : hdr.m);
+  if (!CheckCompressed(ptr, num_major + 1, ind, nnz, num_minor) ||
+      !CheckCompressed(ptr + num_major + 1, num_minor + 1, ind + nnz, nnz,
+      num_major)) {
+    Printf("ERROR Matrix file %s: invalid sparse indices\n", path);
+    return 1;
+  }
+  return 0;
+}
+
+// Writes the header hdr and the arrays of the matrix. Returns 0 on success.
+template <typename T>
+int WriteFile(const char *path, MatrixFileHeader *hdr, const T *data,
+              size_t data_size, const POGS_INT *ind, size_t ind_size,
+              const POGS_INT *ptr, size_t ptr_size, const T *d, const T *e) {
+  FILE *fp = fopen(path, "wb");
+  if (fp == 0)
+    return 1;
+
+  memcpy(hdr->magic, kMatrixFileMagic, sizeof(hdr->magic));
+  hdr->version = kMatrixFileVersion;
+  hdr->equil = d != 0 && e != 0;
+  hdr->real_size = sizeof(T);
+  hdr->int_size = sizeof(POGS_INT);
+
+  // Write a placeholder header, followed by the arrays, then the header with
+  // the offsets of the arrays.
+  uint64_t offset = sizeof(MatrixFileHeader);
+  bool ok = fwrite(hdr, sizeof(MatrixFileHeader), 1, fp) == 1;
+  ok = ok && (hdr->data_offset =
+      AppendArray(fp, &offset, data, data_size * sizeof(T))) != 0;
+  if (ind)
+    ok = ok && (hdr->ind_offset =
+        AppendArray(fp, &offset, ind, ind_size * sizeof(POGS_INT))) != 0;
+  if (ptr)
+    ok = ok && (hdr->ptr_offset =
+        AppendArray(fp, &offset, ptr, ptr_size * sizeof(POGS_INT))) != 0;
+  if (hdr->equil) {
+    ok = ok && (hdr->d_offset =
+        AppendArray(fp, &offset, d, hdr->m * sizeof(T))) != 0;
+    ok = ok && (hdr->e_offset =
+        AppendArray(fp, &offset, e, hdr->n * sizeof(T))) != 0;
+  }
+  hdr->file_size = offset;
+  ok = ok && fseek(fp, 0, SEEK_SET) == 0 &&
+      fwrite(hdr, sizeof(MatrixFileHeader), 1, fp) == 1;
+
+  return (fclose(fp) == 0 && ok) ? 0 : 1;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+/////////////////////// MatrixFile Implementation //////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+int ReadMatrixFileHeader(const char *path, MatrixFileHeader *hdr) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == 0) {
+    Printf("ERROR Cannot open matrix file %s\n", path);
+    return 1;
+  }
+  struct stat st;
+  bool ok = fstat(fileno(fp), &st) == 0 &&
+      fread(hdr, sizeof(MatrixFileHeader), 1, fp) == 1;
+  fclose(fp);
+  if (!ok) {
+    Printf("ERROR Cannot read matrix file %s\n", path);
+    return 1;
+  }
+  return CheckHeader(*hdr, static_cast<uint64_t>(st.st_size), path);
+}
+
+template <typename T>
+MatrixFile<T>::MatrixFile(const char *path)
+    : _map(0), _size(0), _valid(false) {
+  memset(&_hdr, 0, sizeof(_hdr));
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    Printf("ERROR Cannot open matrix file %s\n", path);
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(MatrixFileHeader)) {
+    Printf("ERROR Cannot read matrix file %s\n", path);
+    close(fd);
+    return;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  void *map = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    Printf("ERROR Cannot map matrix file %s\n", path);
+    return;
+  }
+
+  MatrixFileHeader hdr;
+  memcpy(&hdr, map, sizeof(hdr));
+  int err = CheckHeader(hdr, size, path);
+  if (err == 0 && hdr.real_size != sizeof(T)) {
+    Printf("ERROR Matrix file %s: wrong value type\n", path);
+    err = 1;
+  }
+  if (err) {
+    munmap(map, size);
+    return;
+  }
+
+  // Read the file ahead, with huge pages where the kernel supports them for
+  // file maps.
+  madvise(map, size, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+  madvise(map, size, MADV_HUGEPAGE);
+#endif
+
+  // MatrixSparse adopts the indices as they are, so check them once here.
+  const char *base = reinterpret_cast<const char*>(map);
+  if (hdr.sparse && CheckSparse(hdr,
+      reinterpret_cast<const POGS_INT*>(base + hdr.ptr_offset),
+      reinterpret_cast<const POGS_INT*>(base + hdr.ind_offset), path) != 0) {
+    munmap(map, size);
+    return;
+  }
+  _map = map;
+  _size = size;
+  _hdr = hdr;
+  _valid = true;
+}
+
+template <typename T>
+MatrixFile<T>::~MatrixFile() {
+  if (_map)
+    munmap(_map, _size);
+  _map = 0;
+}
+
+template <typename T>
+int WriteMatrixFile(const char *path, const MatrixDense<T>& A, const T *d,
+                    const T *e) {
+  DEBUG_ASSERT(A.IsInit());
+  if (!A.IsInit())
+    return 1;
+
+  MatrixFileHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.sparse = 0;
+  hdr.ord = A.Order() == MatrixDense<T>::ROW ? 'r' : 'c';
+  hdr.m = A.Rows();
+  hdr.n = A.Cols();
+  return WriteFile(path, &hdr, A.Data(), A.Rows() * A.Cols(),
+      static_cast<const POGS_INT*>(0), 0, static_cast<const POGS_INT*>(0), 0,
+      d, e);
+}
+
+template <typename T>
+int WriteMatrixFile(const char *path, const MatrixSparse<T>& A, const T *d,
+                    const T *e) {
+  DEBUG_ASSERT(A.IsInit());
+  if (!A.IsInit())
+    return 1;
+
+  MatrixFileHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.sparse = 1;
+  hdr.ord = A.Order() == MatrixSparse<T>::ROW ? 'r' : 'c';
+  hdr.m = A.Rows();
+  hdr.n = A.Cols();
+  hdr.nnz = static_cast<uint64_t>(A.Nnz());
+  size_t nnz2 = static_cast<size_t>(2) * A.Nnz();
+  return WriteFile(path, &hdr, A.Data(), nnz2, A.Ind(), nnz2, A.Ptr(),
+      A.Rows() + A.Cols() + 2, d, e);
+}
+
+// Explicit template instantiation.
+#if !defined(POGS_DOUBLE) || POGS_DOUBLE==1
+template class MatrixFile<double>;
+template int WriteMatrixFile<double>(const char *, const MatrixDense<double>&,
+    const double *, const double *);
+template int WriteMatrixFile<double>(const char *,
+    const MatrixSparse<double>&, const double *, const double *);
+#endif
+
+#if !defined(POGS_SINGLE) || POGS_SINGLE==1
+template class MatrixFile<float>;
+template int WriteMatrixFile<float>(const char *, const MatrixDense<float>&,
+    const float *, const float *);
+template int WriteMatrixFile<float>(const char *, const MatrixSparse<float>&,
+    const float *, const float *);
+#endif
+
+}  // namespace pogs
@@ -1,9 +1,14 @@
+#include <algorithm>
+#include <cstring>
+
 #include "gsl/gsl_spblas.h"
 #include "gsl/gsl_spmat.h"
 #include "gsl/gsl_vector.h"
 #include "equil_helper.h"
 #include "matrix/matrix.h"
+#include "matrix/matrix_file.h"
 #include "matrix/matrix_sparse.h"
+#include "parallel.h"
 #include "util.h"
 
 namespace pogs {
@@ -21,8 +26,17 @@ template <typename T>
 struct CpuData {
   const T *orig_data;
   const POGS_INT *orig_ptr, *orig_ind;
-  CpuData(const T *data, const POGS_INT *ptr, const POGS_INT *ind)
-      : orig_data(data), orig_ptr(ptr), orig_ind(ind) { }
+  // Set for matrix files, whose arrays hold both the CSR and CSC form, and
+  // whose equilibration vectors are set if the arrays are equilibrated.
+  bool orig_both;
+  const T *equil_d, *equil_e;
+  // Vectors of size n, one per thread, in which MulAtA accumulates A^T * y.
+  T *work;
+  size_t work_threads;
+  CpuData(const T *data, const POGS_INT *ptr, const POGS_INT *ind,
+          bool both = false, const T *equil_d = 0, const T *equil_e = 0)
+      : orig_data(data), orig_ptr(ptr), orig_ind(ind), orig_both(both),
+        equil_d(equil_d), equil_e(equil_e), work(0), work_threads(0) { }
 };
 
 CBLAS_TRANSPOSE_t OpToCblasOp(char trans) {
@@ -56,6 +70,17 @@ MatrixSparse<T>::MatrixSparse(char ord, POGS_INT m, POGS_INT n, POGS_INT nnz,
   this->_info = reinterpret_cast<void*>(info);
 }
 
+template <typename T>
+MatrixSparse<T>::MatrixSparse(const MatrixFile<T>& F)
+    : Matrix<T>(F.Rows(), F.Cols()), _data(0), _ptr(0), _ind(0),
+      _nnz(F.Nnz()), _ord(F.Order() == 'r' ? ROW : COL) {
+  ASSERT(!F.IsValid() || F.IsSparse());
+
+  CpuData<T> *info = new CpuData<T>(F.Data(), F.Ptr(), F.Ind(), true,
+      F.D(), F.E());
+  this->_info = reinterpret_cast<void*>(info);
+}
+
 template <typename T>
 MatrixSparse<T>::MatrixSparse(const MatrixSparse<T>& A)
     : Matrix<T>(A._m, A._n), _data(0), _ptr(0), _ind(0), _nnz(A._nnz), 
@@ -63,17 +88,20 @@ MatrixSparse<T>::MatrixSparse(const MatrixSparse<T>& A)
 
   CpuData<T> *info_A = reinterpret_cast<CpuData<T>*>(A._info);
   CpuData<T> *info = new CpuData<T>(info_A->orig_data, info_A->orig_ptr,
-      info_A->orig_ind);
+      info_A->orig_ind, info_A->orig_both, info_A->equil_d, info_A->equil_e);
   this->_info = reinterpret_cast<void*>(info);
 }
 
 template <typename T>
 MatrixSparse<T>::~MatrixSparse() {
   CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  // Arrays adopted from a matrix file are not owned.
+  bool adopted = info->equil_d != 0;
+  delete [] info->work;
   delete info;
   this->_info = 0;
 
-  if (this->_done_init) {
+  if (this->_done_init && !adopted) {
     if (_data) {
       delete [] _data;
       _data = 0;
@@ -96,13 +124,30 @@ int MatrixSparse<T>::Init() {
   DEBUG_ASSERT(!this->_done_init);
   if (this->_done_init)
     return 1;
-  this->_done_init = true;
 
+  // A matrix constructed from an invalid matrix file has no data.
   CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  if (info->orig_data == 0)
+    return 1;
+  this->_done_init = true;
   const T *orig_data = info->orig_data;
   const POGS_INT *orig_ptr = info->orig_ptr;
   const POGS_INT *orig_ind = info->orig_ind;
 
+  info->work_threads = ParallelThreads();
+  info->work = new T[info->work_threads * this->_n];
+  ASSERT(info->work != 0);
+  this->_bytes_alloc += info->work_threads * this->_n * sizeof(T);
+
+  // Adopt the arrays of an equilibrated matrix file, which Equil does not
+  // modify.
+  if (info->equil_d) {
+    _data = const_cast<T*>(orig_data);
+    _ind = const_cast<POGS_INT*>(orig_ind);
+    _ptr = const_cast<POGS_INT*>(orig_ptr);
+    return 0;
+  }
+
   // Allocate sparse matrix on gpu.
   _data = new T[static_cast<size_t>(2) * _nnz];
   ASSERT(_data != 0);
@@ -110,8 +155,16 @@ int MatrixSparse<T>::Init() {
   ASSERT(_ind != 0);
   _ptr = new POGS_INT[this->_m + this->_n + 2];
   ASSERT(_ptr != 0);
-
-  if (_ord == ROW) {
+  this->_bytes_alloc += static_cast<size_t>(2) * _nnz *
+      (sizeof(T) + sizeof(POGS_INT)) +
+      (this->_m + this->_n + 2) * sizeof(POGS_INT);
+
+  if (info->orig_both) {
+    // The arrays already hold both forms, so copy them as they are.
+    memcpy(_data, orig_data, static_cast<size_t>(2) * _nnz * sizeof(T));
+    memcpy(_ind, orig_ind, static_cast<size_t>(2) * _nnz * sizeof(POGS_INT));
+    memcpy(_ptr, orig_ptr, (this->_m + this->_n + 2) * sizeof(POGS_INT));
+  } else if (_ord == ROW) {
     gsl::spmat<T, POGS_INT, CblasRowMajor> A(_data, _ind, _ptr, this->_m,
         this->_n, _nnz);
     gsl::spmat_memcpy(&A, orig_data, orig_ind, orig_ptr);
@@ -129,6 +182,7 @@ int MatrixSparse<T>::Mul(char trans, T alpha, const T *x, T beta, T *y) const {
   DEBUG_ASSERT(this->_done_init);
   if (!this->_done_init)
     return 1;
+  ++this->_num_mul;
 
   gsl::vector<T> x_vec, y_vec;
   if (trans == 'n' || trans == 'N') {
@@ -152,12 +206,75 @@ int MatrixSparse<T>::Mul(char trans, T alpha, const T *x, T beta, T *y) const {
   return 0;
 }
 
+template <typename T>
+int MatrixSparse<T>::MulAtA(T alpha, const T *x, T *y, T beta, T *z) const {
+  DEBUG_ASSERT(this->_done_init);
+  if (!this->_done_init)
+    return 1;
+  this->_num_mul += 2;
+
+  // Take a single pass over the CSR form, in which each row i gives
+  // y_i = a_i^T * x, which is then scattered into A^T * y as y_i * a_i. Each
+  // thread takes a range of rows and accumulates into its own vector.
+  size_t m = this->_m, n = this->_n;
+  const T *val = _data;
+  const POGS_INT *ind = _ind, *ptr = _ptr;
+  if (_ord == COL) {
+    val += _nnz;
+    ind += _nnz;
+    ptr += n + 1;
+  }
+
+  const CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  size_t threads = info->work_threads;
+  size_t rows = (m + threads - 1) / threads;
+  T *work = info->work;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(threads) \
+    if (static_cast<size_t>(_nnz) >= kParallelMinSize)
+#endif
+  for (size_t t = 0; t < threads; ++t) {
+    T *w = work + t * n;
+    std::fill(w, w + n, static_cast<T>(0));
+    for (size_t i = t * rows; i < std::min((t + 1) * rows, m); ++i) {
+      T y_i = static_cast<T>(0);
+      for (POGS_INT k = ptr[i]; k < ptr[i + 1]; ++k)
+        y_i += val[k] * x[ind[k]];
+      y[i] = y_i;
+      for (POGS_INT k = ptr[i]; k < ptr[i + 1]; ++k)
+        w[ind[k]] += val[k] * y_i;
+    }
+  }
+
+  // z := alpha * sum_t w_t + beta * z.
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(n)) \
+    if (n >= kParallelMinSize)
+#endif
+  for (size_t j = 0; j < n; ++j) {
+    T sum = work[j];
+    for (size_t t = 1; t < threads; ++t)
+      sum += work[t * n + j];
+    z[j] = beta == static_cast<T>(0) ? alpha * sum : alpha * sum + beta * z[j];
+  }
+
+  return 0;
+}
+
 template <typename T>
 int MatrixSparse<T>::Equil(T *d, T *e) {
   DEBUG_ASSERT(this->_done_init);
   if (!this->_done_init)
     return 1;
 
+  // A matrix file may hold the equilibrated matrix and its d and e.
+  CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+  if (info->equil_d) {
+    memcpy(d, info->equil_d, this->_m * sizeof(T));
+    memcpy(e, info->equil_e, this->_n * sizeof(T));
+    return 0;
+  }
+
   // Number of elements in matrix.
   size_t num_el = static_cast<size_t>(2) * _nnz;
 
@@ -166,6 +283,7 @@ int MatrixSparse<T>::Equil(T *d, T *e) {
   unsigned char *sign;
   size_t num_sign_bytes = (num_el + 7) / 8;
   sign = new unsigned char[num_sign_bytes];
+  this->_bytes_alloc += num_sign_bytes;
 
   // Fill sign bits, assigning each thread a multiple of 8 elements.
   size_t num_chars = num_el / 8;
@@ -2,16 +2,21 @@
 
 #include <algorithm>
 #include <functional>
+#include <limits>
 
+#include "anderson.h"
 #include "gsl/gsl_blas.h"
 #include "gsl/gsl_vector.h"
 #include "interface_defs.h"
 #include "matrix/matrix.h"
 #include "matrix/matrix_dense.h"
+#include "matrix/matrix_dense_stream.h"
 #include "matrix/matrix_sparse.h"
 #include "projector/projector.h"
 #include "projector/projector_direct.h"
 #include "projector/projector_cgls.h"
+#include "pogs_helper.h"
+#include "pogs_trace.h"
 #include "util.h"
 
 #include "timer.h"
@@ -23,18 +28,163 @@ namespace pogs {
 
 namespace {
 
-template <typename T, typename Op>
-struct ApplyOp: std::binary_function<FunctionObj<T>, FunctionObj<T>, T> {
-  Op binary_op;
-  ApplyOp(Op binary_op) : binary_op(binary_op) { }
-  FunctionObj<T> operator()(FunctionObj<T> &h, T x) {
-    h.a = binary_op(h.a, x);
-    h.d = binary_op(h.d, x);
-    h.e = binary_op(binary_op(h.e, x), x);
-    return h;
+
+// Adds the wall time between construction and destruction, and one call, to
+// phase if collect is true. Does nothing (not even read the clock) otherwise.
+class PhaseTimer {
+ private:
+  PogsPhaseStats *_phase;
+  double _t0;
+
+ public:
+  PhaseTimer(bool collect, PogsPhaseStats *phase)
+      : _phase(collect ? phase : 0), _t0(collect ? timer<double>() : 0.) { }
+  ~PhaseTimer() {
+    if (_phase) {
+      _phase->time += timer<double>() - _t0;
+      ++_phase->calls;
+    }
+  }
+};
+
+// Returns the accuracy of the iterative proximal operators for the next
+// iteration, with an error of kProxTolScale * rel_tol times the smaller ratio
+// of the residuals to their tolerances, so that the error shrinks with the
+// residuals and is well below rel_tol as they reach the tolerances.
+template <typename T>
+ProxAccuracy InexactProxAccuracy(T nrm_r, T eps_pri, T nrm_s, T eps_dua,
+                                 T rel_tol) {
+  const T kProxTolScale = static_cast<T>(0.1);
+  return ProxAccuracyTol(kProxTolScale * rel_tol *
+      std::min(nrm_r / eps_pri, nrm_s / eps_dua));
+}
+
+// Sets iter[acc] to the inner steps of the proximal operators of f and g per
+// iteration at accuracy acc.
+template <typename T>
+void ProxInnerIterAll(const FunctionSoA<T> &f, const FunctionSoA<T> &g,
+                      size_t *iter) {
+  for (int acc = kProxCoarse; acc <= kProxExact; ++acc) {
+    iter[acc] = ProxInnerIter(f, static_cast<ProxAccuracy>(acc)) +
+        ProxInnerIter(g, static_cast<ProxAccuracy>(acc));
+  }
+}
+
+void PrintStats(const PogsStats &stats) {
+  const char *names[] = { "Total", "Init", "Equil", "Factor", "Prox",
+      "Project", "Residual", "Rho" };
+  const PogsPhaseStats *phases[] = { &stats.total, &stats.init, &stats.equil,
+      &stats.factor, &stats.prox, &stats.project, &stats.residual,
+      &stats.rho };
+  Printf(__HBAR__ "Phase    | Time (s) |  Calls\n");
+  for (unsigned int i = 0; i < sizeof(phases) / sizeof(phases[0]); ++i) {
+    Printf("%-8s | %.2e | %6lu\n", names[i], phases[i]->time,
+        static_cast<unsigned long>(phases[i]->calls));
+  }
+  Printf("Matvec: %lu, Proj iter: %lu, Alloc: %lu bytes\n",
+      static_cast<unsigned long>(stats.num_mul),
+      static_cast<unsigned long>(stats.proj_iter),
+      static_cast<unsigned long>(stats.bytes_alloc));
+  if (stats.prox_iter_exact > 0) {
+    Printf("Prox iter: %lu (%lu if exact)\n",
+        static_cast<unsigned long>(stats.prox_iter),
+        static_cast<unsigned long>(stats.prox_iter_exact));
   }
+}
+
+// Assigns size copies of x to v, returns the number of allocations (0 or 1).
+template <typename U>
+unsigned int AssignAlloc(std::vector<U> *v, size_t size, U x) {
+  size_t capacity = v->capacity();
+  v->assign(size, x);
+  return v->capacity() != capacity;
+}
+
+// Per-instance data for SolveBatch.
+template <typename T>
+struct BatchInstance {
+  size_t idx;
+  T rho;
+  RhoPolicy<T> *rho_policy;
+  T nrm_r, nrm_s, gap, eps_pri, eps_dua, eps_gap, optval;
+  ProxAccuracy prox_acc;
+  const FunctionSoA<T> *f, *g;
 };
 
+// Checks whether the successive differences of the iterates certify that the
+// problem is infeasible or unbounded. The dual difference
+//
+//   -(zt^{k+1} - zt^k) = z - alpha z12 - (1 - alpha) zprev = (dmu, dlambda)
+//
+// is a certificate of infeasibility if dmu = -A^T dlambda and
+// sup_{y in dom f} dlambda^T y + sup_{x in dom g} dmu^T x < 0, while the
+// primal difference
+//
+//   z^{k+1} - z^k = (dx, dy)
+//
+// is a certificate of unboundedness if dy = A dx and the sum of the recession
+// functions f'(dy) + g'(dx) < 0. Both conditions are checked relative to
+// ||.||_inf with tolerance tol. On success, returns POGS_INFEASIBLE or
+// POGS_UNBOUNDED with the certificate in cert, and returns POGS_SUCCESS
+// otherwise. The functions f and g are scaled by the equilibration de. The
+// array work (of length m + n) is overwritten.
+template <typename T, typename M>
+PogsStatus CheckInfeasible(const M &A, const FunctionSoA<T> &f,
+                           const FunctionSoA<T> &g, const T *de, T alpha,
+                           const T *z, const T *z12, const T *zprev, T tol,
+                           T *work, T *cert) {
+  const T kOne = static_cast<T>(1.);
+  size_t m = A.Rows();
+  size_t n = A.Cols();
+
+  // Infeasibility.
+  for (size_t i = 0; i < m + n; ++i)
+    work[i] = z[i] - alpha * z12[i] - (kOne - alpha) * zprev[i];
+  T nrm = NormInf(m + n, work);
+  if (nrm > static_cast<T>(0.)) {
+    memcpy(cert, work, n * sizeof(T));
+    A.Mul('t', kOne, work + n, kOne, cert);
+    if (NormInf(n, cert) <= tol * nrm) {
+      T supp = DomainSupport(f, de, kScaleDiv, work + n, tol * nrm) +
+          DomainSupport(g, de + m, kScaleMul, work, tol * nrm);
+      if (supp < -tol * nrm) {
+        memcpy(cert, work, (m + n) * sizeof(T));
+        return POGS_INFEASIBLE;
+      }
+    }
+  }
+
+  // Unboundedness.
+  for (size_t i = 0; i < m + n; ++i)
+    work[i] = z[i] - zprev[i];
+  nrm = NormInf(m + n, work);
+  if (nrm > static_cast<T>(0.)) {
+    memcpy(cert + n, work + n, m * sizeof(T));
+    A.Mul('n', kOne, work, -kOne, cert + n);
+    if (NormInf(m, cert + n) <= tol * nrm) {
+      T rec = RecessionEval(f, de, kScaleDiv, work + n, tol * nrm) +
+          RecessionEval(g, de + m, kScaleMul, work, tol * nrm);
+      if (rec < -tol * nrm) {
+        memcpy(cert, work, (m + n) * sizeof(T));
+        return POGS_UNBOUNDED;
+      }
+    }
+  }
+
+  return POGS_SUCCESS;
+}
+
+// Frees the data of A that P does not read after P.Init. ProjectorCgls only
+// multiplies by A, so a reduced precision A needs no full precision copy.
+template <typename M, typename P>
+void FreeUnusedData(M *A, const P &) { }
+
+template <typename T>
+void FreeUnusedData(MatrixDense<T> *A,
+                    const ProjectorCgls<T, MatrixDense<T> > &) {
+  A->FreeData();
+}
+
 }  // namespace
 
 template <typename T, typename M, typename P>
@@ -43,20 +193,35 @@ Pogs<T, M, P>::Pogs(const M &A)
       _de(0), _z(0), _zt(0),
       _rho(static_cast<T>(kRhoInit)),
       _done_init(false),
+      _work(0), _work_size(0), _num_alloc(0), _bytes_alloc(0),
+      _aa_work(0), _aa_work_size(0),
       _x(0), _y(0), _mu(0), _lambda(0), _optval(static_cast<T>(0.)),
-      _final_iter(0),
+      _final_iter(0), _num_mul(0), _num_mul_res(0), _cert(0), _stats(),
+      _callback(0), _callback_data(0), _callback_optval(false), _trace(0),
       _abs_tol(static_cast<T>(kAbsTol)),
       _rel_tol(static_cast<T>(kRelTol)),
+      _inf_tol(static_cast<T>(kInfTol)),
       _max_iter(kMaxIter),
       _init_iter(kInitIter),
       _verbose(kVerbose),
+      _stop_check_iter(kStopCheckIter),
+      _stop_check(STOP_CHECK_ALWAYS),
+      _anderson_mem(kAndersonMem),
+      _anderson_type(ANDERSON_TYPE_II),
+      _rho_policy(NewRhoPolicy<T>(RHO_HEURISTIC)),
       _adaptive_rho(kAdaptiveRho),
       _gap_stop(kGapStop),
+      _collect_stats(false),
+      _inexact_prox(kInexactProx),
       _init_x(false), _init_lambda(false) {
   _x = new T[_A.Cols()]();
   _y = new T[_A.Rows()]();
   _mu = new T[_A.Cols()]();
   _lambda = new T[_A.Rows()]();
+  _cert = new T[_A.Cols() + _A.Rows()]();
+  // The outputs and the rho policy.
+  _num_alloc += 6;
+  _bytes_alloc += 3 * (_A.Cols() + _A.Rows()) * sizeof(T);
 }
 
 template <typename T, typename M, typename P>
@@ -69,19 +234,49 @@ int Pogs<T, M, P>::_Init() {
   size_t m = _A.Rows();
   size_t n = _A.Cols();
 
-  _de = new T[m + n];
+  // Vectors of length m + n are stored mn apart, so that each starts on a
+  // cache line (see parallel.h).
+  size_t mn = ParallelPad<T>(m + n);
+  _de = ParallelAlloc<T>(m + n);
   ASSERT(_de != 0);
-  _z = new T[m + n];
+  // z and zt are stored together, so that (z, zt) can be treated as a single
+  // iterate of length 2 * mn (eg. by Anderson acceleration). The padding
+  // after z and zt stays 0.
+  _z = ParallelAlloc<T>(2 * mn);
   ASSERT(_z != 0);
-  _zt = new T[m + n];
-  ASSERT(_zt != 0);
-  memset(_de, 0, (m + n) * sizeof(T));
-  memset(_z, 0, (m + n) * sizeof(T));
-  memset(_zt, 0, (m + n) * sizeof(T));
+  _zt = _z + mn;
+  // Each vector of length m + n is first touched with the partition of the
+  // parallel loops over it (see parallel.h).
+  ParallelZero(m + n, _de);
+  ParallelZero(mn, _z);
+  ParallelZero(mn, _zt);
+  _num_alloc += 2;
+  _bytes_alloc += (m + n + 2 * mn) * sizeof(T);
 
-  _A.Init();
-  _A.Equil(_de, _de + m);
-  _P.Init();
+  {
+    PhaseTimer timer_init(_collect_stats, &_stats.init);
+    _A.Init();
+  }
+  {
+    PhaseTimer timer_equil(_collect_stats, &_stats.equil);
+    _A.Equil(_de, _de + m);
+  }
+  {
+    PhaseTimer timer_factor(_collect_stats, &_stats.factor);
+    _P.Init();
+  }
+  FreeUnusedData(&_A, _P);
+
+  // Workspace layout: [zprev | ztemp | z12 | projector scratch].
+  _work_size = 3 * mn + _P.WorkspaceSize();
+  _work = ParallelAlloc<T>(_work_size);
+  ASSERT(_work != 0);
+  for (size_t i = 0; i < 3; ++i)
+    ParallelZero(mn, _work + i * mn);
+  ParallelZero(_P.WorkspaceSize(), _work + 3 * mn);
+  _P.SetWorkspace(_work + 3 * mn);
+  _num_alloc += 3;
+  _bytes_alloc += _work_size * sizeof(T);
 
   return 0;
 }
@@ -89,22 +284,34 @@ int Pogs<T, M, P>::_Init() {
 template <typename T, typename M, typename P>
 PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
                                 const std::vector<FunctionObj<T> > &g) {
+  // Convert f and g to structure-of-arrays form (once per solve).
+  size_t bytes_f = _f.Assign(f);
+  size_t bytes_g = _g.Assign(g);
+  _bytes_alloc += bytes_f + bytes_g;
+
+  PogsStatus status = Solve(_f, _g);
+  if (_collect_stats)
+    _stats.bytes_alloc += bytes_f + bytes_g;
+  return status;
+}
+
+template <typename T, typename M, typename P>
+PogsStatus Pogs<T, M, P>::Solve(const FunctionSoA<T> &f,
+                                const FunctionSoA<T> &g) {
   double t0 = timer<double>();
-  // Constants for adaptive-rho and over-relaxation.
-  const T kDeltaMin   = static_cast<T>(1.05);
-  const T kGamma      = static_cast<T>(1.01);
-  const T kTau        = static_cast<T>(0.8);
+  // Constants for over-relaxation.
   const T kAlpha      = static_cast<T>(1.7);
-  const T kRhoMin     = static_cast<T>(1e-4);
-  const T kRhoMax     = static_cast<T>(1e4);
-  const T kKappa      = static_cast<T>(0.9);
   const T kOne        = static_cast<T>(1.0);
   const T kZero       = static_cast<T>(0.0);
   const T kProjTolMax = static_cast<T>(1e-8);
   const T kProjTolMin = static_cast<T>(1e-2);
   const T kProjTolPow = static_cast<T>(1.3);
   const T kProjTolIni = static_cast<T>(1e-5);
-  bool use_exact_stop = true;
+  const unsigned int kInfCheckIter = 10u;
+
+  _stats = PogsStats();
+  size_t bytes_init = _BytesAlloc();
+  size_t proj_iter_init = _P.NumIter();
 
   // Initialize Projector P and Matrix A.
   if (!_done_init)
@@ -113,16 +320,38 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
   // Extract values from pogs_data
   size_t m = _A.Rows();
   size_t n = _A.Cols();
-  std::vector<FunctionObj<T> > f_cpu = f;
-  std::vector<FunctionObj<T> > g_cpu = g;
+  ASSERT(f.Size() == m && g.Size() == n);
+  size_t mn = ParallelPad<T>(m + n);
 
-  // Allocate data for ADMM variables.
+  // Anderson acceleration acts on u = (z, zt), with a copy of the previous
+  // iterate and of the last plain (unaccelerated) step for the safeguard.
+  // These have the layout of (_z, _zt), with zero padding.
+  size_t aa_size = 0;
+  if (_anderson_mem > 0) {
+    aa_size = Anderson<T>::WorkspaceSize(2 * mn, _anderson_mem) + 4 * mn;
+    if (aa_size > _aa_work_size) {
+      ParallelFree(_aa_work);
+      _aa_work = ParallelAlloc<T>(aa_size);
+      ASSERT(_aa_work != 0);
+      ParallelZero(aa_size, _aa_work);
+      _aa_work_size = aa_size;
+      ++_num_alloc;
+      _bytes_alloc += aa_size * sizeof(T);
+    }
+  }
+  T *aa_u = _aa_work, *aa_plain = _aa_work + 2 * mn;
+  Anderson<T> aa(2 * mn, _anderson_mem, _anderson_type, _aa_work + 4 * mn);
+  T aa_nrm_plain = static_cast<T>(0);
+  bool aa_check = false;
+  unsigned int aa_num_reject = 0;
+
+  // Views of ADMM variables in the workspace.
   gsl::vector<T> de    = gsl::vector_view_array(_de, m + n);
   gsl::vector<T> z     = gsl::vector_view_array(_z, m + n);
   gsl::vector<T> zt    = gsl::vector_view_array(_zt, m + n);
-  gsl::vector<T> zprev = gsl::vector_calloc<T>(m + n);
-  gsl::vector<T> ztemp = gsl::vector_calloc<T>(m + n);
-  gsl::vector<T> z12   = gsl::vector_calloc<T>(m + n);
+  gsl::vector<T> zprev = gsl::vector_view_array(_work, m + n);
+  gsl::vector<T> ztemp = gsl::vector_view_array(_work + mn, m + n);
+  gsl::vector<T> z12   = gsl::vector_view_array(_work + 2 * mn, m + n);
 
   // Create views for x and y components.
   gsl::vector<T> d     = gsl::vector_subvector(&de, 0, m);
@@ -136,11 +365,9 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
   gsl::vector<T> xtemp = gsl::vector_subvector(&ztemp, 0, n);
   gsl::vector<T> ytemp = gsl::vector_subvector(&ztemp, n, m);
 
-  // Scale f and g to account for diagonal scaling e and d.
-  std::transform(f_cpu.begin(), f_cpu.end(), d.data, f_cpu.begin(),
-      ApplyOp<T, std::divides<T> >(std::divides<T>()));
-  std::transform(g_cpu.begin(), g_cpu.end(), e.data, g_cpu.begin(),
-      ApplyOp<T, std::multiplies<T> >(std::multiplies<T>()));
+  // The arguments of f and g are scaled by the equilibration d and e, ie.
+  // f_i(y_i / d_i) and g_j(e_j x_j) are evaluated, without forming the scaled
+  // functions.
 
   // Initialize (x, lambda) from (x0, lambda0).
   if (_init_x) {
@@ -164,8 +391,8 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
     //   2. \mu = -A^T\lambda
     gsl::vector_set_all(&zprev, kZero);
     for (unsigned int i = 0; i < kInitIter; ++i) {
-      ProjSubgradEval(g_cpu, xprev.data, x.data, xtemp.data);
-      ProjSubgradEval(f_cpu, yprev.data, y.data, ytemp.data);
+      ProjSubgradEval(g, e.data, kScaleMul, xprev.data, x.data, xtemp.data);
+      ProjSubgradEval(f, d.data, kScaleDiv, yprev.data, y.data, ytemp.data);
       _P.Project(xtemp.data, ytemp.data, kOne, xprev.data, yprev.data,
           kProjTolIni);
       gsl::blas_axpy(-kOne, &ztemp, &zprev);
@@ -199,121 +426,213 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
   T sqrtn_atol = std::sqrt(static_cast<T>(n)) * _abs_tol;
   T sqrtm_atol = std::sqrt(static_cast<T>(m)) * _abs_tol;
   T sqrtmn_atol = std::sqrt(static_cast<T>(m + n)) * _abs_tol;
-  T delta = kDeltaMin, xi = static_cast<T>(1.0);
-  unsigned int k = 0u, kd = 0u, ku = 0u;
+  _rho_policy->Reset(_rho);
+  unsigned int k = 0u;
   bool converged = false;
   T nrm_r, nrm_s, gap, eps_gap, eps_pri, eps_dua;
+  PogsStatus inf_status = POGS_SUCCESS;
+  unsigned int inf_count = 0u;
+  bool interrupted = false;
+  unsigned int stop_check_iter = std::max(_stop_check_iter, 1u);
+  unsigned int exact_next = 0u, exact_interval = 1u;
+  size_t num_mul_init = _A.NumMul();
+  _num_mul_res = 0;
 
-  for (;; ++k) {
-    gsl::vector_memcpy(&zprev, &z);
+  // Track the objective in the same pass as the proximal operators whenever
+  // it is printed or reported, so that it costs no extra pass over f and g.
+  bool track_optval = _verbose > 1 || (_callback && _callback_optval);
+  T optval = std::numeric_limits<T>::quiet_NaN();
 
+  // With inexact proximal operators, the first iteration is coarse and the
+  // accuracy of the others follows the residuals (see InexactProxAccuracy).
+  ProxAccuracy prox_acc = _inexact_prox ? kProxCoarse : kProxExact;
+  size_t prox_iter[kProxExact + 1] = { 0 };
+  if (_collect_stats)
+    ProxInnerIterAll(f, g, prox_iter);
+
+  for (;; ++k) {
     // Evaluate Proximal Operators
-    gsl::blas_axpy(-kOne, &zt, &z);
-    ProxEval(g_cpu, _rho, x.data, x12.data);
-    ProxEval(f_cpu, _rho, y.data, y12.data);
-
-    // Compute gap, optval, and tolerances.
-    gsl::blas_axpy(-kOne, &z12, &z);
-    gsl::blas_dot(&z, &z12, &gap);
-    gap = std::abs(gap);
-    eps_gap = sqrtmn_atol + _rel_tol * gsl::blas_nrm2(&z) *
-        gsl::blas_nrm2(&z12);
-    eps_pri = sqrtm_atol + _rel_tol * gsl::blas_nrm2(&y12);
-    eps_dua = sqrtn_atol + _rel_tol * _rho * gsl::blas_nrm2(&x);
-
-    // Apply over relaxation.
-    gsl::vector_memcpy(&ztemp, &zt);
-    gsl::blas_axpy(kAlpha, &z12, &ztemp);
-    gsl::blas_axpy(kOne - kAlpha, &zprev, &ztemp);
+    ProxPrepare(m + n, zt.data, z.data, zprev.data);
+    {
+      PhaseTimer timer_prox(_collect_stats, &_stats.prox);
+      if (track_optval) {
+        optval = ProxFuncEval(g, e.data, kScaleMul, _rho, x.data, x12.data,
+            prox_acc);
+        optval += ProxFuncEval(f, d.data, kScaleDiv, _rho, y.data, y12.data,
+            prox_acc);
+      } else {
+        ProxEval(g, e.data, kScaleMul, _rho, x.data, x12.data, prox_acc);
+        ProxEval(f, d.data, kScaleDiv, _rho, y.data, y12.data, prox_acc);
+      }
+    }
+    if (_collect_stats) {
+      _stats.prox_iter += prox_iter[prox_acc];
+      _stats.prox_iter_exact += prox_iter[kProxExact];
+    }
+
+    // Compute gap, optval, and tolerances and apply over relaxation.
+    ProxSums<T> sums = ProxUpdate(m, n, kAlpha, z12.data, zprev.data,
+        zt.data, z.data, ztemp.data);
+    gap = std::abs(sums.dot);
+    eps_gap = sqrtmn_atol + _rel_tol * std::sqrt(sums.ssq_x + sums.ssq_y) *
+        std::sqrt(sums.ssq_x12 + sums.ssq_y12);
+    eps_pri = sqrtm_atol + _rel_tol * std::sqrt(sums.ssq_y12);
+    eps_dua = sqrtn_atol + _rel_tol * _rho * std::sqrt(sums.ssq_x);
 
     // Project onto y = Ax.
     T proj_tol = kProjTolMin / std::pow(static_cast<T>(k + 1), kProjTolPow);
     proj_tol = std::max(proj_tol, kProjTolMax);
-    _P.Project(xtemp.data, ytemp.data, kOne, x.data, y.data, proj_tol);
+    {
+      PhaseTimer timer_project(_collect_stats, &_stats.project);
+      _P.Project(xtemp.data, ytemp.data, kOne, x.data, y.data, proj_tol);
+    }
 
     // Calculate residuals.
-    gsl::vector_memcpy(&ztemp, &zprev);
-    gsl::blas_axpy(-kOne, &z, &ztemp);
-    nrm_s = _rho * gsl::blas_nrm2(&ztemp);
-
-    gsl::vector_memcpy(&ztemp, &z12);
-    gsl::blas_axpy(-kOne, &z, &ztemp);
-    nrm_r = gsl::blas_nrm2(&ztemp);
+    bool force_exact = _stop_check == STOP_CHECK_ALWAYS ||
+        (_stop_check == STOP_CHECK_PERIODIC && k % stop_check_iter == 0) ||
+        (_stop_check == STOP_CHECK_ADAPTIVE && k >= exact_next);
+    T ssq_s, ssq_r;
+    ResidualNorms(m, n, force_exact, z.data, z12.data, zprev.data,
+        zt.data, ztemp.data, &ssq_s, &ssq_r);
+    nrm_s = _rho * std::sqrt(ssq_s);
+    nrm_r = std::sqrt(ssq_r);
 
     // Calculate exact residuals only if necessary.
     bool exact = false;
-    if ((nrm_r < eps_pri && nrm_s < eps_dua) || use_exact_stop) {
-      gsl::vector_memcpy(&ztemp, &z12);
+    if ((nrm_r < eps_pri && nrm_s < eps_dua) || force_exact) {
+      PhaseTimer timer_residual(_collect_stats, &_stats.residual);
+      if (!force_exact)
+        ResidualPrepare(m, n, z12.data, zprev.data, zt.data, ztemp.data);
       _A.Mul('n', kOne, x12.data, -kOne, ytemp.data);
-      nrm_r = gsl::blas_nrm2(&ytemp);
-      if ((nrm_r < eps_pri) || use_exact_stop) {
-        gsl::vector_memcpy(&ztemp, &z12);
-        gsl::blas_axpy(kOne, &zt, &ztemp);
-        gsl::blas_axpy(-kOne, &zprev, &ztemp);
+      nrm_r = std::sqrt(ResidualSwap(m, y12.data, yprev.data, zt.data + n,
+          ytemp.data));
+      ++_num_mul_res;
+      if ((nrm_r < eps_pri) || force_exact) {
         _A.Mul('t', kOne, ytemp.data, kOne, xtemp.data);
         nrm_s = _rho * gsl::blas_nrm2(&xtemp);
+        ++_num_mul_res;
         exact = true;
       }
     }
 
+    if (_inexact_prox)
+      prox_acc = InexactProxAccuracy(nrm_r, eps_pri, nrm_s, eps_dua, _rel_tol);
+
+    // Check less often while the exact residuals are far from converged.
+    if (exact && _stop_check == STOP_CHECK_ADAPTIVE) {
+      T ratio = std::max(nrm_r / eps_pri, nrm_s / eps_dua);
+      exact_interval = ratio > static_cast<T>(2.)
+          ? std::min(2 * exact_interval, stop_check_iter) : 1u;
+      exact_next = k + exact_interval;
+    }
+
     // Evaluate stopping criteria.
     converged = exact && nrm_r < eps_pri && nrm_s < eps_dua &&
         (!_gap_stop || gap < eps_gap);
     if ((_verbose > 2 && k % 10  == 0) ||
         (_verbose > 1 && k % 100 == 0) ||
         (_verbose > 1 && converged)) {
-      T optval = FuncEval(f_cpu, y12.data) + FuncEval(g_cpu, x12.data);
       Printf("%5d : %.2e  %.2e  %.2e  %.2e  %.2e  %.2e % .2e\n",
           k, nrm_r, eps_pri, nrm_s, eps_dua, gap, eps_gap, optval);
     }
 
+    // Report progress.
+    if (_callback || _trace) {
+      PogsIterate<T> it = { k, 0u, nrm_r, eps_pri, nrm_s, eps_dua, gap,
+          eps_gap, _rho, std::numeric_limits<T>::quiet_NaN() };
+      if (track_optval)
+        it.optval = optval;
+      if (_trace)
+        _trace->Push(it);
+      if (_callback)
+        interrupted = !_callback(it, _callback_data) && !converged;
+    }
+
     // Break if converged or there are nans
-    if (converged || k == _max_iter - 1){
+    if (converged || interrupted || k == _max_iter - 1){
       _final_iter = k;
       break;
     }
 
-    // Update dual variable.
-    gsl::blas_axpy(kAlpha, &z12, &zt);
-    gsl::blas_axpy(kOne - kAlpha, &zprev, &zt);
-    gsl::blas_axpy(-kOne, &z, &zt);
-
     // Rescale rho.
+    T zt_scale = kOne;
     if (_adaptive_rho) {
-      if (nrm_s < xi * eps_dua && nrm_r > xi * eps_pri &&
-          kTau * static_cast<T>(k) > static_cast<T>(kd)) {
-        if (_rho < kRhoMax) {
-          _rho *= delta;
-          gsl::blas_scal(1 / delta, &zt);
-          delta = kGamma * delta;
-          ku = k;
-          if (_verbose > 3)
-            Printf("+ rho %e\n", _rho);
-        }
-      } else if (nrm_s > xi * eps_dua && nrm_r < xi * eps_pri &&
-          kTau * static_cast<T>(k) > static_cast<T>(ku)) {
-        if (_rho > kRhoMin) {
-          _rho /= delta;
-          gsl::blas_scal(delta, &zt);
-          delta = kGamma * delta;
-          kd = k;
-          if (_verbose > 3)
-            Printf("- rho %e\n", _rho);
-        }
-      } else if (nrm_s < xi * eps_dua && nrm_r < xi * eps_pri) {
-        xi *= kKappa;
+      PhaseTimer timer_rho(_collect_stats, &_stats.rho);
+      RhoInfo<T> info = { k, nrm_r, nrm_s, eps_pri, eps_dua, kAlpha, m + n,
+          z.data, z12.data, zprev.data, zt.data };
+      zt_scale = _rho_policy->Update(info, &_rho);
+      if (_verbose > 3 && zt_scale != kOne)
+        Printf("%c rho %e\n", zt_scale < kOne ? '+' : '-', _rho);
+    }
+
+    // Check for infeasibility every kInfCheckIter iterations (two extra
+    // multiplications by A each), as long as rho is unchanged. The
+    // certificate must hold for two consecutive checks.
+    if (_inf_tol > kZero && zt_scale == kOne && k > 0 &&
+        k % kInfCheckIter == 0) {
+      PogsStatus inf_status_k = CheckInfeasible(_A, f, g, _de, kAlpha,
+          z.data, z12.data, zprev.data, _inf_tol, ztemp.data, _cert);
+      inf_count = inf_status_k == POGS_SUCCESS || inf_status_k != inf_status
+          ? 0u : inf_count + 1;
+      inf_status = inf_status_k;
+      if (inf_count > 0) {
+        _final_iter = k;
+        break;
+      }
+    } else if (zt_scale != kOne) {
+      inf_status = POGS_SUCCESS;
+    }
+
+    // Update dual variable (and rescale it if rho changed).
+    if (_anderson_mem > 0) {
+      memcpy(aa_u, zprev.data, (m + n) * sizeof(T));
+      memcpy(aa_u + mn, zt.data, (m + n) * sizeof(T));
+    }
+    DualUpdate(m + n, kAlpha, zt_scale, z.data, z12.data, zprev.data,
+        zt.data);
+
+    // Anderson acceleration, where (z, zt) currently holds the plain step
+    // F(u). If the last step was extrapolated and the fixed-point residual
+    // grew, fall back to the last plain step instead.
+    if (_anderson_mem > 0) {
+      if (zt_scale != kOne) {
+        aa.Reset();
+        aa_check = false;
       } else {
-        delta = kDeltaMin;
+        T aa_nrm = aa.Residual(aa_u, _z);
+        if (aa_check && aa_nrm > aa_nrm_plain) {
+          memcpy(_z, aa_plain, 2 * mn * sizeof(T));
+          aa.Reset();
+          aa_check = false;
+          ++aa_num_reject;
+        } else {
+          memcpy(aa_plain, _z, 2 * mn * sizeof(T));
+          aa_nrm_plain = aa_nrm;
+          aa_check = aa.Apply(aa_u, _z);
+        }
       }
     }
   }
 
   // Get optimal value
-  _optval = FuncEval(f_cpu, y12.data) + FuncEval(g_cpu, x12.data);
+  _optval = track_optval ? optval : FuncEval(f, d.data, kScaleDiv, y12.data) +
+      FuncEval(g, e.data, kScaleMul, x12.data);
+  _num_mul = _A.NumMul() - num_mul_init;
+  if (_collect_stats) {
+    _stats.total.time = timer<double>() - t0;
+    _stats.total.calls = 1;
+    _stats.num_mul = _num_mul;
+    _stats.proj_iter = _P.NumIter() - proj_iter_init;
+    _stats.bytes_alloc = _BytesAlloc() - bytes_init;
+  }
 
   // Check status
   PogsStatus status;
-  if (!converged && k == _max_iter - 1)
+  if (interrupted)
+    status = POGS_INTERRUPTED;
+  else if (inf_count > 0)
+    status = inf_status;
+  else if (!converged && k == _max_iter - 1)
     status = POGS_MAX_ITER;
   else if (!converged && k < _max_iter - 1)
     status = POGS_NAN_FOUND;
@@ -325,8 +644,15 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
     Printf(__HBAR__
         "Status: %s\n"
         "Timing: Total = %3.2e s, Init = %3.2e s\n"
-        "Iter  : %u\n",
-        PogsStatusString(status).c_str(), timer<double>() - t0, time_init, k);
+        "Iter  : %u\n"
+        "Matvec: %lu (%lu for exact residuals)\n",
+        PogsStatusString(status).c_str(), timer<double>() - t0, time_init, k,
+        static_cast<unsigned long>(_num_mul),
+        static_cast<unsigned long>(_num_mul_res));
+    if (_anderson_mem > 0)
+      Printf("AA    : %u rejected steps\n", aa_num_reject);
+    if (_collect_stats)
+      PrintStats(_stats);
     Printf(__HBAR__
         "Error Metrics:\n"
         "Pri: "
@@ -350,6 +676,20 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
   gsl::vector_div(&y12, &d);
   gsl::vector_mul(&x12, &e);
 
+  // Scale certificate for output.
+  gsl::vector<T> cert = gsl::vector_view_array(_cert, m + n);
+  gsl::vector<T> cert_x = gsl::vector_subvector(&cert, 0, n);
+  gsl::vector<T> cert_y = gsl::vector_subvector(&cert, n, m);
+  if (status == POGS_INFEASIBLE) {
+    gsl::vector_div(&cert_x, &e);
+    gsl::vector_mul(&cert_y, &d);
+  } else if (status == POGS_UNBOUNDED) {
+    gsl::vector_mul(&cert_x, &e);
+    gsl::vector_div(&cert_y, &d);
+  } else {
+    gsl::vector_set_all(&cert, kZero);
+  }
+
   // Copy results to output.
   gsl::vector_memcpy(_x, &x12);
   gsl::vector_memcpy(_y, &y12);
@@ -359,26 +699,318 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
   // Store z.
   gsl::vector_memcpy(&z, &zprev);
 
-  // Free memory.
-  gsl::vector_free(&z12);
-  gsl::vector_free(&zprev);
-  gsl::vector_free(&ztemp);
+  return status;
+}
+
+template <typename T, typename M, typename P>
+std::vector<PogsStatus> Pogs<T, M, P>::SolveBatch(
+    const std::vector<std::vector<FunctionObj<T> > > &f,
+    const std::vector<std::vector<FunctionObj<T> > > &g) {
+  ASSERT(f.size() == g.size());
+
+  // Convert f and g to structure-of-arrays form.
+  std::vector<FunctionSoA<T> > f_soa(f.size()), g_soa(g.size());
+  size_t bytes = 0;
+  _num_alloc += 2 * (f.size() > 0);
+  for (size_t j = 0; j < f.size(); ++j) {
+    bytes += f_soa[j].Assign(f[j]) + g_soa[j].Assign(g[j]);
+    _num_alloc += f_soa[j].NumAlloc() + g_soa[j].NumAlloc();
+  }
+  _bytes_alloc += bytes;
+
+  std::vector<PogsStatus> status = SolveBatch(f_soa, g_soa);
+  if (_collect_stats)
+    _stats.bytes_alloc += bytes;
+  return status;
+}
+
+template <typename T, typename M, typename P>
+std::vector<PogsStatus> Pogs<T, M, P>::SolveBatch(
+    const std::vector<FunctionSoA<T> > &f,
+    const std::vector<FunctionSoA<T> > &g) {
+  double t0 = timer<double>();
+  // Constants for over-relaxation.
+  const T kAlpha      = static_cast<T>(1.7);
+  const T kOne        = static_cast<T>(1.0);
+  const T kProjTolMax = static_cast<T>(1e-8);
+  const T kProjTolMin = static_cast<T>(1e-2);
+  const T kProjTolPow = static_cast<T>(1.3);
+
+  ASSERT(f.size() == g.size());
+
+  // The instances take exact residuals at every iteration and do not keep the
+  // extra state of Anderson acceleration or infeasibility detection.
+  if (_anderson_mem > 0 || _inf_tol > static_cast<T>(0.) ||
+      _stop_check != STOP_CHECK_ALWAYS) {
+    Printf("ERROR SolveBatch requires anderson_mem = 0, inf_tol = 0 and "
+        "stop_check = STOP_CHECK_ALWAYS\n");
+    return std::vector<PogsStatus>(f.size(), POGS_ERROR);
+  }
+
+  _stats = PogsStats();
+  size_t bytes_init = _BytesAlloc();
+  size_t proj_iter_init = _P.NumIter();
+  size_t num_mul_init = _A.NumMul();
+
+  // Initialize Projector P and Matrix A.
+  if (!_done_init)
+    _Init();
+
+  size_t m = _A.Rows();
+  size_t n = _A.Cols();
+  size_t K = f.size();
+  size_t mn = m + n;
+
+  // Instance data. The arguments of f and g are scaled by the equilibration,
+  // as in Solve.
+  std::vector<BatchInstance<T> > inst(K);
+  _num_alloc += (K > 0) + K;
+  for (size_t j = 0; j < K; ++j) {
+    inst[j].idx = j;
+    inst[j].rho = _rho;
+    inst[j].rho_policy = _rho_policy->Clone();
+    inst[j].rho_policy->Reset(_rho);
+    inst[j].prox_acc = _inexact_prox ? kProxCoarse : kProxExact;
+    inst[j].f = &f[j];
+    inst[j].g = &g[j];
+    ASSERT(f[j].Size() == m && g[j].Size() == n);
+  }
+
+  // The ADMM variables of the active instances are stored as the columns of
+  // (m + n) x K matrices, with converged instances swapped to the back. The
+  // columns are ld apart, so that each starts on a cache line.
+  size_t ld = ParallelPad<T>(mn);
+  T *batch = ParallelAlloc<T>(5 * K * ld);
+  ASSERT(batch != 0);
+  ++_num_alloc;
+  _bytes_alloc += 5 * K * ld * sizeof(T);
+  T *z_all = batch;
+  T *zt_all = batch + K * ld;
+  T *zprev_all = batch + 2 * K * ld;
+  T *ztemp_all = batch + 3 * K * ld;
+  T *z12_all = batch + 4 * K * ld;
+  for (size_t j = 0; j < K; ++j) {
+    memcpy(z_all + j * ld, _z, mn * sizeof(T));
+    memcpy(zt_all + j * ld, _zt, mn * sizeof(T));
+  }
+
+  _num_alloc += AssignAlloc(&_x_batch, K * n, static_cast<T>(0.)) +
+      AssignAlloc(&_y_batch, K * m, static_cast<T>(0.)) +
+      AssignAlloc(&_mu_batch, K * n, static_cast<T>(0.)) +
+      AssignAlloc(&_lambda_batch, K * m, static_cast<T>(0.)) +
+      AssignAlloc(&_optval_batch, K, static_cast<T>(0.)) +
+      AssignAlloc(&_final_iter_batch, K, 0u);
+  std::vector<PogsStatus> status(K, POGS_MAX_ITER);
+  std::vector<bool> done(K);
+  _num_alloc += 2 * (K > 0);
+
+  if (_verbose > 0) {
+    Printf(__HBAR__
+        "           POGS v%s - Proximal Graph Solver                      \n"
+        "           (c) Christopher Fougner, Stanford University 2014-2015\n"
+        __HBAR__ "Solving %lu objectives in batch mode.\n",
+        POGS_VERSION.c_str(), static_cast<unsigned long>(K));
+  }
+
+  T sqrtn_atol = std::sqrt(static_cast<T>(n)) * _abs_tol;
+  T sqrtm_atol = std::sqrt(static_cast<T>(m)) * _abs_tol;
+  T sqrtmn_atol = std::sqrt(static_cast<T>(m + n)) * _abs_tol;
+  size_t K_act = K;
+  bool track_optval = _verbose > 1 || (_callback && _callback_optval);
+
+  for (unsigned int k = 0u; K_act > 0; ++k) {
+    // Evaluate proximal operators, compute gap and tolerances and apply over
+    // relaxation.
+    for (size_t j = 0; j < K_act; ++j) {
+      BatchInstance<T> &I = inst[j];
+      T *z = z_all + j * ld, *zt = zt_all + j * ld, *zprev = zprev_all + j * ld;
+      T *ztemp = ztemp_all + j * ld, *z12 = z12_all + j * ld;
+      T rho = I.rho;
+      ProxPrepare(mn, zt, z, zprev);
+      {
+        PhaseTimer timer_prox(_collect_stats, &_stats.prox);
+        if (track_optval) {
+          I.optval = ProxFuncEval(*I.g, _de + m, kScaleMul, rho, z, z12,
+              I.prox_acc);
+          I.optval += ProxFuncEval(*I.f, _de, kScaleDiv, rho, z + n,
+              z12 + n, I.prox_acc);
+        } else {
+          ProxEval(*I.g, _de + m, kScaleMul, rho, z, z12, I.prox_acc);
+          ProxEval(*I.f, _de, kScaleDiv, rho, z + n, z12 + n, I.prox_acc);
+        }
+      }
+      if (_collect_stats) {
+        size_t prox_iter[kProxExact + 1];
+        ProxInnerIterAll(*I.f, *I.g, prox_iter);
+        _stats.prox_iter += prox_iter[I.prox_acc];
+        _stats.prox_iter_exact += prox_iter[kProxExact];
+      }
+      ProxSums<T> sums = ProxUpdate(m, n, kAlpha, z12, zprev, zt, z, ztemp);
+      I.gap = std::abs(sums.dot);
+      I.eps_gap = sqrtmn_atol + _rel_tol * std::sqrt(sums.ssq_x + sums.ssq_y) *
+          std::sqrt(sums.ssq_x12 + sums.ssq_y12);
+      I.eps_pri = sqrtm_atol + _rel_tol * std::sqrt(sums.ssq_y12);
+      I.eps_dua = sqrtn_atol + _rel_tol * rho * std::sqrt(sums.ssq_x);
+    }
+
+    // Project all instances onto y = Ax.
+    T proj_tol = kProjTolMin / std::pow(static_cast<T>(k + 1), kProjTolPow);
+    proj_tol = std::max(proj_tol, kProjTolMax);
+    {
+      PhaseTimer timer_project(_collect_stats, &_stats.project);
+      _P.ProjectBatch(K_act, ztemp_all, ztemp_all + n, ld, kOne, z_all,
+          z_all + n, proj_tol);
+    }
+
+    // Calculate exact residuals (cf. STOP_CHECK_ALWAYS in Solve).
+    {
+      PhaseTimer timer_residual(_collect_stats, &_stats.residual);
+      for (size_t j = 0; j < K_act; ++j) {
+        ResidualPrepare(m, n, z12_all + j * ld, zprev_all + j * ld,
+            zt_all + j * ld, ztemp_all + j * ld);
+      }
+      _A.MulBatch('n', kOne, K_act, z12_all, ld, -kOne, ztemp_all + n, ld);
+      for (size_t j = 0; j < K_act; ++j) {
+        inst[j].nrm_r = std::sqrt(ResidualSwap(m, z12_all + j * ld + n,
+            zprev_all + j * ld + n, zt_all + j * ld + n,
+            ztemp_all + j * ld + n));
+      }
+      _A.MulBatch('t', kOne, K_act, ztemp_all + n, ld, kOne, ztemp_all, ld);
+    }
+
+    // Evaluate stopping criteria, rescale rho and update dual variables.
+    for (size_t j = 0; j < K_act; ++j) {
+      BatchInstance<T> &I = inst[j];
+      const gsl::vector<T> xtemp = gsl::vector_view_array(ztemp_all + j * ld,
+          n);
+      I.nrm_s = I.rho * gsl::blas_nrm2(&xtemp);
+      if (_inexact_prox) {
+        I.prox_acc = InexactProxAccuracy(I.nrm_r, I.eps_pri, I.nrm_s,
+            I.eps_dua, _rel_tol);
+      }
+      bool converged = I.nrm_r < I.eps_pri && I.nrm_s < I.eps_dua &&
+          (!_gap_stop || I.gap < I.eps_gap);
+      if (converged)
+        status[I.idx] = POGS_SUCCESS;
+      done[j] = converged || k == _max_iter - 1;
+      if (_callback || _trace) {
+        PogsIterate<T> it = { k, static_cast<unsigned int>(I.idx), I.nrm_r,
+            I.eps_pri, I.nrm_s, I.eps_dua, I.gap, I.eps_gap, I.rho,
+            std::numeric_limits<T>::quiet_NaN() };
+        if (track_optval)
+          it.optval = I.optval;
+        if (_trace)
+          _trace->Push(it);
+        if (_callback && !_callback(it, _callback_data) && !converged) {
+          status[I.idx] = POGS_INTERRUPTED;
+          done[j] = true;
+        }
+      }
+      if (done[j]) {
+        _final_iter_batch[I.idx] = k;
+        continue;
+      }
+      T zt_scale = kOne;
+      if (_adaptive_rho) {
+        PhaseTimer timer_rho(_collect_stats, &_stats.rho);
+        RhoInfo<T> info = { k, I.nrm_r, I.nrm_s, I.eps_pri, I.eps_dua, kAlpha,
+            mn, z_all + j * ld, z12_all + j * ld, zprev_all + j * ld,
+            zt_all + j * ld };
+        zt_scale = I.rho_policy->Update(info, &I.rho);
+      }
+      DualUpdate(mn, kAlpha, zt_scale, z_all + j * ld, z12_all + j * ld,
+          zprev_all + j * ld, zt_all + j * ld);
+    }
+
+    // Store the solutions of finished instances and swap them to the back.
+    for (size_t j = K_act; j-- > 0;) {
+      if (!done[j])
+        continue;
+      BatchInstance<T> &I = inst[j];
+      gsl::vector<T> zt = gsl::vector_view_array(zt_all + j * ld, mn);
+      gsl::vector<T> zprev = gsl::vector_view_array(zprev_all + j * ld, mn);
+      gsl::vector<T> ztemp = gsl::vector_view_array(ztemp_all + j * ld, mn);
+      gsl::vector<T> z12 = gsl::vector_view_array(z12_all + j * ld, mn);
+      T *x12 = z12.data, *y12 = z12.data + n;
+      T *xtemp = ztemp.data, *ytemp = ztemp.data + n;
+
+      _optval_batch[I.idx] = track_optval ? I.optval
+          : FuncEval(*I.f, _de, kScaleDiv, y12) +
+          FuncEval(*I.g, _de + m, kScaleMul, x12);
+      if (_verbose > 1) {
+        Printf("Objective %lu: %s, iter = %u, optval = % .2e\n",
+            static_cast<unsigned long>(I.idx),
+            PogsStatusString(status[I.idx]).c_str(),
+            _final_iter_batch[I.idx], _optval_batch[I.idx]);
+      }
+
+      // Scale x, y, lambda and mu for output.
+      gsl::vector_memcpy(&ztemp, &zt);
+      gsl::blas_axpy(-kOne, &zprev, &ztemp);
+      gsl::blas_axpy(kOne, &z12, &ztemp);
+      gsl::blas_scal(-I.rho, &ztemp);
+      for (size_t i = 0; i < m; ++i) {
+        _y_batch[I.idx * m + i] = y12[i] / _de[i];
+        _lambda_batch[I.idx * m + i] = ytemp[i] * _de[i];
+      }
+      for (size_t i = 0; i < n; ++i) {
+        _x_batch[I.idx * n + i] = x12[i] * _de[m + i];
+        _mu_batch[I.idx * n + i] = xtemp[i] / _de[m + i];
+      }
+
+      // Swap with the last active instance.
+      --K_act;
+      if (j != K_act) {
+        for (size_t b = 0; b < 5; ++b) {
+          T *col = batch + b * K * ld;
+          std::swap_ranges(col + j * ld, col + j * ld + mn, col + K_act * ld);
+        }
+        std::swap(inst[j], inst[K_act]);
+      }
+    }
+  }
+
+  ParallelFree(batch);
+  for (size_t j = 0; j < K; ++j) {
+    _num_alloc += inst[j].rho_policy->NumAlloc();
+    delete inst[j].rho_policy;
+  }
+
+  if (_collect_stats) {
+    _stats.total.time = timer<double>() - t0;
+    _stats.total.calls = 1;
+    _stats.num_mul = _A.NumMul() - num_mul_init;
+    _stats.proj_iter = _P.NumIter() - proj_iter_init;
+    _stats.bytes_alloc = _BytesAlloc() - bytes_init;
+  }
+
+  if (_verbose > 0) {
+    Printf(__HBAR__ "Timing: Total = %3.2e s\n", timer<double>() - t0);
+    if (_collect_stats)
+      PrintStats(_stats);
+    Printf(__HBAR__);
+  }
 
   return status;
 }
 
 template <typename T, typename M, typename P>
 Pogs<T, M, P>::~Pogs() {
-  delete [] _de;
-  delete [] _z;
-  delete [] _zt;
-  _de = _z = _zt = 0;
+  ParallelFree(_de);
+  ParallelFree(_z);
+  ParallelFree(_work);
+  ParallelFree(_aa_work);
+  _de = _z = _zt = _work = _aa_work = 0;
 
   delete [] _x;
   delete [] _y;
   delete [] _mu;
   delete [] _lambda;
-  _x = _y = _mu = _lambda = 0;
+  delete [] _cert;
+  _x = _y = _mu = _lambda = _cert = 0;
+
+  delete _rho_policy;
+  _rho_policy = 0;
 }
 
 // Explicit template instantiation.
@@ -389,6 +1021,8 @@ template class Pogs<double, MatrixDense<double>,
     ProjectorCgls<double, MatrixDense<double> > >;
 template class Pogs<double, MatrixSparse<double>,
     ProjectorCgls<double, MatrixSparse<double> > >;
+template class Pogs<double, MatrixDenseStream<double>,
+    ProjectorCgls<double, MatrixDenseStream<double> > >;
 #endif
 
 #if !defined(POGS_SINGLE) || POGS_SINGLE==1
@@ -398,6 +1032,8 @@ template class Pogs<float, MatrixDense<float>,
     ProjectorCgls<float, MatrixDense<float> > >;
 template class Pogs<float, MatrixSparse<float>,
     ProjectorCgls<float, MatrixSparse<float> > >;
+template class Pogs<float, MatrixDenseStream<float>,
+    ProjectorCgls<float, MatrixDenseStream<float> > >;
 #endif
 
 }  // namespace pogs
@@ -5,6 +5,7 @@
 #include "gsl/gsl_blas.h"
 #include "gsl/gsl_vector.h"
 #include "matrix/matrix_dense.h"
+#include "matrix/matrix_dense_stream.h"
 #include "matrix/matrix_sparse.h"
 #include "projector/projector_cgls.h"
 #include "projector_helper.h"
@@ -26,6 +27,9 @@ struct Gemv : cgls::Gemv<T> {
       const {
     return A.Mul(op, alpha, x, beta, y);
   }
+  int AtA(const T *x, T *y, T *z) const {
+    return A.MulAtA(static_cast<T>(1.), x, y, static_cast<T>(0.), z);
+  }
 };
 
 }  // namespace
@@ -64,8 +68,11 @@ int ProjectorCgls<T, M>::Project(const T *x0, const T *y0, T s, T *x, T *y,
   _A.Mul('n', static_cast<T>(-1.), x0, static_cast<T>(1.), y);
 
   // Minimize ||Ax - b||_2^2 + s||x||_2^2
+  int num_iter = 0;
   cgls::Solve(Gemv<T, M>(_A), static_cast<cgls::INT>(_A.Rows()),
-      static_cast<cgls::INT>(_A.Cols()), y, x, s, tol, kMaxIter, kCglsQuiet);
+      static_cast<cgls::INT>(_A.Cols()), y, x, s, tol, kMaxIter, kCglsQuiet,
+      this->_work, &num_iter);
+  this->_num_iter += num_iter;
  
   // x := x + x0
   gsl::vector<T> x_vec = gsl::vector_view_array(x, _A.Cols());
@@ -83,14 +90,22 @@ int ProjectorCgls<T, M>::Project(const T *x0, const T *y0, T s, T *x, T *y,
   return 0;
 }
 
+template <typename T, typename M>
+size_t ProjectorCgls<T, M>::WorkspaceSize() const {
+  // Vectors p, q, s and t in CGLS.
+  return _A.Rows() + 3 * _A.Cols();
+}
+
 #if !defined(POGS_DOUBLE) || POGS_DOUBLE==1
 template class ProjectorCgls<double, MatrixDense<double> >;
 template class ProjectorCgls<double, MatrixSparse<double> >;
+template class ProjectorCgls<double, MatrixDenseStream<double> >;
 #endif
 
 #if !defined(POGS_SINGLE) || POGS_SINGLE==1
 template class ProjectorCgls<float, MatrixDense<float> >;
 template class ProjectorCgls<float, MatrixSparse<float> >;
+template class ProjectorCgls<float, MatrixDenseStream<float> >;
 #endif
 
 }  // namespace pogs
@@ -21,6 +21,18 @@ struct CpuData {
   CpuData() : AA(0), L(0), s(static_cast<T>(-1.)) { }
 };
 
+// Sets L to the Cholesky factor of AA + s * I (lower triangular part).
+template <typename T, CBLAS_ORDER O>
+void UpdateFactor(T *AA_data, T *L_data, size_t min_dim, T s) {
+  gsl::matrix<T, O> AA = gsl::matrix_view_array<T, O>(AA_data, min_dim,
+      min_dim);
+  gsl::matrix<T, O> L = gsl::matrix_view_array<T, O>(L_data, min_dim, min_dim);
+  gsl::matrix_memcpy(&L, &AA);
+  gsl::vector<T> diagL = gsl::matrix_diagonal(&L);
+  gsl::vector_add_constant(&diagL, s);
+  gsl::linalg_cholesky_decomp(&L);
+}
+
 }  // namespace
 
 template <typename T, typename M>
@@ -66,6 +78,7 @@ int ProjectorDirect<T, M>::Init() {
   ASSERT(info->L != 0);
   memset(info->AA, 0, min_dim * min_dim * sizeof(T));
   memset(info->L, 0, min_dim * min_dim * sizeof(T));
+  this->_bytes_alloc += 2 * min_dim * min_dim * sizeof(T);
 
   CBLAS_TRANSPOSE_t op_type = _A.Rows() > _A.Cols() ? CblasTrans : CblasNoTrans;
 
@@ -116,17 +129,11 @@ int ProjectorDirect<T, M>::Project(const T *x0, const T *y0, T s, T *x, T *y,
     const gsl::matrix<T, CblasRowMajor> A =
         gsl::matrix_view_array<T, CblasRowMajor>
         (_A.Data(), _A.Rows(), _A.Cols());
-    gsl::matrix<T, CblasRowMajor> AA = gsl::matrix_view_array<T, CblasRowMajor>
-        (info->AA, min_dim, min_dim);
     gsl::matrix<T, CblasRowMajor> L = gsl::matrix_view_array<T, CblasRowMajor>
         (info->L, min_dim, min_dim);
 
-    if (s != info->s) {
-      gsl::matrix_memcpy(&L, &AA);
-      gsl::vector<T> diagL = gsl::matrix_diagonal(&L);
-      gsl::vector_add_constant(&diagL, s);
-      gsl::linalg_cholesky_decomp(&L);
-    }
+    if (s != info->s)
+      UpdateFactor<T, CblasRowMajor>(info->AA, info->L, min_dim, s);
     if (_A.Rows() > _A.Cols()) {
       gsl::blas_gemv(CblasTrans, static_cast<T>(1.), &A, &y_vec,
           static_cast<T>(1.), &x_vec);
@@ -145,17 +152,11 @@ int ProjectorDirect<T, M>::Project(const T *x0, const T *y0, T s, T *x, T *y,
     const gsl::matrix<T, CblasColMajor> A =
         gsl::matrix_view_array<T, CblasColMajor>
         (_A.Data(), _A.Rows(), _A.Cols());
-    gsl::matrix<T, CblasColMajor> AA = gsl::matrix_view_array<T, CblasColMajor>
-        (info->AA, min_dim, min_dim);
     gsl::matrix<T, CblasColMajor> L = gsl::matrix_view_array<T, CblasColMajor>
         (info->L, min_dim, min_dim);
 
-    if (s != info->s) {
-      gsl::matrix_memcpy(&L, &AA);
-      gsl::vector<T> diagL = gsl::matrix_diagonal(&L);
-      gsl::vector_add_constant(&diagL, s);
-      gsl::linalg_cholesky_decomp(&L);
-    }
+    if (s != info->s)
+      UpdateFactor<T, CblasColMajor>(info->AA, info->L, min_dim, s);
     if (_A.Rows() > _A.Cols()) {
       gsl::blas_gemv(CblasTrans, static_cast<T>(1.), &A, &y_vec,
           static_cast<T>(1.), &x_vec);
@@ -182,6 +183,87 @@ int ProjectorDirect<T, M>::Project(const T *x0, const T *y0, T s, T *x, T *y,
   return 0;
 }
 
+template <typename T, typename M>
+int ProjectorDirect<T, M>::ProjectBatch(size_t K, const T *x0, const T *y0,
+                                        size_t ld, T s, T *x, T *y, T tol) {
+  DEBUG_EXPECT(this->_done_init);
+  if (!this->_done_init || s < static_cast<T>(0.))
+    return 1;
+
+  CpuData<T> *info = reinterpret_cast<CpuData<T>*>(this->_info);
+
+  size_t m = _A.Rows();
+  size_t n = _A.Cols();
+  size_t min_dim = std::min(m, n);
+
+  if (s != info->s) {
+    if (_A.Order() == MatrixDense<T>::ROW)
+      UpdateFactor<T, CblasRowMajor>(info->AA, info->L, min_dim, s);
+    else
+      UpdateFactor<T, CblasColMajor>(info->AA, info->L, min_dim, s);
+  }
+
+  // The K points are the columns of column major matrices with leading
+  // dimension ld. A row major A (resp. L) is viewed as the column major A^T
+  // (resp. L^T), so opA applies A and opAt applies A^T in either case.
+  bool row = _A.Order() == MatrixDense<T>::ROW;
+  const gsl::matrix<T, CblasColMajor> A = row ?
+      gsl::matrix_view_array<T, CblasColMajor>(_A.Data(), n, m) :
+      gsl::matrix_view_array<T, CblasColMajor>(_A.Data(), m, n);
+  const gsl::matrix<T, CblasColMajor> L =
+      gsl::matrix_view_array<T, CblasColMajor>(info->L, min_dim, min_dim);
+  CBLAS_TRANSPOSE_t opA = row ? CblasTrans : CblasNoTrans;
+  CBLAS_TRANSPOSE_t opAt = row ? CblasNoTrans : CblasTrans;
+  CBLAS_UPLO_t uplo = row ? CblasUpper : CblasLower;
+
+  gsl::matrix<T, CblasColMajor> X =
+      gsl::matrix_view_array_with_tda<T, CblasColMajor>(x, n, K, ld);
+  gsl::matrix<T, CblasColMajor> Y =
+      gsl::matrix_view_array_with_tda<T, CblasColMajor>(y, m, K, ld);
+
+  // Set (x, y) = (x0, y0).
+  for (size_t j = 0; j < K; ++j) {
+    memcpy(x + j * ld, x0 + j * ld, n * sizeof(T));
+    memcpy(y + j * ld, y0 + j * ld, m * sizeof(T));
+  }
+
+  if (m > n) {
+    gsl::blas_gemm(opAt, CblasNoTrans, static_cast<T>(1.), &A, &Y,
+        static_cast<T>(1.), &X);
+    gsl::blas_trsm(CblasLeft, uplo, opA, CblasNonUnit, static_cast<T>(1.),
+        &L, &X);
+    gsl::blas_trsm(CblasLeft, uplo, opAt, CblasNonUnit, static_cast<T>(1.),
+        &L, &X);
+    gsl::blas_gemm(opA, CblasNoTrans, static_cast<T>(1.), &A, &X,
+        static_cast<T>(0.), &Y);
+  } else {
+    gsl::blas_gemm(opA, CblasNoTrans, static_cast<T>(1.), &A, &X,
+        static_cast<T>(-1.), &Y);
+    gsl::blas_trsm(CblasLeft, uplo, opA, CblasNonUnit, static_cast<T>(1.),
+        &L, &Y);
+    gsl::blas_trsm(CblasLeft, uplo, opAt, CblasNonUnit, static_cast<T>(1.),
+        &L, &Y);
+    gsl::blas_gemm(opAt, CblasNoTrans, static_cast<T>(-1.), &A, &Y,
+        static_cast<T>(1.), &X);
+    for (size_t j = 0; j < K; ++j) {
+      gsl::vector<T> y_vec = gsl::vector_view_array(y + j * ld, m);
+      const gsl::vector<T> y0_vec = gsl::vector_view_array(y0 + j * ld, m);
+      gsl::blas_axpy(static_cast<T>(1.), &y0_vec, &y_vec);
+    }
+  }
+
+#ifdef DEBUG
+  // Verify that projection was successful.
+  for (size_t j = 0; j < K; ++j) {
+    CheckProjection(&_A, x0 + j * ld, y0 + j * ld, x + j * ld, y + j * ld, s,
+        static_cast<T>(1e3) * std::numeric_limits<T>::epsilon());
+  }
+#endif
+
+  info->s = s;
+  return 0;
+}
+
 #if !defined(POGS_DOUBLE) || POGS_DOUBLE==1
 template class ProjectorDirect<double, MatrixDense<double> >;
 #endif
@@ -319,6 +319,31 @@ cublasStatus_t blas_gemm(cublasHandle_t handle, cublasOperation_t transa,
   return err;
 }
 
+// Trsm (column major only).
+inline cublasStatus_t blas_trsm(cublasHandle_t handle, cublasSideMode_t side,
+                                cublasFillMode_t uplo, cublasOperation_t trans,
+                                cublasDiagType_t diag, const double alpha,
+                                const matrix<double, CblasColMajor> *A,
+                                matrix<double, CblasColMajor> *B) {
+  cublasStatus_t err = cublasDtrsm(handle, side, uplo, trans, diag,
+      static_cast<int>(B->size1), static_cast<int>(B->size2), &alpha, A->data,
+      static_cast<int>(A->tda), B->data, static_cast<int>(B->tda));
+  CublasCheckError(err);
+  return err;
+}
+
+inline cublasStatus_t blas_trsm(cublasHandle_t handle, cublasSideMode_t side,
+                                cublasFillMode_t uplo, cublasOperation_t trans,
+                                cublasDiagType_t diag, const float alpha,
+                                const matrix<float, CblasColMajor> *A,
+                                matrix<float, CblasColMajor> *B) {
+  cublasStatus_t err = cublasStrsm(handle, side, uplo, trans, diag,
+      static_cast<int>(B->size1), static_cast<int>(B->size2), &alpha, A->data,
+      static_cast<int>(A->tda), B->data, static_cast<int>(B->tda));
+  CublasCheckError(err);
+  return err;
+}
+
 }  // namespace cml
 
 #endif  // CML_BLAS_CUH_
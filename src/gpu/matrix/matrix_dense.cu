@@ -6,6 +6,7 @@
 #include "equil_helper.cuh"
 #include "matrix/matrix.h"
 #include "matrix/matrix_dense.h"
+#include "matrix/matrix_file.h"
 #include "util.h"
 
 namespace pogs {
@@ -22,8 +23,11 @@ const NormTypes kNormNormalize   = kNormFro;
 template<typename T>
 struct GpuData {
   const T *orig_data;
+  // Equilibration vectors of a matrix file, if orig_data is equilibrated.
+  const T *equil_d, *equil_e;
   cublasHandle_t handle;
-  GpuData(const T *orig_data) : orig_data(orig_data) {
+  GpuData(const T *orig_data, const T *equil_d = 0, const T *equil_e = 0)
+      : orig_data(orig_data), equil_d(equil_d), equil_e(equil_e) {
     cublasCreate(&handle);
     DEBUG_CUDA_CHECK_ERR();
   }
@@ -52,7 +56,7 @@ void MultDiag(const T *d, const T *e, size_t m, size_t n,
 ////////////////////////////////////////////////////////////////////////////////
 template <typename T>
 MatrixDense<T>::MatrixDense(char ord, size_t m, size_t n, const T *data)
-    : Matrix<T>(m, n), _data(0) {
+    : Matrix<T>(m, n), _data(0), _storage(COPY), _precision(FULL) {
   ASSERT(ord == 'r' || ord == 'R' || ord == 'c' || ord == 'C');
   _ord = (ord == 'r' || ord == 'R') ? ROW : COL;
 
@@ -61,13 +65,44 @@ MatrixDense<T>::MatrixDense(char ord, size_t m, size_t n, const T *data)
   this->_info = reinterpret_cast<void*>(info);
 }
 
+template <typename T>
+MatrixDense<T>::MatrixDense(char ord, size_t m, size_t n, T *data,
+                            Storage storage)
+    : Matrix<T>(m, n), _data(0), _storage(storage), _precision(FULL) {
+  ASSERT(ord == 'r' || ord == 'R' || ord == 'c' || ord == 'C');
+  _ord = (ord == 'r' || ord == 'R') ? ROW : COL;
+
+  GpuData<T> *info = new GpuData<T>(data);
+  this->_info = reinterpret_cast<void*>(info);
+}
+
+template <typename T>
+MatrixDense<T>::MatrixDense(const MatrixFile<T>& F)
+    : Matrix<T>(F.Rows(), F.Cols()), _data(0),
+      _ord(F.Order() == 'r' ? ROW : COL), _storage(COPY), _precision(FULL) {
+  ASSERT(!F.IsValid() || !F.IsSparse());
+
+  // The map is in host memory, so Init copies it to the GPU.
+  GpuData<T> *info = new GpuData<T>(F.Data(), F.D(), F.E());
+  this->_info = reinterpret_cast<void*>(info);
+}
+
 template <typename T>
 MatrixDense<T>::MatrixDense(const MatrixDense<T>& A)
-    : Matrix<T>(A._m, A._n), _data(0), _ord(A._ord) {
+    : Matrix<T>(A._m, A._n), _data(0), _ord(A._ord), _storage(COPY),
+      _precision(A._precision) {
 
+  // An IN_PLACE buffer is handed over to a copy (eg. the one kept by a
+  // solver) made before A is initialized, and A is left without data, so
+  // that the buffer is never shared.
   GpuData<T> *info_A = reinterpret_cast<GpuData<T>*>(A._info);
-  GpuData<T> *info = new GpuData<T>(info_A->orig_data);
+  GpuData<T> *info = new GpuData<T>(info_A->orig_data, info_A->equil_d,
+      info_A->equil_e);
   this->_info = reinterpret_cast<void*>(info);
+  if (A._storage == IN_PLACE && !A._done_init) {
+    _storage = IN_PLACE;
+    info_A->orig_data = 0;
+  }
 }
 
 template <typename T>
@@ -76,7 +111,7 @@ MatrixDense<T>::~MatrixDense() {
   delete info;
   this->_info = 0;
 
-  if (this->_done_init && _data) {
+  if (this->_done_init && _data && _storage == COPY) {
     cudaFree(_data);
     this->_data = 0;
     DEBUG_CUDA_CHECK_ERR();
@@ -88,9 +123,19 @@ int MatrixDense<T>::Init() {
   DEBUG_EXPECT(!this->_done_init);
   if (this->_done_init)
     return 1;
-  this->_done_init = true;
 
+  // A matrix constructed from an invalid matrix file has no data.
   GpuData<T> *info = reinterpret_cast<GpuData<T>*>(this->_info);
+  if (info->orig_data == 0)
+    return 1;
+  this->_done_init = true;
+
+  // Adopt the caller's device buffer, which was passed as non-const to the
+  // IN_PLACE constructor.
+  if (_storage == IN_PLACE) {
+    _data = const_cast<T*>(info->orig_data);
+    return 0;
+  }
 
   // Copy Matrix to GPU.
   cudaMalloc(&_data, this->_m * this->_n * sizeof(T));
@@ -106,6 +151,7 @@ int MatrixDense<T>::Mul(char trans, T alpha, const T *x, T beta, T *y) const {
   DEBUG_EXPECT(this->_done_init);
   if (!this->_done_init)
     return 1;
+  ++this->_num_mul;
 
   GpuData<T> *info = reinterpret_cast<GpuData<T>*>(this->_info);
   cublasHandle_t hdl = info->handle;
@@ -128,6 +174,48 @@ int MatrixDense<T>::Mul(char trans, T alpha, const T *x, T beta, T *y) const {
   return 0;
 }
 
+template <typename T>
+int MatrixDense<T>::MulBatch(char trans, T alpha, size_t K, const T *x,
+                             size_t ldx, T beta, T *y, size_t ldy) const {
+  DEBUG_EXPECT(this->_done_init);
+  if (!this->_done_init)
+    return 1;
+  this->_num_mul += K;
+
+  GpuData<T> *info = reinterpret_cast<GpuData<T>*>(this->_info);
+  cublasHandle_t hdl = info->handle;
+
+  // The vectors are stored as the columns of column major matrices, so a row
+  // major A is viewed as its (column major) transpose.
+  cublasOperation_t op = OpToCublasOp(trans);
+  size_t x_dim = op == CUBLAS_OP_N ? this->_n : this->_m;
+  size_t y_dim = op == CUBLAS_OP_N ? this->_m : this->_n;
+  const cml::matrix<T, CblasColMajor> X =
+      cml::matrix_view_array_with_tda<T, CblasColMajor>(x, x_dim, K, ldx);
+  cml::matrix<T, CblasColMajor> Y =
+      cml::matrix_view_array_with_tda<T, CblasColMajor>(y, y_dim, K, ldy);
+
+  if (_ord == ROW) {
+    const cml::matrix<T, CblasColMajor> At =
+        cml::matrix_view_array<T, CblasColMajor>(_data, this->_n, this->_m);
+    op = op == CUBLAS_OP_N ? CUBLAS_OP_T : CUBLAS_OP_N;
+    cml::blas_gemm(hdl, op, CUBLAS_OP_N, alpha, &At, &X, beta, &Y);
+  } else {
+    const cml::matrix<T, CblasColMajor> A =
+        cml::matrix_view_array<T, CblasColMajor>(_data, this->_m, this->_n);
+    cml::blas_gemm(hdl, op, CUBLAS_OP_N, alpha, &A, &X, beta, &Y);
+  }
+  CUDA_CHECK_ERR();
+
+  return 0;
+}
+
+template <typename T>
+int MatrixDense<T>::MulAtA(T alpha, const T *x, T *y, T beta, T *z) const {
+  // cuBLAS has no fused product, so A is read by two calls to Mul.
+  return Matrix<T>::MulAtA(alpha, x, y, beta, z);
+}
+
 template <typename T>
 int MatrixDense<T>::Equil(T *d, T *e) {
   DEBUG_ASSERT(this->_done_init);
@@ -138,6 +226,16 @@ int MatrixDense<T>::Equil(T *d, T *e) {
   GpuData<T> *info = reinterpret_cast<GpuData<T>*>(this->_info);
   cublasHandle_t hdl = info->handle;
 
+  // A matrix file may hold the equilibrated matrix and its d and e.
+  if (info->equil_d) {
+    cudaMemcpy(d, info->equil_d, this->_m * sizeof(T),
+        cudaMemcpyHostToDevice);
+    cudaMemcpy(e, info->equil_e, this->_n * sizeof(T),
+        cudaMemcpyHostToDevice);
+    DEBUG_CUDA_CHECK_ERR();
+    return 0;
+  }
+
   // Number of elements in matrix.
   size_t num_el = this->_m * this->_n;
 
@@ -6,6 +6,7 @@
 #include "cml/cml_vector.cuh"
 #include "equil_helper.cuh"
 #include "matrix/matrix.h"
+#include "matrix/matrix_file.h"
 #include "matrix/matrix_sparse.h"
 #include "util.h"
 
@@ -24,11 +25,17 @@ template <typename T>
 struct GpuData {
   const T *orig_data;
   const POGS_INT *orig_ptr, *orig_ind;
+  // Set for matrix files, whose arrays hold both the CSR and CSC form, and
+  // whose equilibration vectors are set if the arrays are equilibrated.
+  bool orig_both;
+  const T *equil_d, *equil_e;
   cublasHandle_t d_hdl;
   cusparseHandle_t s_hdl;
   cusparseMatDescr_t descr;
-  GpuData(const T *data, const POGS_INT *ptr, const POGS_INT *ind)
-      : orig_data(data), orig_ptr(ptr), orig_ind(ind) {
+  GpuData(const T *data, const POGS_INT *ptr, const POGS_INT *ind,
+          bool both = false, const T *equil_d = 0, const T *equil_e = 0)
+      : orig_data(data), orig_ptr(ptr), orig_ind(ind), orig_both(both),
+        equil_d(equil_d), equil_e(equil_e) {
     cublasCreate(&d_hdl);
     cusparseCreate(&s_hdl);
     cusparseCreateMatDescr(&descr);
@@ -77,6 +84,18 @@ MatrixSparse<T>::MatrixSparse(char ord, POGS_INT m, POGS_INT n, POGS_INT nnz,
   this->_info = reinterpret_cast<void*>(info);
 }
 
+template <typename T>
+MatrixSparse<T>::MatrixSparse(const MatrixFile<T>& F)
+    : Matrix<T>(F.Rows(), F.Cols()), _data(0), _ptr(0), _ind(0),
+      _nnz(F.Nnz()), _ord(F.Order() == 'r' ? ROW : COL) {
+  ASSERT(!F.IsValid() || F.IsSparse());
+
+  // The map is in host memory, so Init copies it to the GPU.
+  GpuData<T> *info = new GpuData<T>(F.Data(), F.Ptr(), F.Ind(), true,
+      F.D(), F.E());
+  this->_info = reinterpret_cast<void*>(info);
+}
+
 template <typename T>
 MatrixSparse<T>::MatrixSparse(const MatrixSparse<T>& A)
     : Matrix<T>(A._m, A._n), _data(0), _ptr(0), _ind(0), _nnz(A._nnz), 
@@ -84,7 +103,7 @@ MatrixSparse<T>::MatrixSparse(const MatrixSparse<T>& A)
 
   GpuData<T> *info_A = reinterpret_cast<GpuData<T>*>(A._info);
   GpuData<T> *info = new GpuData<T>(info_A->orig_data, info_A->orig_ptr,
-      info_A->orig_ind);
+      info_A->orig_ind, info_A->orig_both, info_A->equil_d, info_A->equil_e);
   this->_info = reinterpret_cast<void*>(info);
 }
 
@@ -120,9 +139,12 @@ int MatrixSparse<T>::Init() {
   DEBUG_ASSERT(!this->_done_init);
   if (this->_done_init)
     return 1;
-  this->_done_init = true;
 
+  // A matrix constructed from an invalid matrix file has no data.
   GpuData<T> *info = reinterpret_cast<GpuData<T>*>(this->_info);
+  if (info->orig_data == 0)
+    return 1;
+  this->_done_init = true;
   const T *orig_data = info->orig_data;
   const POGS_INT *orig_ptr = info->orig_ptr;
   const POGS_INT *orig_ind = info->orig_ind;
@@ -133,7 +155,15 @@ int MatrixSparse<T>::Init() {
   cudaMalloc(&_ptr, (this->_m + this->_n + 2) * sizeof(POGS_INT));
   DEBUG_CUDA_CHECK_ERR();
 
-  if (_ord == ROW) {
+  if (info->orig_both) {
+    // The arrays already hold both forms, so copy them as they are.
+    cudaMemcpy(_data, orig_data, static_cast<size_t>(2) * _nnz * sizeof(T),
+        cudaMemcpyHostToDevice);
+    cudaMemcpy(_ind, orig_ind, static_cast<size_t>(2) * _nnz *
+        sizeof(POGS_INT), cudaMemcpyHostToDevice);
+    cudaMemcpy(_ptr, orig_ptr, (this->_m + this->_n + 2) * sizeof(POGS_INT),
+        cudaMemcpyHostToDevice);
+  } else if (_ord == ROW) {
     cml::spmat<T, POGS_INT, CblasRowMajor> A(_data, _ind, _ptr, this->_m,
         this->_n, _nnz);
     cml::spmat_memcpy(info->s_hdl, &A, orig_data, orig_ind, orig_ptr);
@@ -152,6 +182,7 @@ int MatrixSparse<T>::Mul(char trans, T alpha, const T *x, T beta, T *y) const {
   DEBUG_ASSERT(this->_done_init);
   if (!this->_done_init)
     return 1;
+  ++this->_num_mul;
 
   GpuData<T> *info = reinterpret_cast<GpuData<T>*>(this->_info);
 
@@ -180,6 +211,12 @@ int MatrixSparse<T>::Mul(char trans, T alpha, const T *x, T beta, T *y) const {
   return 0;
 }
 
+template <typename T>
+int MatrixSparse<T>::MulAtA(T alpha, const T *x, T *y, T beta, T *z) const {
+  // cuSPARSE has no fused product, so A is read by two calls to Mul.
+  return Matrix<T>::MulAtA(alpha, x, y, beta, z);
+}
+
 template <typename T>
 int MatrixSparse<T>::Equil(T *d, T *e) {
   DEBUG_ASSERT(this->_done_init);
@@ -190,6 +227,16 @@ int MatrixSparse<T>::Equil(T *d, T *e) {
   GpuData<T> *info = reinterpret_cast<GpuData<T>*>(this->_info);
   cublasHandle_t hdl = info->d_hdl;
 
+  // A matrix file may hold the equilibrated matrix and its d and e.
+  if (info->equil_d) {
+    cudaMemcpy(d, info->equil_d, this->_m * sizeof(T),
+        cudaMemcpyHostToDevice);
+    cudaMemcpy(e, info->equil_e, this->_n * sizeof(T),
+        cudaMemcpyHostToDevice);
+    DEBUG_CUDA_CHECK_ERR();
+    return 0;
+  }
+
   // Number of elements in matrix.
   size_t num_el = static_cast<size_t>(2) * _nnz;
 
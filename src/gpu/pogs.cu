@@ -5,6 +5,7 @@
 #include <thrust/transform.h>
 
 #include <algorithm>
+#include <limits>
 
 #include "cml/cml_blas.cuh"
 #include "cml/cml_vector.cuh"
@@ -12,6 +13,7 @@
 #include "matrix/matrix.h"
 #include "matrix/matrix_dense.h"
 #include "matrix/matrix_sparse.h"
+#include "pogs_trace.h"
 #include "projector/projector.h"
 #include "projector/projector_direct.h"
 #include "projector/projector_cgls.h"
@@ -46,20 +48,32 @@ Pogs<T, M, P>::Pogs(const M &A)
       _de(0), _z(0), _zt(0),
       _rho(static_cast<T>(kRhoInit)),
       _done_init(false),
+      _work(0), _work_size(0), _num_alloc(0), _bytes_alloc(0),
+      _aa_work(0), _aa_work_size(0),
       _x(0), _y(0), _mu(0), _lambda(0), _optval(static_cast<T>(0.)),
-      _final_iter(0),
+      _final_iter(0), _num_mul(0), _num_mul_res(0), _cert(0), _stats(),
+      _callback(0), _callback_data(0), _callback_optval(false), _trace(0),
       _abs_tol(static_cast<T>(kAbsTol)),
       _rel_tol(static_cast<T>(kRelTol)),
+      _inf_tol(static_cast<T>(kInfTol)),
       _max_iter(kMaxIter),
       _init_iter(kInitIter),
       _verbose(kVerbose),
+      _stop_check_iter(kStopCheckIter),
+      _stop_check(STOP_CHECK_ALWAYS),
+      _anderson_mem(kAndersonMem),
+      _anderson_type(ANDERSON_TYPE_II),
+      _rho_policy(NewRhoPolicy<T>(RHO_HEURISTIC)),
       _adaptive_rho(kAdaptiveRho),
       _gap_stop(kGapStop),
+      _collect_stats(false),
+      _inexact_prox(kInexactProx),
       _init_x(false), _init_lambda(false) {
   _x = new T[_A.Cols()]();
   _y = new T[_A.Rows()]();
   _mu = new T[_A.Cols()]();
   _lambda = new T[_A.Rows()]();
+  // No certificate without infeasibility detection, so _cert stays null.
 }
 
 template <typename T, typename M, typename P>
@@ -108,6 +122,21 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
   const T kProjTolIni = static_cast<T>(1e-5);
   bool use_exact_stop = true;
 
+  // Anderson acceleration, infeasibility detection and rho policies other
+  // than the heuristic are only implemented by the CPU solver.
+  if (_anderson_mem > 0) {
+    Printf("ERROR Anderson acceleration not supported on the GPU\n");
+    return POGS_ERROR;
+  }
+  if (_inf_tol > kZero) {
+    Printf("ERROR Infeasibility detection not supported on the GPU\n");
+    return POGS_ERROR;
+  }
+  if (dynamic_cast<const RhoPolicyHeuristic<T>*>(_rho_policy) == 0) {
+    Printf("ERROR Only the heuristic rho policy is supported on the GPU\n");
+    return POGS_ERROR;
+  }
+
   // Initialize Projector P and Matrix A.
   if (!_done_init)
     _Init();
@@ -219,7 +248,7 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
   T sqrtmn_atol = std::sqrt(static_cast<T>(m + n)) * _abs_tol;
   T delta = kDeltaMin, xi = static_cast<T>(1.0);
   unsigned int k = 0u, kd = 0u, ku = 0u;
-  bool converged = false;
+  bool converged = false, interrupted = false;
   T nrm_r, nrm_s, gap, eps_gap, eps_pri, eps_dua;
 
   for (;; ++k) {
@@ -295,8 +324,20 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
           k, nrm_r, eps_pri, nrm_s, eps_dua, gap, eps_gap, optval);
     }
 
+    // Report progress.
+    if (_callback || _trace) {
+      PogsIterate<T> it = { k, 0u, nrm_r, eps_pri, nrm_s, eps_dua, gap,
+          eps_gap, _rho, std::numeric_limits<T>::quiet_NaN() };
+      if (_callback_optval && _callback)
+        it.optval = FuncEval(f_gpu, y12.data) + FuncEval(g_gpu, x12.data);
+      if (_trace)
+        _trace->Push(it);
+      if (_callback)
+        interrupted = !_callback(it, _callback_data) && !converged;
+    }
+
     // Break if converged or there are nans
-    if (converged || k == _max_iter - 1){ // || cml::vector_any_isnan(&zt))
+    if (converged || interrupted || k == _max_iter - 1){ // || cml::vector_any_isnan(&zt))
       _final_iter = k;
       break;
     }
@@ -307,7 +348,7 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
     cml::blas_axpy(hdl, -kOne, &z, &zt);
     CUDA_CHECK_ERR();
 
-    // Rescale rho.
+    // Rescale rho (cf. RhoPolicyHeuristic).
     if (_adaptive_rho) {
       if (nrm_s < xi * eps_dua && nrm_r > xi * eps_pri &&
           kTau * static_cast<T>(k) > static_cast<T>(kd)) {
@@ -343,7 +384,9 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
 
   // Check status
   PogsStatus status;
-  if (!converged && k == _max_iter - 1)
+  if (interrupted)
+    status = POGS_INTERRUPTED;
+  else if (!converged && k == _max_iter - 1)
     status = POGS_MAX_ITER;
   else if (!converged && k < _max_iter - 1)
     status = POGS_NAN_FOUND;
@@ -399,6 +442,99 @@ PogsStatus Pogs<T, M, P>::Solve(const std::vector<FunctionObj<T> > &f,
   return status;
 }
 
+template <typename T, typename M, typename P>
+std::vector<PogsStatus> Pogs<T, M, P>::SolveBatch(
+    const std::vector<std::vector<FunctionObj<T> > > &f,
+    const std::vector<std::vector<FunctionObj<T> > > &g) {
+  // The objectives are solved one after another, each starting from the same
+  // solver state.
+  ASSERT(f.size() == g.size());
+  if (!_done_init)
+    _Init();
+
+  size_t m = _A.Rows();
+  size_t n = _A.Cols();
+  size_t K = f.size();
+
+  T *z0, *zt0, rho0 = _rho;
+  cudaMalloc(&z0, (m + n) * sizeof(T));
+  cudaMalloc(&zt0, (m + n) * sizeof(T));
+  cudaMemcpy(z0, _z, (m + n) * sizeof(T), cudaMemcpyDeviceToDevice);
+  cudaMemcpy(zt0, _zt, (m + n) * sizeof(T), cudaMemcpyDeviceToDevice);
+  CUDA_CHECK_ERR();
+
+  _x_batch.resize(K * n);
+  _y_batch.resize(K * m);
+  _mu_batch.resize(K * n);
+  _lambda_batch.resize(K * m);
+  _optval_batch.resize(K);
+  _final_iter_batch.resize(K);
+  std::vector<PogsStatus> status(K);
+  for (size_t k = 0; k < K; ++k) {
+    cudaMemcpy(_z, z0, (m + n) * sizeof(T), cudaMemcpyDeviceToDevice);
+    cudaMemcpy(_zt, zt0, (m + n) * sizeof(T), cudaMemcpyDeviceToDevice);
+    _rho = rho0;
+    status[k] = Solve(f[k], g[k]);
+    memcpy(&_x_batch[k * n], _x, n * sizeof(T));
+    memcpy(&_y_batch[k * m], _y, m * sizeof(T));
+    memcpy(&_mu_batch[k * n], _mu, n * sizeof(T));
+    memcpy(&_lambda_batch[k * m], _lambda, m * sizeof(T));
+    _optval_batch[k] = _optval;
+    _final_iter_batch[k] = _final_iter;
+  }
+
+  cudaMemcpy(_z, z0, (m + n) * sizeof(T), cudaMemcpyDeviceToDevice);
+  cudaMemcpy(_zt, zt0, (m + n) * sizeof(T), cudaMemcpyDeviceToDevice);
+  _rho = rho0;
+  cudaFree(z0);
+  cudaFree(zt0);
+  CUDA_CHECK_ERR();
+
+  return status;
+}
+
+namespace {
+
+// Expands f to FunctionObj's, which are copied to the device by Solve. Block
+// and custom functions have no FunctionObj form, in which case an error is
+// printed and false is returned.
+template <typename T>
+bool ExpandFunctionSoA(const FunctionSoA<T> &f,
+                       std::vector<FunctionObj<T> > *f_obj) {
+  if (f.NumBlocks() > 0 || f.NumCustom() > 0) {
+    Printf("ERROR Block and custom functions not supported on the GPU\n");
+    return false;
+  }
+  f_obj->resize(f.Size());
+  for (size_t i = 0; i < f.Size(); ++i)
+    (*f_obj)[i] = f[i];
+  return true;
+}
+
+}  // namespace
+
+template <typename T, typename M, typename P>
+PogsStatus Pogs<T, M, P>::Solve(const FunctionSoA<T> &f,
+                                const FunctionSoA<T> &g) {
+  std::vector<FunctionObj<T> > f_obj, g_obj;
+  if (!ExpandFunctionSoA(f, &f_obj) || !ExpandFunctionSoA(g, &g_obj))
+    return POGS_ERROR;
+  return Solve(f_obj, g_obj);
+}
+
+template <typename T, typename M, typename P>
+std::vector<PogsStatus> Pogs<T, M, P>::SolveBatch(
+    const std::vector<FunctionSoA<T> > &f,
+    const std::vector<FunctionSoA<T> > &g) {
+  std::vector<std::vector<FunctionObj<T> > > f_obj(f.size()), g_obj(g.size());
+  for (size_t k = 0; k < f.size(); ++k) {
+    if (!ExpandFunctionSoA(f[k], &f_obj[k]) ||
+        !ExpandFunctionSoA(g[k], &g_obj[k]))
+      return std::vector<PogsStatus>(f.size(), POGS_ERROR);
+  }
+  return SolveBatch(f_obj, g_obj);
+}
+
 template <typename T, typename M, typename P>
 Pogs<T, M, P>::~Pogs() {
   cudaFree(_de);
@@ -411,7 +547,11 @@ Pogs<T, M, P>::~Pogs() {
   delete [] _y;
   delete [] _mu;
   delete [] _lambda;
-  _x = _y = _mu = _lambda = 0;
+  delete [] _cert;
+  _x = _y = _mu = _lambda = _cert = 0;
+
+  delete _rho_policy;
+  _rho_policy = 0;
 }
 
 // Explicit template instantiation.
@@ -210,6 +210,110 @@ int ProjectorDirect<T, M>::Project(const T *x0, const T *y0, T s, T *x, T *y,
   return 0;
 }
 
+template <typename T, typename M>
+int ProjectorDirect<T, M>::ProjectBatch(size_t K, const T *x0, const T *y0,
+                                        size_t ld, T s, T *x, T *y, T tol) {
+  DEBUG_EXPECT(this->_done_init);
+  if (!this->_done_init || s < static_cast<T>(0.))
+    return 1;
+
+  GpuData<T> *info = reinterpret_cast<GpuData<T>*>(this->_info);
+  cublasHandle_t hdl = info->handle;
+
+  size_t m = _A.Rows();
+  size_t n = _A.Cols();
+  size_t min_dim = std::min(m, n);
+  bool row = _A.Order() == MatrixDense<T>::ROW;
+
+  if (s != info->s) {
+    if (row) {
+      cml::matrix<T, CblasRowMajor> AA =
+          cml::matrix_view_array<T, CblasRowMajor>(info->AA, min_dim, min_dim);
+      cml::matrix<T, CblasRowMajor> L =
+          cml::matrix_view_array<T, CblasRowMajor>(info->L, min_dim, min_dim);
+      cml::matrix_memcpy(&L, &AA);
+      cml::vector<T> diagL = cml::matrix_diagonal(&L);
+      cml::vector_add_constant(&diagL, s);
+      cudaDeviceSynchronize();
+      cml::linalg_cholesky_decomp(hdl, &L);
+    } else {
+      cml::matrix<T, CblasColMajor> AA =
+          cml::matrix_view_array<T, CblasColMajor>(info->AA, min_dim, min_dim);
+      cml::matrix<T, CblasColMajor> L =
+          cml::matrix_view_array<T, CblasColMajor>(info->L, min_dim, min_dim);
+      cml::matrix_memcpy(&L, &AA);
+      cml::vector<T> diagL = cml::matrix_diagonal(&L);
+      cml::vector_add_constant(&diagL, s);
+      cudaDeviceSynchronize();
+      cml::linalg_cholesky_decomp(hdl, &L);
+    }
+    cudaDeviceSynchronize();
+    CUDA_CHECK_ERR();
+  }
+
+  // The K points are the columns of column major matrices with leading
+  // dimension ld. A row major A (resp. L) is viewed as the column major A^T
+  // (resp. L^T), so opA applies A and opAt applies A^T in either case.
+  const cml::matrix<T, CblasColMajor> A = row ?
+      cml::matrix_view_array<T, CblasColMajor>(_A.Data(), n, m) :
+      cml::matrix_view_array<T, CblasColMajor>(_A.Data(), m, n);
+  const cml::matrix<T, CblasColMajor> L =
+      cml::matrix_view_array<T, CblasColMajor>(info->L, min_dim, min_dim);
+  cublasOperation_t opA = row ? CUBLAS_OP_T : CUBLAS_OP_N;
+  cublasOperation_t opAt = row ? CUBLAS_OP_N : CUBLAS_OP_T;
+  cublasFillMode_t uplo = row ? CUBLAS_FILL_MODE_UPPER : CUBLAS_FILL_MODE_LOWER;
+
+  cml::matrix<T, CblasColMajor> X =
+      cml::matrix_view_array_with_tda<T, CblasColMajor>(x, n, K, ld);
+  cml::matrix<T, CblasColMajor> Y =
+      cml::matrix_view_array_with_tda<T, CblasColMajor>(y, m, K, ld);
+
+  // Set (x, y) = (x0, y0).
+  cudaMemcpy2D(x, ld * sizeof(T), x0, ld * sizeof(T), n * sizeof(T), K,
+      cudaMemcpyDeviceToDevice);
+  cudaMemcpy2D(y, ld * sizeof(T), y0, ld * sizeof(T), m * sizeof(T), K,
+      cudaMemcpyDeviceToDevice);
+  CUDA_CHECK_ERR();
+
+  if (m > n) {
+    cml::blas_gemm(hdl, opAt, CUBLAS_OP_N, static_cast<T>(1.), &A, &Y,
+        static_cast<T>(1.), &X);
+    cml::blas_trsm(hdl, CUBLAS_SIDE_LEFT, uplo, opA, CUBLAS_DIAG_NON_UNIT,
+        static_cast<T>(1.), &L, &X);
+    cml::blas_trsm(hdl, CUBLAS_SIDE_LEFT, uplo, opAt, CUBLAS_DIAG_NON_UNIT,
+        static_cast<T>(1.), &L, &X);
+    cml::blas_gemm(hdl, opA, CUBLAS_OP_N, static_cast<T>(1.), &A, &X,
+        static_cast<T>(0.), &Y);
+  } else {
+    cml::blas_gemm(hdl, opA, CUBLAS_OP_N, static_cast<T>(1.), &A, &X,
+        static_cast<T>(-1.), &Y);
+    cml::blas_trsm(hdl, CUBLAS_SIDE_LEFT, uplo, opA, CUBLAS_DIAG_NON_UNIT,
+        static_cast<T>(1.), &L, &Y);
+    cml::blas_trsm(hdl, CUBLAS_SIDE_LEFT, uplo, opAt, CUBLAS_DIAG_NON_UNIT,
+        static_cast<T>(1.), &L, &Y);
+    cml::blas_gemm(hdl, opAt, CUBLAS_OP_N, static_cast<T>(-1.), &A, &Y,
+        static_cast<T>(1.), &X);
+    for (size_t j = 0; j < K; ++j) {
+      cml::vector<T> y_vec = cml::vector_view_array(y + j * ld, m);
+      const cml::vector<T> y0_vec = cml::vector_view_array(y0 + j * ld, m);
+      cml::blas_axpy(hdl, static_cast<T>(1.), &y0_vec, &y_vec);
+    }
+  }
+  cudaDeviceSynchronize();
+  CUDA_CHECK_ERR();
+
+#ifdef DEBUG
+  // Verify that projection was successful.
+  for (size_t j = 0; j < K; ++j) {
+    CheckProjection(&_A, x0 + j * ld, y0 + j * ld, x + j * ld, y + j * ld, s,
+        static_cast<T>(1e3) * std::numeric_limits<T>::epsilon());
+  }
+#endif
+
+  info->s = s;
+  return 0;
+}
+
 #if !defined(POGS_DOUBLE) || POGS_DOUBLE==1
 template class ProjectorDirect<double, MatrixDense<double> >;
 #endif
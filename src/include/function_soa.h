@@ -0,0 +1,1029 @@
+#ifndef FUNCTION_SOA_H_
+#define FUNCTION_SOA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+#include "prox_lib_block.h"
+#include "prox_lib_piecewise.h"
+#include "prox_lib_simd.h"
+#include "util.h"
+
+// Maximum length of a segment, so that long runs are split over threads.
+const size_t kSoaSegment = 1024;
+
+// Run of consecutive elements [begin, end) with the same function h.
+struct FunctionSegment {
+  size_t begin, end;
+  Function h;
+};
+
+// Block of consecutive elements [begin, end) with the block function
+//   c * h(a_begin:end .* x - b_begin:end) + sum_i d_i * x_i + (1/2) e_i x_i^2,
+// where a, b, d and e are the parameters of the elements in the block.
+template <typename T>
+struct FunctionBlock {
+  size_t begin, end;
+  BlockFunction h;
+  T c;
+};
+
+// Custom function h of a run of elements, see FunctionSoA::AddCustom.
+template <typename T>
+class CustomFunction;
+template <typename HF, typename T>
+class CustomFunctionImpl;
+
+// Run of consecutive elements [begin, end) with the same custom function h.
+template <typename T>
+struct FunctionCustom {
+  size_t begin, end;
+  std::shared_ptr<const CustomFunction<T> > h;
+};
+
+// Diagonal scaling of the arguments, ie. element i is evaluated as
+// f_i(s_i * x) (kScaleMul) or as f_i(x / s_i) (kScaleDiv).
+enum FunctionScale { kScaleNone, kScaleMul, kScaleDiv };
+
+// Parameter stream of a FunctionSoA, either a scalar that is broadcast to all
+// elements or one value per element. A broadcast scalar is stored as a block
+// of kSoaSegment copies, so that the kernels read every stream of a segment
+// through a contiguous pointer without knowing which kind it is.
+template <typename U>
+class SoaStream {
+ private:
+  std::vector<U> _data;
+  bool _broadcast;
+
+ public:
+  SoaStream() : _broadcast(true) { }
+
+  // The Assign methods return the number of allocations (0 or 1).
+  unsigned int Assign(U x, size_t size) {
+    size_t capacity = _data.capacity();
+    _broadcast = true;
+    _data.assign(std::min(size, kSoaSegment), x);
+    return _data.capacity() != capacity;
+  }
+  unsigned int Assign(const U *x, size_t size) {
+    size_t capacity = _data.capacity();
+    _broadcast = false;
+    _data.assign(x, x + size);
+    return _data.capacity() != capacity;
+  }
+
+  // Assigns the field of every element of x, or of x[0] if they are all
+  // equal.
+  template <typename F>
+  unsigned int AssignCompressed(const std::vector<F> &x, U F::*field) {
+    size_t size = x.size();
+    size_t i = 1;
+    while (i < size && x[i].*field == x[0].*field)
+      ++i;
+    if (size > 0 && i == size)
+      return Assign(x[0].*field, size);
+    size_t capacity = _data.capacity();
+    _broadcast = false;
+    _data.resize(size);
+    for (i = 0; i < size; ++i)
+      _data[i] = x[i].*field;
+    return _data.capacity() != capacity;
+  }
+
+  // Sets the negative values to zero, returns true if there were any.
+  bool ClampNonNeg() {
+    bool neg = false;
+    for (size_t i = 0; i < _data.size(); ++i) {
+      neg = neg || _data[i] < static_cast<U>(0);
+      _data[i] = std::max(_data[i], static_cast<U>(0));
+    }
+    return neg;
+  }
+
+  // Allocates storage for size values.
+  unsigned int Reserve(size_t size) {
+    size_t capacity = _data.capacity();
+    _data.reserve(size);
+    return _data.capacity() != capacity;
+  }
+
+  bool Broadcast() const { return _broadcast; }
+  size_t Bytes() const { return _data.capacity() * sizeof(U); }
+
+  // Values of the segment starting at element begin.
+  const U* Segment(size_t begin) const {
+    return _broadcast ? _data.data() : _data.data() + begin;
+  }
+  U operator[](size_t i) const { return _data[_broadcast ? 0 : i]; }
+};
+
+// Structure-of-arrays representation of the functions
+//
+//   f_i(x) = c_i * h_i(a_i * x - b_i) + d_i * x + (1/2) e_i * x^2,
+//
+// where each parameter (h, a, b, c, d and e) is either a scalar shared by all
+// elements or one value per element. The elements are split into segments
+// with the same h, so that the kernels below dispatch on h once per segment
+// rather than once per element.
+//
+// Runs of elements may instead be grouped into blocks (see AddBlock) with a
+// block function of prox_lib_block.h, in which case h and c of these elements
+// are ignored. Blocks are evaluated one per thread, after the segments.
+// Runs of elements may also be set to a custom function h (see AddCustom),
+// which is evaluated in segments as the built-in functions, such as the
+// piecewise-linear and piecewise-quadratic functions of prox_lib_piecewise.h.
+//
+// A FunctionSoA can be built directly with the Set methods (parameters that
+// are not set keep their default values h = kZero, a = c = 1, b = d = e = 0),
+// or converted from a std::vector<FunctionObj<T> > with Assign, in which case
+// parameters that are the same for all elements are stored as scalars.
+template <typename T>
+class FunctionSoA {
+ private:
+  size_t _size;
+  SoaStream<Function> _h;
+  SoaStream<T> _a, _b, _c, _d, _e;
+  std::vector<FunctionSegment> _seg;
+  std::vector<FunctionBlock<T> > _blk;
+  std::vector<FunctionCustom<T> > _custom;
+  std::vector<std::pair<size_t, size_t> > _skip;
+  unsigned int _num_alloc;
+
+  // Splits the elements that are neither in a block nor custom into
+  // segments.
+  void InitSegments() {
+    std::vector<std::pair<size_t, size_t> > &skip = _skip;
+    size_t capacity_skip = skip.capacity(), capacity_seg = _seg.capacity();
+    skip.clear();
+    for (size_t i = 0; i < _blk.size(); ++i)
+      skip.push_back(std::make_pair(_blk[i].begin, _blk[i].end));
+    for (size_t i = 0; i < _custom.size(); ++i)
+      skip.push_back(std::make_pair(_custom[i].begin, _custom[i].end));
+    std::sort(skip.begin(), skip.end());
+
+    _seg.clear();
+    size_t i_skip = 0;
+    for (size_t begin = 0; begin < _size; ) {
+      if (i_skip < skip.size() && skip[i_skip].first == begin) {
+        begin = skip[i_skip++].second;
+        continue;
+      }
+      size_t end = i_skip < skip.size() ? skip[i_skip].first : _size;
+      FunctionSegment seg = { begin, begin + 1, _h[begin] };
+      while (seg.end < end && seg.end - begin < kSoaSegment &&
+          _h[seg.end] == seg.h)
+        ++seg.end;
+      _seg.push_back(seg);
+      begin = seg.end;
+    }
+    _num_alloc += (skip.capacity() != capacity_skip) +
+        (_seg.capacity() != capacity_seg);
+  }
+
+  // Same check as FunctionObj<T>::CheckConsts, for c and e.
+  void AssignNonNeg(const T *x, SoaStream<T> *stream, const char *name) {
+    _num_alloc += stream->Assign(x, _size);
+    if (stream->ClampNonNeg())
+      Printf("WARNING %s < 0. Function not convex. Using %s = 0", name, name);
+  }
+  void AssignNonNeg(T x, SoaStream<T> *stream, const char *name) {
+    if (x < static_cast<T>(0))
+      Printf("WARNING %s < 0. Function not convex. Using %s = 0", name, name);
+    _num_alloc += stream->Assign(std::max(x, static_cast<T>(0)), _size);
+  }
+
+  // Returns true if [begin, end) overlaps a block or a custom run.
+  bool Overlaps(size_t begin, size_t end) const {
+    for (size_t i = 0; i < _blk.size(); ++i) {
+      if (begin < _blk[i].end && _blk[i].begin < end)
+        return true;
+    }
+    for (size_t i = 0; i < _custom.size(); ++i) {
+      if (begin < _custom[i].end && _custom[i].begin < end)
+        return true;
+    }
+    return false;
+  }
+
+ public:
+  explicit FunctionSoA(size_t size = 0) : _num_alloc(0) { Resize(size); }
+
+  // Resets to size elements with default parameters.
+  void Resize(size_t size) {
+    _size = size;
+    _num_alloc += _h.Assign(kZero, size) +
+        _a.Assign(static_cast<T>(1), size) +
+        _b.Assign(static_cast<T>(0), size) +
+        _c.Assign(static_cast<T>(1), size) +
+        _d.Assign(static_cast<T>(0), size) +
+        _e.Assign(static_cast<T>(0), size);
+    _blk.clear();
+    _custom.clear();
+    InitSegments();
+  }
+
+  // Allocates the storage of every parameter stream and of the segments for
+  // size elements, so that later calls to Assign with up to size elements
+  // do not allocate.
+  void Reserve(size_t size) {
+    size_t capacity_seg = _seg.capacity();
+    _seg.reserve(size);
+    _num_alloc += _h.Reserve(size) + _a.Reserve(size) + _b.Reserve(size) +
+        _c.Reserve(size) + _d.Reserve(size) + _e.Reserve(size) +
+        (_seg.capacity() != capacity_seg);
+  }
+
+  // Converts f, returns the number of bytes allocated (if any).
+  size_t Assign(const std::vector<FunctionObj<T> > &f) {
+    size_t bytes = Bytes();
+    _size = f.size();
+    typedef FunctionObj<T> F;
+    _num_alloc += _h.AssignCompressed(f, &F::h) +
+        _a.AssignCompressed(f, &F::a) + _b.AssignCompressed(f, &F::b) +
+        _c.AssignCompressed(f, &F::c) + _d.AssignCompressed(f, &F::d) +
+        _e.AssignCompressed(f, &F::e);
+    _blk.clear();
+    _custom.clear();
+    InitSegments();
+    return Bytes() > bytes ? Bytes() - bytes : 0;
+  }
+
+  // Sets a parameter to a scalar (broadcast to all elements), or to an array
+  // of Size() values (which is copied).
+  void SetH(Function h) { _num_alloc += _h.Assign(h, _size); InitSegments(); }
+  void SetH(const Function *h) {
+    _num_alloc += _h.Assign(h, _size);
+    InitSegments();
+  }
+  void SetA(T a) { _num_alloc += _a.Assign(a, _size); }
+  void SetA(const T *a) { _num_alloc += _a.Assign(a, _size); }
+  void SetB(T b) { _num_alloc += _b.Assign(b, _size); }
+  void SetB(const T *b) { _num_alloc += _b.Assign(b, _size); }
+  void SetC(T c) { AssignNonNeg(c, &_c, "c"); }
+  void SetC(const T *c) { AssignNonNeg(c, &_c, "c"); }
+  void SetD(T d) { _num_alloc += _d.Assign(d, _size); }
+  void SetD(const T *d) { _num_alloc += _d.Assign(d, _size); }
+  void SetE(T e) { AssignNonNeg(e, &_e, "e"); }
+  void SetE(const T *e) { AssignNonNeg(e, &_e, "e"); }
+
+  // Groups the elements [begin, end) into a block with the block function
+  // c * h(a .* x - b) + sum_i d_i * x_i + (1/2) e_i * x_i^2. Blocks may not
+  // overlap each other or custom runs, and the parameters a of the elements
+  // in a block must be nonzero.
+  void AddBlock(BlockFunction h, size_t begin, size_t end,
+                T c = static_cast<T>(1)) {
+    ASSERT(begin < end && end <= _size && !Overlaps(begin, end));
+    if (c < static_cast<T>(0)) {
+      Printf("WARNING c < 0. Function not convex. Using c = 0");
+      c = static_cast<T>(0);
+    }
+    typename std::vector<FunctionBlock<T> >::iterator it = _blk.begin();
+    while (it != _blk.end() && it->end <= begin)
+      ++it;
+    FunctionBlock<T> blk = { begin, end, h, c };
+    size_t capacity = _blk.capacity();
+    _blk.insert(it, blk);
+    _num_alloc += _blk.capacity() != capacity;
+    InitSegments();
+  }
+
+  // Sets the elements [begin, end) to the custom function h in place of
+  // their h, ie. to c_i * h(a_i * x - b_i) + d_i * x + (1/2) e_i * x^2. The
+  // function object h is copied and must provide
+  //
+  //   T Prox(T v, T rho) const;       // argmin_x h(x) + (rho / 2) (x - v)^2
+  //   T Func(T x) const;              // h(x)
+  //   T ProjSubgrad(T v, T x) const;  // projection of v onto dh(x)
+  //
+  // These are inlined into the loops of the segment kernels exactly as the
+  // built-in functions (see FunctionH), with a single indirect call per
+  // segment, and are vectorized if they are branch free. The run may not
+  // overlap blocks or other custom runs. Custom elements are never part of an
+  // infeasibility or unboundedness certificate.
+  template <typename HF>
+  void AddCustom(const HF &h, size_t begin, size_t end) {
+    ASSERT(begin < end && end <= _size && !Overlaps(begin, end));
+    std::shared_ptr<const CustomFunction<T> > h_ptr(
+        new CustomFunctionImpl<HF, T>(h));
+    _num_alloc += 2;  // The function object and the shared count.
+    typename std::vector<FunctionCustom<T> >::iterator it = _custom.begin();
+    while (it != _custom.end() && it->end <= begin)
+      ++it;
+    for (size_t i = begin; i < end; i += kSoaSegment) {
+      FunctionCustom<T> seg = { i, std::min(i + kSoaSegment, end), h_ptr };
+      size_t capacity = _custom.capacity();
+      it = _custom.insert(it, seg) + 1;
+      _num_alloc += _custom.capacity() != capacity;
+    }
+    InitSegments();
+  }
+
+  size_t Size() const { return _size; }
+
+  // Number of heap allocations made so far by the Set, Add, Resize, Reserve
+  // and Assign methods.
+  unsigned int NumAlloc() const { return _num_alloc; }
+
+  // Bytes of storage used by the parameters.
+  size_t Bytes() const {
+    return _h.Bytes() + _a.Bytes() + _b.Bytes() + _c.Bytes() + _d.Bytes() +
+        _e.Bytes() + _blk.capacity() * sizeof(FunctionBlock<T>) +
+        _custom.capacity() * sizeof(FunctionCustom<T>);
+  }
+
+  // Returns the i-th function object (of the elements in a block, the
+  // parameters a, b, d and e apply).
+  FunctionObj<T> operator[](size_t i) const {
+    FunctionObj<T> f_obj;
+    f_obj.h = _h[i];
+    f_obj.a = _a[i];
+    f_obj.b = _b[i];
+    f_obj.c = _c[i];
+    f_obj.d = _d[i];
+    f_obj.e = _e[i];
+    return f_obj;
+  }
+
+  // Segments, in order.
+  size_t NumSegments() const { return _seg.size(); }
+  const FunctionSegment* Segments() const { return _seg.data(); }
+
+  // Blocks, in order.
+  size_t NumBlocks() const { return _blk.size(); }
+  const FunctionBlock<T>* Blocks() const { return _blk.data(); }
+
+  // Custom runs, in order and split into segments.
+  size_t NumCustom() const { return _custom.size(); }
+  const FunctionCustom<T>* Custom() const { return _custom.data(); }
+
+  // Parameters of the segment starting at element begin.
+  const T* A(size_t begin) const { return _a.Segment(begin); }
+  const T* B(size_t begin) const { return _b.Segment(begin); }
+  const T* C(size_t begin) const { return _c.Segment(begin); }
+  const T* D(size_t begin) const { return _d.Segment(begin); }
+  const T* E(size_t begin) const { return _e.Segment(begin); }
+};
+
+// Applies the scaling S by s to a parameter that scales the argument.
+template <FunctionScale S, typename T>
+inline T ScaleParam(T x, T s) {
+  return S == kScaleMul ? x * s : (S == kScaleDiv ? x / s : x);
+}
+
+// Returns f_obj with the scaling of its argument by s applied to a, d and e.
+template <typename T>
+inline FunctionObj<T> ScaleFunction(FunctionObj<T> f_obj, FunctionScale type,
+                                    T s) {
+  if (type == kScaleMul) {
+    f_obj.a = ScaleParam<kScaleMul>(f_obj.a, s);
+    f_obj.d = ScaleParam<kScaleMul>(f_obj.d, s);
+    f_obj.e = ScaleParam<kScaleMul>(ScaleParam<kScaleMul>(f_obj.e, s), s);
+  } else if (type == kScaleDiv) {
+    f_obj.a = ScaleParam<kScaleDiv>(f_obj.a, s);
+    f_obj.d = ScaleParam<kScaleDiv>(f_obj.d, s);
+    f_obj.e = ScaleParam<kScaleDiv>(ScaleParam<kScaleDiv>(f_obj.e, s), s);
+  }
+  return f_obj;
+}
+
+// Built-in function h as a function object, with the interface of the custom
+// functions of FunctionSoA::AddCustom. The segment kernels are templates on
+// the function object, so that each instantiation sees h (and the accuracy P
+// of its proximal operator) as a compile time constant.
+template <Function H, ProxAccuracy P = kProxExact>
+struct FunctionH {
+  template <typename T>
+  __SIMD_INLINE__ T Prox(T v, T rho) const {
+    return ProxEvalSimdH<P>(H, v, rho);
+  }
+  template <typename T>
+  __SIMD_INLINE__ T Func(T x) const { return FuncEvalH(H, x); }
+  template <typename T>
+  __SIMD_INLINE__ T ProjSubgrad(T v, T x) const {
+    return ProjSubgradEvalH(H, v, x);
+  }
+};
+
+// Dispatches k.Run over a segment with the function H, at the accuracy k.acc
+// for the kernels that evaluate the proximal operator (K::kInexact), and at
+// kProxExact for the others, which need not be instantiated per accuracy.
+template <bool kInexact>
+struct AccuracyDispatch {
+  template <Function H, typename K>
+  static typename K::value_type Run(const K &k, size_t begin, size_t end) {
+    return k.Run(FunctionH<H>(), begin, end);
+  }
+};
+
+template <>
+struct AccuracyDispatch<true> {
+  template <Function H, typename K>
+  static typename K::value_type Run(const K &k, size_t begin, size_t end) {
+    switch (k.acc) {
+      case kProxCoarse:
+        return k.Run(FunctionH<H, kProxCoarse>(), begin, end);
+      case kProxMedium:
+        return k.Run(FunctionH<H, kProxMedium>(), begin, end);
+      case kProxExact: default:
+        return k.Run(FunctionH<H>(), begin, end);
+    }
+  }
+};
+
+// Dispatches the kernel k over elements [begin, end), all of which have
+// the same h, to k.Run with FunctionH<h>. The switch in ProxEvalH (etc.) is
+// thus folded away and the loop over the segment is branch-free. Returns the
+// value of k.Run.
+template <typename K>
+inline typename K::value_type DispatchSegment(const K &k, Function h,
+                                              size_t begin, size_t end) {
+  switch (h) {
+    case kAbs: return k.Run(FunctionH<kAbs>(), begin, end);
+    case kExp:
+      return AccuracyDispatch<K::kInexact>::template Run<kExp>(k, begin,
+          end);
+    case kHuber: return k.Run(FunctionH<kHuber>(), begin, end);
+    case kIdentity: return k.Run(FunctionH<kIdentity>(), begin, end);
+    case kIndBox01: return k.Run(FunctionH<kIndBox01>(), begin, end);
+    case kIndEq0: return k.Run(FunctionH<kIndEq0>(), begin, end);
+    case kIndGe0: return k.Run(FunctionH<kIndGe0>(), begin, end);
+    case kIndLe0: return k.Run(FunctionH<kIndLe0>(), begin, end);
+    case kLogistic:
+      return AccuracyDispatch<K::kInexact>::template Run<kLogistic>(k, begin,
+          end);
+    case kMaxNeg0: return k.Run(FunctionH<kMaxNeg0>(), begin, end);
+    case kMaxPos0: return k.Run(FunctionH<kMaxPos0>(), begin, end);
+    case kNegEntr:
+      return AccuracyDispatch<K::kInexact>::template Run<kNegEntr>(k, begin,
+          end);
+    case kNegLog: return k.Run(FunctionH<kNegLog>(), begin, end);
+    case kRecipr: return k.Run(FunctionH<kRecipr>(), begin, end);
+    case kSquare: return k.Run(FunctionH<kSquare>(), begin, end);
+    case kZero: default: return k.Run(FunctionH<kZero>(), begin, end);
+  }
+}
+
+// Base of the segment kernels, dispatches Run(h, ...) to K::Loop<HF, S> on
+// the scaling type S, so that the scaling is also a compile time constant.
+template <typename K, typename T>
+struct SegmentKernel {
+  typedef T value_type;
+  static const bool kInexact = false;
+  const FunctionSoA<T> &f;
+  const T *s;
+  FunctionScale type;
+  SegmentKernel(const FunctionSoA<T> &f, const T *s, FunctionScale type)
+      : f(f), s(s), type(type) { }
+
+  template <typename HF>
+  T Run(const HF &h, size_t begin, size_t end) const {
+    const K &k = static_cast<const K&>(*this);
+    switch (type) {
+      case kScaleMul: return k.template Loop<HF, kScaleMul>(h, begin, end);
+      case kScaleDiv: return k.template Loop<HF, kScaleDiv>(h, begin, end);
+      case kScaleNone: default:
+        return k.template Loop<HF, kScaleNone>(h, begin, end);
+    }
+  }
+};
+
+// Returns element i of f, with the scaling of its argument by s applied.
+template <typename T>
+inline FunctionObj<T> ScaledElement(const FunctionSoA<T> &f, const T *s,
+                                    FunctionScale type, size_t i) {
+  return ScaleFunction(f[i], type, type == kScaleNone ? static_cast<T>(1) :
+      s[i]);
+}
+
+// Block functions. Each element of the block is scaled as in ScaleFunction,
+// and h is evaluated by prox_lib_block.h in the coordinates u = a .* x - b.
+// The vector work is resized as needed, so that it can be reused across the
+// blocks evaluated by one thread.
+
+// Evaluates the proximal operator of the block blk, x_in -> x_out, where
+//   u = argmin_u c * h(u) + sum_i (e_i + rho) / (2 a_i^2) (u_i - z_i)^2,
+//   z_i = a_i * (rho * x_in_i - d_i) / (e_i + rho) - b_i.
+template <typename T>
+void ProxBlock(const FunctionSoA<T> &f, const FunctionBlock<T> &blk,
+               const T *s, FunctionScale type, T rho, const T *x_in, T *x_out,
+               std::vector<T> *work) {
+  size_t k = blk.end - blk.begin;
+  T c = BlockIndicator(blk.h) ? static_cast<T>(1) : blk.c;
+  work->resize(k);
+  T *w = work->data();
+  for (size_t j = 0; j < k; ++j) {
+    size_t i = blk.begin + j;
+    FunctionObj<T> f_i = ScaledElement(f, s, type, i);
+    T r = f_i.e + rho;
+    x_out[i] = f_i.a * (x_in[i] * rho - f_i.d) / r - f_i.b;
+    w[j] = r / (c * f_i.a * f_i.a);
+  }
+  if (c > static_cast<T>(0))
+    ProxBlockH(blk.h, k, x_out + blk.begin, w, x_out + blk.begin);
+  for (size_t i = blk.begin; i < blk.end; ++i) {
+    FunctionObj<T> f_i = ScaledElement(f, s, type, i);
+    x_out[i] = (x_out[i] + f_i.b) / f_i.a;
+  }
+}
+
+// Returns the value of the block blk at x_in.
+template <typename T>
+T FuncBlock(const FunctionSoA<T> &f, const FunctionBlock<T> &blk, const T *s,
+            FunctionScale type, const T *x_in, std::vector<T> *work) {
+  size_t k = blk.end - blk.begin;
+  work->resize(k);
+  T *u = work->data();
+  T sum = 0;
+  for (size_t j = 0; j < k; ++j) {
+    size_t i = blk.begin + j;
+    FunctionObj<T> f_i = ScaledElement(f, s, type, i);
+    T x = x_in[i];
+    u[j] = f_i.a * x - f_i.b;
+    sum += f_i.d * x + f_i.e * x * x / 2;
+  }
+  return sum + blk.c * FuncBlockH(blk.h, k, u);
+}
+
+// Projects v_in onto the subdifferential of the block blk at x_in -> v_out.
+// As for the scalar functions, the projection is taken in the coordinates u.
+template <typename T>
+void ProjSubgradBlock(const FunctionSoA<T> &f, const FunctionBlock<T> &blk,
+                      const T *s, FunctionScale type, const T *x_in,
+                      const T *v_in, T *v_out, std::vector<T> *work) {
+  size_t k = blk.end - blk.begin;
+  T c = BlockIndicator(blk.h) ? static_cast<T>(1) : blk.c;
+  work->resize(2 * k);
+  T *u = work->data(), *v = work->data() + k;
+  for (size_t j = 0; j < k; ++j) {
+    size_t i = blk.begin + j;
+    FunctionObj<T> f_i = ScaledElement(f, s, type, i);
+    T x = x_in[i];
+    u[j] = f_i.a * x - f_i.b;
+    v[j] = c > static_cast<T>(0) ?
+        (v_in[i] - f_i.d - f_i.e * x) / (f_i.a * c) : static_cast<T>(0);
+  }
+  if (c > static_cast<T>(0))
+    ProjSubgradBlockH(blk.h, k, u, v);
+  for (size_t j = 0; j < k; ++j) {
+    size_t i = blk.begin + j;
+    FunctionObj<T> f_i = ScaledElement(f, s, type, i);
+    v_out[i] = f_i.a * c * v[j] + f_i.d + f_i.e * x_in[i];
+  }
+}
+
+// Returns sup {v^T x : x in dom f} over the block blk, where entries of v
+// with |v_i| <= tol are treated as zero.
+template <typename T>
+T DomainSupportBlock(const FunctionSoA<T> &f, const FunctionBlock<T> &blk,
+                     const T *s, FunctionScale type, const T *v_in, T tol,
+                     std::vector<T> *work) {
+  size_t k = blk.end - blk.begin;
+  work->resize(k);
+  T *y = work->data();
+  T sum = 0;
+  for (size_t j = 0; j < k; ++j) {
+    size_t i = blk.begin + j;
+    FunctionObj<T> f_i = ScaledElement(f, s, type, i);
+    if (std::abs(v_in[i]) <= tol) {
+      y[j] = static_cast<T>(0);
+    } else if (f_i.a == static_cast<T>(0)) {
+      return std::numeric_limits<T>::infinity();
+    } else {
+      // v_i x_i = y_i (u_i + b_i).
+      y[j] = v_in[i] / f_i.a;
+      sum += y[j] * f_i.b;
+    }
+  }
+  return sum + DomainSupportBlockH(blk.h, k, y, tol);
+}
+
+// Returns the recession function of the block blk at v_in, where entries of
+// v_in with |v_i| <= tol are treated as zero.
+template <typename T>
+T RecessionBlock(const FunctionSoA<T> &f, const FunctionBlock<T> &blk,
+                 const T *s, FunctionScale type, const T *v_in, T tol,
+                 std::vector<T> *work) {
+  size_t k = blk.end - blk.begin;
+  work->resize(k);
+  T *y = work->data();
+  T sum = 0;
+  for (size_t j = 0; j < k; ++j) {
+    size_t i = blk.begin + j;
+    FunctionObj<T> f_i = ScaledElement(f, s, type, i);
+    y[j] = static_cast<T>(0);
+    if (std::abs(v_in[i]) <= tol)
+      continue;
+    if (f_i.e > static_cast<T>(0))
+      return std::numeric_limits<T>::infinity();
+    y[j] = f_i.a * v_in[i];
+    sum += f_i.d * v_in[i];
+  }
+  T rec = RecessionBlockH(blk.h, k, y, tol);
+  if (!BlockIndicator(blk.h))
+    rec = blk.c == static_cast<T>(0) ? static_cast<T>(0) : blk.c * rec;
+  return sum + rec;
+}
+
+// Evaluates the kernel k over the blocks of f, in parallel over the blocks,
+// and returns the sum of k.Block.
+template <typename K, typename T>
+T EvalBlocks(const FunctionSoA<T> &f, const K &k) {
+  const FunctionBlock<T> *blk = f.Blocks();
+  size_t num_blk = f.NumBlocks();
+  T sum = 0;
+  if (num_blk == 0)
+    return sum;
+#ifdef _OPENMP
+#pragma omp parallel reduction(+:sum) \
+    if (num_blk > 1 && f.Size() >= kParallelMinSize)
+#endif
+  {
+    std::vector<T> work;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (size_t i = 0; i < num_blk; ++i)
+      sum += k.Block(blk[i], &work);
+  }
+  return sum;
+}
+
+// Segment kernels. Each evaluates one segment with the same arithmetic as
+// the corresponding FunctionObj<T> function in prox_lib.h (up to Tol<T>() for
+// the proximal operators in prox_lib_simd.h), applied to the function objects
+// scaled with ScaleFunction. Broadcast parameters are read from their block
+// of copies, so they cost neither memory nor bandwidth proportional to the
+// number of elements.
+template <typename T>
+struct ProxSegment : SegmentKernel<ProxSegment<T>, T> {
+  static const bool kInexact = true;
+  T rho;
+  const T *x_in;
+  T *x_out;
+  ProxAccuracy acc;
+  ProxSegment(const FunctionSoA<T> &f, const T *s, FunctionScale type, T rho,
+              const T *x_in, T *x_out, ProxAccuracy acc)
+      : SegmentKernel<ProxSegment<T>, T>(f, s, type), rho(rho), x_in(x_in),
+        x_out(x_out), acc(acc) { }
+
+  template <typename HF, FunctionScale S>
+  T Loop(const HF &h, size_t begin, size_t end) const {
+    const T *a = this->f.A(begin), *b = this->f.B(begin);
+    const T *c = this->f.C(begin), *d = this->f.D(begin);
+    const T *e = this->f.E(begin);
+    const T *s = S == kScaleNone ? 0 : this->s + begin;
+    const T *x = x_in + begin;
+    T *x_out_seg = x_out + begin;
+#pragma omp simd
+    for (size_t j = 0; j < end - begin; ++j) {
+      T s_j = S == kScaleNone ? static_cast<T>(1) : s[j];
+      T a_j = ScaleParam<S>(a[j], s_j);
+      T d_j = ScaleParam<S>(d[j], s_j);
+      T e_j = ScaleParam<S>(ScaleParam<S>(e[j], s_j), s_j);
+      T v = a_j * (x[j] * rho - d_j) / (e_j + rho) - b[j];
+      T r = (e_j + rho) / (c[j] * a_j * a_j);
+      v = h.Prox(v, r);
+      x_out_seg[j] = (v + b[j]) / a_j;
+    }
+    return static_cast<T>(0.);
+  }
+
+  T Block(const FunctionBlock<T> &blk, std::vector<T> *work) const {
+    ProxBlock(this->f, blk, this->s, this->type, rho, x_in, x_out, work);
+    return static_cast<T>(0.);
+  }
+};
+
+template <typename T>
+struct FuncSegment : SegmentKernel<FuncSegment<T>, T> {
+  const T *x_in;
+  FuncSegment(const FunctionSoA<T> &f, const T *s, FunctionScale type,
+              const T *x_in)
+      : SegmentKernel<FuncSegment<T>, T>(f, s, type), x_in(x_in) { }
+
+  template <typename HF, FunctionScale S>
+  T Loop(const HF &h, size_t begin, size_t end) const {
+    const T *a = this->f.A(begin), *b = this->f.B(begin);
+    const T *c = this->f.C(begin), *d = this->f.D(begin);
+    const T *e = this->f.E(begin);
+    const T *s = S == kScaleNone ? 0 : this->s + begin;
+    const T *x_seg = x_in + begin;
+    T sum = 0;
+#pragma omp simd reduction(+:sum)
+    for (size_t j = 0; j < end - begin; ++j) {
+      T s_j = S == kScaleNone ? static_cast<T>(1) : s[j];
+      T a_j = ScaleParam<S>(a[j], s_j);
+      T d_j = ScaleParam<S>(d[j], s_j);
+      T e_j = ScaleParam<S>(ScaleParam<S>(e[j], s_j), s_j);
+      T x = x_seg[j];
+      T dx = d_j * x;
+      T ex = e_j * x * x / 2;
+      sum += c[j] * h.Func(a_j * x - b[j]) + dx + ex;
+    }
+    return sum;
+  }
+
+  T Block(const FunctionBlock<T> &blk, std::vector<T> *work) const {
+    return FuncBlock(this->f, blk, this->s, this->type, x_in, work);
+  }
+};
+
+template <typename T>
+struct ProjSubgradSegment : SegmentKernel<ProjSubgradSegment<T>, T> {
+  const T *x_in, *v_in;
+  T *v_out;
+  ProjSubgradSegment(const FunctionSoA<T> &f, const T *s, FunctionScale type,
+                     const T *x_in, const T *v_in, T *v_out)
+      : SegmentKernel<ProjSubgradSegment<T>, T>(f, s, type), x_in(x_in),
+        v_in(v_in), v_out(v_out) { }
+
+  template <typename HF, FunctionScale S>
+  T Loop(const HF &h, size_t begin, size_t end) const {
+    const T *a = this->f.A(begin), *b = this->f.B(begin);
+    const T *c = this->f.C(begin), *d = this->f.D(begin);
+    const T *e = this->f.E(begin);
+    const T *s = S == kScaleNone ? 0 : this->s + begin;
+    const T *x_seg = x_in + begin, *v_seg = v_in + begin;
+    T *v_out_seg = v_out + begin;
+    const T kZero = static_cast<T>(0.), kOne = static_cast<T>(1.);
+#pragma omp simd
+    for (size_t j = 0; j < end - begin; ++j) {
+      T s_j = S == kScaleNone ? static_cast<T>(1) : s[j];
+      T a_j = ScaleParam<S>(a[j], s_j);
+      T d_j = ScaleParam<S>(d[j], s_j);
+      T e_j = ScaleParam<S>(ScaleParam<S>(e[j], s_j), s_j);
+      T x = x_seg[j];
+      if (a_j == kZero || c[j] == kZero) {
+        v_out_seg[j] = d_j + e_j * x;
+      } else {
+        T v = kOne / (a_j * c[j]) * (v_seg[j] - d_j - e_j * x);
+        v = h.ProjSubgrad(v, a_j * x - b[j]);
+        v_out_seg[j] = a_j * c[j] * v + d_j + e_j * x;
+      }
+    }
+    return static_cast<T>(0.);
+  }
+
+  T Block(const FunctionBlock<T> &blk, std::vector<T> *work) const {
+    ProjSubgradBlock(this->f, blk, this->s, this->type, x_in, v_in, v_out,
+        work);
+    return static_cast<T>(0.);
+  }
+};
+
+// Fused kernel, which evaluates the proximal operator as ProxSegment and the
+// function at its output as FuncSegment in the same sweep.
+template <typename T>
+struct ProxFuncSegment : SegmentKernel<ProxFuncSegment<T>, T> {
+  static const bool kInexact = true;
+  T rho;
+  const T *x_in;
+  T *x_out;
+  ProxAccuracy acc;
+  ProxFuncSegment(const FunctionSoA<T> &f, const T *s, FunctionScale type,
+                  T rho, const T *x_in, T *x_out, ProxAccuracy acc)
+      : SegmentKernel<ProxFuncSegment<T>, T>(f, s, type), rho(rho),
+        x_in(x_in), x_out(x_out), acc(acc) { }
+
+  template <typename HF, FunctionScale S>
+  T Loop(const HF &h, size_t begin, size_t end) const {
+    const T *a = this->f.A(begin), *b = this->f.B(begin);
+    const T *c = this->f.C(begin), *d = this->f.D(begin);
+    const T *e = this->f.E(begin);
+    const T *s = S == kScaleNone ? 0 : this->s + begin;
+    const T *x = x_in + begin;
+    T *x_out_seg = x_out + begin;
+    T sum = 0;
+#pragma omp simd reduction(+:sum)
+    for (size_t j = 0; j < end - begin; ++j) {
+      T s_j = S == kScaleNone ? static_cast<T>(1) : s[j];
+      T a_j = ScaleParam<S>(a[j], s_j);
+      T d_j = ScaleParam<S>(d[j], s_j);
+      T e_j = ScaleParam<S>(ScaleParam<S>(e[j], s_j), s_j);
+      T x_j = x[j];
+      T v = a_j * (x_j * rho - d_j) / (e_j + rho) - b[j];
+      T r = (e_j + rho) / (c[j] * a_j * a_j);
+      v = h.Prox(v, r);
+      T x12 = (v + b[j]) / a_j;
+      x_out_seg[j] = x12;
+      T dx = d_j * x12;
+      T ex = e_j * x12 * x12 / 2;
+      sum += c[j] * h.Func(a_j * x12 - b[j]) + dx + ex;
+    }
+    return sum;
+  }
+
+  T Block(const FunctionBlock<T> &blk, std::vector<T> *work) const {
+    ProxBlock(this->f, blk, this->s, this->type, rho, x_in, x_out, work);
+    return FuncBlock(this->f, blk, this->s, this->type, x_out, work);
+  }
+};
+
+// Type-erased custom function h, see FunctionSoA::AddCustom. Run dispatches
+// a segment kernel to its loop instantiated for the function object, so that
+// custom functions cost one indirect call per segment, as the switch in
+// DispatchSegment does for the built-in functions.
+template <typename T>
+class CustomFunction {
+ public:
+  virtual ~CustomFunction() { }
+  virtual T Run(const ProxSegment<T> &k, size_t begin, size_t end) const = 0;
+  virtual T Run(const FuncSegment<T> &k, size_t begin, size_t end) const = 0;
+  virtual T Run(const ProjSubgradSegment<T> &k, size_t begin,
+                size_t end) const = 0;
+  virtual T Run(const ProxFuncSegment<T> &k, size_t begin,
+                size_t end) const = 0;
+};
+
+template <typename HF, typename T>
+class CustomFunctionImpl : public CustomFunction<T> {
+ private:
+  HF _h;
+
+ public:
+  explicit CustomFunctionImpl(const HF &h) : _h(h) { }
+  T Run(const ProxSegment<T> &k, size_t begin, size_t end) const {
+    return k.Run(_h, begin, end);
+  }
+  T Run(const FuncSegment<T> &k, size_t begin, size_t end) const {
+    return k.Run(_h, begin, end);
+  }
+  T Run(const ProjSubgradSegment<T> &k, size_t begin, size_t end) const {
+    return k.Run(_h, begin, end);
+  }
+  T Run(const ProxFuncSegment<T> &k, size_t begin, size_t end) const {
+    return k.Run(_h, begin, end);
+  }
+};
+
+// Evaluates the kernel k over the segments and custom runs of f, in parallel
+// over the segments, and returns the sum of k.Run. The segments are split
+// statically (see parallel.h), so that each thread evaluates the same
+// contiguous range of segments in every call.
+template <typename K, typename T>
+T EvalSegments(const FunctionSoA<T> &f, const K &k) {
+  const FunctionSegment *seg = f.Segments();
+  const FunctionCustom<T> *custom = f.Custom();
+  size_t num_seg = f.NumSegments();
+  size_t num_all = num_seg + f.NumCustom();
+  T sum = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(+:sum) \
+    if (f.Size() >= kParallelMinSize)
+#endif
+  for (size_t i = 0; i < num_all; ++i) {
+    if (i < num_seg) {
+      sum += DispatchSegment(k, seg[i].h, seg[i].begin, seg[i].end);
+    } else {
+      const FunctionCustom<T> &c = custom[i - num_seg];
+      sum += c.h->Run(k, c.begin, c.end);
+    }
+  }
+  return sum;
+}
+
+// Evaluates the proximal operator Prox{f[i]}(x_in[i]) -> x_out[i], as
+// ProxEval(const std::vector<FunctionObj<T> >&, ...), with the arguments of
+// f scaled by s according to type. The iterative proximal operators are
+// evaluated to accuracy acc (custom functions and blocks always exactly).
+template <typename T>
+void ProxEval(const FunctionSoA<T> &f, const T *s, FunctionScale type, T rho,
+              const T *x_in, T *x_out, ProxAccuracy acc = kProxExact) {
+  ProxSegment<T> k(f, s, type, rho, x_in, x_out, acc);
+  EvalSegments(f, k);
+  EvalBlocks(f, k);
+}
+
+template <typename T>
+void ProxEval(const FunctionSoA<T> &f, T rho, const T *x_in, T *x_out) {
+  ProxEval(f, static_cast<const T*>(0), kScaleNone, rho, x_in, x_out);
+}
+
+// Evaluates the proximal operator Prox{f[i]}(x_in[i]) -> x_out[i] and returns
+// Sum_i Func{f[i]}(x_out[i]) in a single pass, with the same results as
+// ProxEval followed by FuncEval. The accuracy acc is as in ProxEval.
+template <typename T>
+T ProxFuncEval(const FunctionSoA<T> &f, const T *s, FunctionScale type, T rho,
+               const T *x_in, T *x_out, ProxAccuracy acc = kProxExact) {
+  ProxFuncSegment<T> k(f, s, type, rho, x_in, x_out, acc);
+  return EvalSegments(f, k) + EvalBlocks(f, k);
+}
+
+template <typename T>
+T ProxFuncEval(const FunctionSoA<T> &f, T rho, const T *x_in, T *x_out) {
+  return ProxFuncEval(f, static_cast<const T*>(0), kScaleNone, rho, x_in,
+      x_out);
+}
+
+// Returns the number of inner steps that ProxEval (or ProxFuncEval) of f
+// takes at accuracy acc, over the elements with an iterative proximal
+// operator (kLogistic, kNegEntr and kExp).
+template <typename T>
+size_t ProxInnerIter(const FunctionSoA<T> &f, ProxAccuracy acc) {
+  size_t iter = 0;
+  for (size_t k = 0; k < f.NumSegments(); ++k) {
+    const FunctionSegment &seg = f.Segments()[k];
+    if (seg.h == kLogistic)
+      iter += (seg.end - seg.begin) * LogisticSteps<T>(acc);
+    else if (seg.h == kNegEntr || seg.h == kExp)
+      iter += (seg.end - seg.begin) * LambertWSteps<T>(acc);
+  }
+  return iter;
+}
+
+// Returns Sum_i Func{f[i]}(x_in[i]), as
+// FuncEval(const std::vector<FunctionObj<T> >&, ...), with the arguments of
+// f scaled by s according to type.
+template <typename T>
+T FuncEval(const FunctionSoA<T> &f, const T *s, FunctionScale type,
+           const T *x_in) {
+  FuncSegment<T> k(f, s, type, x_in);
+  return EvalSegments(f, k) + EvalBlocks(f, k);
+}
+
+template <typename T>
+T FuncEval(const FunctionSoA<T> &f, const T *x_in) {
+  return FuncEval(f, static_cast<const T*>(0), kScaleNone, x_in);
+}
+
+// Projection onto the subgradient at x_in
+//   ProjSubgrad{f[i]}(x_in[i], v_in[i]) -> v_out[i],
+// as ProjSubgradEval(const std::vector<FunctionObj<T> >&, ...), with the
+// arguments of f scaled by s according to type.
+template <typename T>
+void ProjSubgradEval(const FunctionSoA<T> &f, const T *s, FunctionScale type,
+                     const T *x_in, const T *v_in, T *v_out) {
+  ProjSubgradSegment<T> k(f, s, type, x_in, v_in, v_out);
+  EvalSegments(f, k);
+  EvalBlocks(f, k);
+}
+
+template <typename T>
+void ProjSubgradEval(const FunctionSoA<T> &f, const T *x_in, const T *v_in,
+                     T *v_out) {
+  ProjSubgradEval(f, static_cast<const T*>(0), kScaleNone, x_in, v_in, v_out);
+}
+
+// Returns +inf if |v_in[i]| > tol for an element i of a custom run, so that
+// no certificate is accepted that depends on a custom function.
+template <typename T>
+T CustomSupport(const FunctionSoA<T> &f, const T *v_in, T tol) {
+  for (size_t k = 0; k < f.NumCustom(); ++k) {
+    for (size_t i = f.Custom()[k].begin; i < f.Custom()[k].end; ++i) {
+      if (std::abs(v_in[i]) > tol)
+        return std::numeric_limits<T>::infinity();
+    }
+  }
+  return static_cast<T>(0.);
+}
+
+// Returns Sum_i DomainSupport{f[i]}(v_in[i]), with the arguments of f scaled
+// by s according to type.
+template <typename T>
+T DomainSupport(const FunctionSoA<T> &f, const T *s, FunctionScale type,
+                const T *v_in, T tol) {
+  const FunctionSegment *seg = f.Segments();
+  size_t num_seg = f.NumSegments();
+  T sum = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(+:sum) \
+    if (f.Size() >= kParallelMinSize)
+#endif
+  for (size_t k = 0; k < num_seg; ++k) {
+    for (size_t i = seg[k].begin; i < seg[k].end; ++i)
+      sum += DomainSupport(ScaledElement(f, s, type, i), v_in[i], tol);
+  }
+  std::vector<T> work;
+  for (size_t k = 0; k < f.NumBlocks(); ++k)
+    sum += DomainSupportBlock(f, f.Blocks()[k], s, type, v_in, tol, &work);
+  return sum + CustomSupport(f, v_in, tol);
+}
+
+// Returns Sum_i RecessionEval{f[i]}(v_in[i]), with the arguments of f scaled
+// by s according to type.
+template <typename T>
+T RecessionEval(const FunctionSoA<T> &f, const T *s, FunctionScale type,
+                const T *v_in, T tol) {
+  const FunctionSegment *seg = f.Segments();
+  size_t num_seg = f.NumSegments();
+  T sum = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(+:sum) \
+    if (f.Size() >= kParallelMinSize)
+#endif
+  for (size_t k = 0; k < num_seg; ++k) {
+    for (size_t i = seg[k].begin; i < seg[k].end; ++i)
+      sum += RecessionEval(ScaledElement(f, s, type, i), v_in[i], tol);
+  }
+  std::vector<T> work;
+  for (size_t k = 0; k < f.NumBlocks(); ++k)
+    sum += RecessionBlock(f, f.Blocks()[k], s, type, v_in, tol, &work);
+  return sum + CustomSupport(f, v_in, tol);
+}
+
+#endif  // FUNCTION_SOA_H_
+
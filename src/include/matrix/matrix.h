@@ -14,8 +14,16 @@ class Matrix {
 
   bool _done_init;
 
+  // Number of matrix-vector products computed so far.
+  mutable size_t _num_mul;
+
+  // Bytes of host memory allocated so far.
+  size_t _bytes_alloc;
+
  public:
-  Matrix(size_t m, size_t n) : _m(m), _n(n), _info(0), _done_init(false) { };
+  Matrix(size_t m, size_t n)
+      : _m(m), _n(n), _info(0), _done_init(false), _num_mul(0),
+        _bytes_alloc(0) { };
 
   virtual ~Matrix() { };
 
@@ -28,10 +36,34 @@ class Matrix {
   // Method to multiply by A and A^T.
   virtual int Mul(char trans, T alpha, const T *x, T beta, T *y) const = 0;
 
+  // Multiplies K vectors at once, where the j-th vector of x (resp. y) starts
+  // at x + j * ldx (resp. y + j * ldy). Defaults to K calls to Mul.
+  virtual int MulBatch(char trans, T alpha, size_t K, const T *x, size_t ldx,
+                       T beta, T *y, size_t ldy) const {
+    for (size_t j = 0; j < K; ++j) {
+      int err = Mul(trans, alpha, x + j * ldx, beta, y + j * ldy);
+      if (err)
+        return err;
+    }
+    return 0;
+  }
+
+  // Computes y := A * x and z := alpha * A^T * y + beta * z, ie. the product
+  // by A^T * A of CGLS and of norm estimation. Matrices that can compute both
+  // products in one pass over A override this. Defaults to two calls to Mul.
+  virtual int MulAtA(T alpha, const T *x, T *y, T beta, T *z) const {
+    int err = Mul('n', static_cast<T>(1), x, static_cast<T>(0), y);
+    return err ? err : Mul('t', alpha, y, beta, z);
+  }
+
   // Get dimensions and check if initialized
   size_t Rows() const { return _m; }
   size_t Cols() const { return _n; }
   bool IsInit() const { return _done_init; }
+
+  // Number of products by A or A^T so far (MulBatch counts K products).
+  size_t NumMul() const { return _num_mul; }
+  size_t BytesAlloc() const { return _bytes_alloc; }
 };
 
 }  // namespace pogs
@@ -5,23 +5,53 @@
 
 namespace pogs {
 
+template <typename T>
+class MatrixFile;
+
 template <typename T>
 class MatrixDense : public Matrix<T> {
  public:
   enum Ord {ROW, COL};
 
+  // Storage of A. With COPY, Init copies the caller's data to a buffer owned
+  // by the matrix, which Equil then scales. With IN_PLACE, the matrix adopts
+  // the caller's buffer (a device pointer in the GPU version) and Equil scales
+  // it in place, which saves the copy and m * n elements of memory. The
+  // buffer then holds D * A * E / ||D * A * E|| after Init and Equil, and it
+  // must outlive the matrix. The buffer is never shared: a copy made before
+  // Init (eg. the one kept by a solver) takes it over, and the original is
+  // left without data, so that Init fails on it. Later copies use COPY.
+  enum Storage {COPY, IN_PLACE};
+
+  // Precision of the copy of A that Mul reads (CPU only). With BF16, FP16 or
+  // INT8 (with a scale per row), Equil stores the equilibrated A in that
+  // format, and rounds A itself to the same values, so that Mul (which
+  // accumulates in T) and Data() agree, eg. in ProjectorDirect, which factors
+  // the rounded A. A solver with ProjectorCgls frees the full precision copy
+  // after Equil (see FreeData).
+  enum Precision {FULL, BF16, FP16, INT8};
+
  private:
   // TODO: This should be shared cpu/gpu pointer?
   T *_data;
 
   Ord _ord;
 
+  Storage _storage;
+
+  Precision _precision;
+
   // Get rid of assignment operator.
   MatrixDense<T>& operator=(const MatrixDense<T>& A);
 
  public:
   // Constructor (only sets variables)
   MatrixDense(char ord, size_t m, size_t n, const T *data);
+  MatrixDense(char ord, size_t m, size_t n, T *data, Storage storage);
+  // Constructs A from a dense matrix file (see matrix_file.h). If the file
+  // holds the equilibrated matrix, A is read from the map without a copy and
+  // Equil returns the stored d and e.
+  explicit MatrixDense(const MatrixFile<T>& F);
   MatrixDense(const MatrixDense<T>& A);
   ~MatrixDense();
 
@@ -33,10 +63,24 @@ class MatrixDense : public Matrix<T> {
 
   // Method to multiply by A and A^T.
   int Mul(char trans, T alpha, const T *x, T beta, T *y) const;
+  int MulBatch(char trans, T alpha, size_t K, const T *x, size_t ldx, T beta,
+               T *y, size_t ldy) const;
+  int MulAtA(T alpha, const T *x, T *y, T beta, T *z) const;
+
+  // Set the precision of Mul, before Equil.
+  void SetPrecision(Precision precision) { _precision = precision; }
+
+  // Frees the full precision copy of A once Equil has stored A at reduced
+  // precision, for users that only call Mul (eg. ProjectorCgls). Data() is 0
+  // afterwards (CPU only). Does nothing at FULL precision or with IN_PLACE
+  // storage.
+  void FreeData();
 
   // Getters
   const T* Data() const { return _data; }
   Ord Order() const { return _ord; }
+  Storage GetStorage() const { return _storage; }
+  Precision GetPrecision() const { return _precision; }
 };
 
 }  // namespace pogs
@@ -0,0 +1,84 @@
+#ifndef MATRIX_MATRIX_DENSE_STREAM_H_
+#define MATRIX_MATRIX_DENSE_STREAM_H_
+
+#include <string>
+
+#include "matrix.h"
+#include "matrix_file.h"
+
+namespace pogs {
+
+// Default size of a panel of MatrixDenseStream.
+const size_t kStreamPanelBytes = static_cast<size_t>(1) << 25;
+
+// Dense matrix that stays on disk, in a row major dense matrix file (see
+// matrix_file.h), for matrices that do not fit in memory. Mul reads A in
+// panels of rows into two buffers, reading the next panel asynchronously
+// while it multiplies by the current one, so that the I/O overlaps with the
+// computation. MulAtA reads A once for both of its products. A matrix of at
+// most two panels is read once, in Init, and then stays in memory.
+//
+// Equil does not modify the file. It computes d and e by Sinkhorn-Knopp on
+// A.^2, which Mul forms panel by panel, and Mul then applies D and E to the
+// vectors rather than to A. If the file holds the equilibrated matrix, Equil
+// returns the stored d and e instead. Use with ProjectorCgls (PogsIndirect).
+template <typename T>
+class MatrixDenseStream : public Matrix<T> {
+ private:
+  std::string _path;
+  MatrixFileHeader _hdr;
+  size_t _panel_rows;
+
+  int _fd;
+
+  // Panel buffers, equilibration vectors (0 until Equil) and workspace of
+  // size m + 2 * n.
+  T *_buf[2];
+  T *_d, *_e;
+  T *_work;
+
+  // Multiply by A.^2 rather than A (in Equil).
+  bool _squared;
+
+  // Reads panel p into buf. On failure, prints an error and sets *err to 1.
+  void ReadPanel(size_t p, T *buf, int *err) const;
+
+  // Computes y := P * x (trans = 'n') or y := y + P^T * x (trans = 't') for
+  // the panel P of the given rows, or the same for P.^2.
+  void MulPanel(char trans, const T *panel, size_t rows, const T *x,
+                T *y) const;
+
+  MatrixDenseStream(const MatrixFileHeader& hdr, const char *path,
+                    size_t panel_rows);
+
+  // Get rid of assignment operator.
+  MatrixDenseStream<T>& operator=(const MatrixDenseStream<T>& A);
+
+ public:
+  // Constructor (only sets variables). The file at path must hold a row
+  // major dense matrix, otherwise an error is printed and Init fails. If
+  // panel_rows is 0, panels are of about kStreamPanelBytes bytes.
+  explicit MatrixDenseStream(const char *path, size_t panel_rows = 0);
+  MatrixDenseStream(const MatrixDenseStream<T>& A);
+  ~MatrixDenseStream();
+
+  // Initialize matrix, call this before any other methods.
+  int Init();
+
+  // Method to equilibrate.
+  int Equil(T *d, T *e);
+
+  // Method to multiply by A and A^T.
+  int Mul(char trans, T alpha, const T *x, T beta, T *y) const;
+  int MulAtA(T alpha, const T *x, T *y, T beta, T *z) const;
+
+  // Getters
+  size_t PanelRows() const { return _panel_rows; }
+  size_t NumPanels() const {
+    return _panel_rows > 0 ? (this->_m + _panel_rows - 1) / _panel_rows : 0;
+  }
+};
+
+}  // namespace pogs
+
+#endif  // MATRIX_MATRIX_DENSE_STREAM_H_
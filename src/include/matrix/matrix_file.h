@@ -0,0 +1,107 @@
+#ifndef MATRIX_MATRIX_FILE_H_
+#define MATRIX_MATRIX_FILE_H_
+
+#include <stdint.h>
+
+#include <cstddef>
+
+#include "matrix_dense.h"
+#include "matrix_sparse.h"
+
+namespace pogs {
+
+// Binary matrix file, which MatrixDense and MatrixSparse construct from
+// directly, without parsing or (once equilibrated) copying the matrix.
+//
+// The file consists of a MatrixFileHeader, followed by the arrays of the
+// matrix, each at an offset that is a multiple of kMatrixFileAlign bytes:
+//  - dense:  data (m * n values in the order ord),
+//  - sparse: data and ind (2 * nnz each) and ptr (m + n + 2), ie. the
+//            matrix in both CSR and CSC form, as MatrixSparse stores it after
+//            Init (the form ord first), and
+//  - if equil is set, the equilibration vectors d (m values) and e (n
+//    values). The matrix is then D * A * E as returned by Equil, which the
+//    matrices read as is and do not equilibrate again.
+// Values are stored as T and indices as POGS_INT, in host byte order.
+
+const char kMatrixFileMagic[8] = { 'P', 'O', 'G', 'S', 'M', 'A', 'T', '\0' };
+const uint32_t kMatrixFileVersion = 1u;
+const uint64_t kMatrixFileAlign = 4096u;
+
+struct MatrixFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t sparse;
+  uint32_t ord;
+  uint32_t equil;
+  uint32_t real_size;
+  uint32_t int_size;
+  uint64_t m, n, nnz;
+  // Byte offsets of the arrays from the start of the file (0 if absent).
+  uint64_t data_offset, ind_offset, ptr_offset, d_offset, e_offset;
+  uint64_t file_size;
+};
+
+// Read-only memory map of a matrix file. The map must outlive the matrices
+// constructed from it.
+template <typename T>
+class MatrixFile {
+ private:
+  void *_map;
+  size_t _size;
+  MatrixFileHeader _hdr;
+  bool _valid;
+
+  template <typename S>
+  const S *Array(uint64_t offset) const {
+    return offset ? reinterpret_cast<const S*>(
+        reinterpret_cast<const char*>(_map) + offset) : 0;
+  }
+
+  // Get rid of copy constructor and assignment operator.
+  MatrixFile(const MatrixFile<T>& F);
+  MatrixFile<T>& operator=(const MatrixFile<T>& F);
+
+ public:
+  // Maps the file at path, checks its header (and the indices of a sparse
+  // matrix) and advises the kernel to read the whole file ahead. If the file
+  // cannot be mapped, its header does not describe arrays within the file or
+  // its indices are out of range, an error is printed and IsValid() is
+  // false. The file then holds an empty 0 x 0 matrix, so check IsValid()
+  // before constructing a matrix from it.
+  explicit MatrixFile(const char *path);
+  ~MatrixFile();
+
+  // Getters
+  bool IsValid() const { return _valid; }
+  bool IsSparse() const { return _hdr.sparse != 0; }
+  bool IsEquil() const { return _hdr.equil != 0; }
+  char Order() const { return static_cast<char>(_hdr.ord); }
+  size_t Rows() const { return static_cast<size_t>(_hdr.m); }
+  size_t Cols() const { return static_cast<size_t>(_hdr.n); }
+  POGS_INT Nnz() const { return static_cast<POGS_INT>(_hdr.nnz); }
+  const T* Data() const { return Array<T>(_hdr.data_offset); }
+  const POGS_INT* Ind() const { return Array<POGS_INT>(_hdr.ind_offset); }
+  const POGS_INT* Ptr() const { return Array<POGS_INT>(_hdr.ptr_offset); }
+  const T* D() const { return Array<T>(_hdr.d_offset); }
+  const T* E() const { return Array<T>(_hdr.e_offset); }
+};
+
+// Reads the header of the matrix file at path into hdr and checks it as
+// MatrixFile does. Returns 0 on success, otherwise prints an error and
+// returns 1.
+int ReadMatrixFileHeader(const char *path, MatrixFileHeader *hdr);
+
+// Write A, which must be initialized, to a matrix file at path. If d and e
+// are non-null, A must have been equilibrated by Equil(d, e).
+template <typename T>
+int WriteMatrixFile(const char *path, const MatrixDense<T>& A,
+                    const T *d = 0, const T *e = 0);
+
+template <typename T>
+int WriteMatrixFile(const char *path, const MatrixSparse<T>& A,
+                    const T *d = 0, const T *e = 0);
+
+}  // namespace pogs
+
+#endif  // MATRIX_MATRIX_FILE_H_
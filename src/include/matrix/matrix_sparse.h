@@ -7,6 +7,9 @@ namespace pogs {
 
 typedef int POGS_INT;
 
+template <typename T>
+class MatrixFile;
+
 template <typename T>
 class MatrixSparse : public Matrix<T> {
  public:
@@ -25,6 +28,11 @@ class MatrixSparse : public Matrix<T> {
  public:
   MatrixSparse(char ord, POGS_INT m, POGS_INT n, POGS_INT nnz, const T *data,
       const POGS_INT *ptr, const POGS_INT *ind);
+  // Constructs A from a sparse matrix file (see matrix_file.h), which holds
+  // the CSR and CSC form, so that Init copies without a transpose. If the
+  // file holds the equilibrated matrix, A is read from the map without a copy
+  // and Equil returns the stored d and e.
+  explicit MatrixSparse(const MatrixFile<T>& F);
   MatrixSparse(const MatrixSparse<T>& A);
   ~MatrixSparse();
 
@@ -36,6 +44,7 @@ class MatrixSparse : public Matrix<T> {
 
   // Method to multiply by A and A^T.
   int Mul(char trans, T alpha, const T *x, T beta, T *y) const;
+  int MulAtA(T alpha, const T *x, T *y, T beta, T *z) const;
 
   // Getters
   const T* Data() const { return _data; }
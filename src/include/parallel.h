@@ -0,0 +1,108 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <stdlib.h>
+
+#include <cstddef>
+#include <cstring>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Partitioning of the parallel loops over the vectors of the solver (the
+// proximal operators, the fused ADMM kernels and the matrix data). Loops over
+// i = 0, ..., size - 1 take 64-bit indices and the clauses
+//
+//   schedule(static, ParallelChunk<T>(size)) if (size >= kParallelMinSize)
+//
+// so that
+//  - loops shorter than kParallelMinSize run serially, without the cost of
+//    starting a parallel region,
+//  - each thread gets one contiguous range of whole cache lines. Vectors
+//    allocated by ParallelAlloc (and stored at offsets that are multiples of
+//    ParallelPad) start on a line, so no two threads write to the same line,
+//    and
+//  - thread t gets the same range [t * chunk, (t + 1) * chunk) in every loop
+//    of the same length. With first-touch page placement, vectors initialized
+//    by ParallelZero are thus local to the threads that process them. Loops
+//    over the x and y parts of a vector z = (x, y) of length m + n split the
+//    partition of z at n (see pogs_helper.h), rather than partitioning x and
+//    y separately.
+//
+// The BLAS library splits the products by A its own way, so ParallelCopy of
+// A only spreads its pages over the threads' memory.
+
+// Minimum number of elements of a parallel loop.
+const size_t kParallelMinSize = 16384u;
+
+// Bytes per cache line.
+const size_t kCacheLine = 64u;
+
+// Number of threads of the parallel loops.
+inline size_t ParallelThreads() {
+#ifdef _OPENMP
+  return static_cast<size_t>(omp_get_max_threads());
+#else
+  return 1u;
+#endif
+}
+
+// Number of elements of type T in size elements rounded up to whole cache
+// lines, ie. the stride at which vectors of length size start on a line.
+template <typename T>
+inline size_t ParallelPad(size_t size) {
+  const size_t kLine = kCacheLine / sizeof(T) > 0 ? kCacheLine / sizeof(T) : 1;
+  return (size + kLine - 1) / kLine * kLine;
+}
+
+// Elements of type T per thread in a loop of length size, rounded up to whole
+// cache lines.
+template <typename T>
+inline size_t ParallelChunk(size_t size) {
+  size_t threads = ParallelThreads();
+  size_t chunk = ParallelPad<T>((size + threads - 1) / threads);
+  return chunk > 0 ? chunk : ParallelPad<T>(1);
+}
+
+// Allocates size elements of type T at the start of a cache line, or returns
+// 0 on failure. The array must be freed with ParallelFree.
+template <typename T>
+T *ParallelAlloc(size_t size) {
+  void *x = 0;
+  if (posix_memalign(&x, kCacheLine, size > 0 ? size * sizeof(T) : 1) != 0)
+    return 0;
+  return static_cast<T*>(x);
+}
+
+inline void ParallelFree(void *x) {
+  free(x);
+}
+
+// Sets x := 0 with the partition of the parallel loops over size elements.
+template <typename T>
+void ParallelZero(size_t size, T *x) {
+  size_t chunk = ParallelChunk<T>(size);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) if (size >= kParallelMinSize)
+#endif
+  for (size_t begin = 0; begin < size; begin += chunk) {
+    size_t end = begin + chunk < size ? begin + chunk : size;
+    memset(x + begin, 0, (end - begin) * sizeof(T));
+  }
+}
+
+// Sets y := x with the partition of the parallel loops over size elements.
+template <typename T>
+void ParallelCopy(size_t size, const T *x, T *y) {
+  size_t chunk = ParallelChunk<T>(size);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) if (size >= kParallelMinSize)
+#endif
+  for (size_t begin = 0; begin < size; begin += chunk) {
+    size_t end = begin + chunk < size ? begin + chunk : size;
+    memcpy(y + begin, x + begin, (end - begin) * sizeof(T));
+  }
+}
+
+#endif  // PARALLEL_H_
@@ -5,9 +5,11 @@
 #include <string>
 #include <vector>
 
+#include "function_soa.h"
 #include "projector/projector_direct.h"
 #include "projector/projector_cgls.h"
 #include "prox_lib.h"
+#include "rho_policy.h"
 
 
 namespace pogs {
@@ -23,6 +25,10 @@ const unsigned int kMaxIter     = 2500u;
 const unsigned int kInitIter    = 10u;
 const bool         kAdaptiveRho = true;
 const bool         kGapStop     = false;
+const unsigned int kAndersonMem = 0u;   // 0 = no acceleration
+const double       kInfTol      = 0.;   // 0 = no infeasibility detection
+const unsigned int kStopCheckIter = 10u;
+const bool         kInexactProx = false;
 
 // Status messages
 enum PogsStatus { POGS_SUCCESS,    // Converged succesfully.
@@ -30,7 +36,66 @@ enum PogsStatus { POGS_SUCCESS,    // Converged succesfully.
                   POGS_UNBOUNDED,  // Problem likely unbounded
                   POGS_MAX_ITER,   // Reached max iter.
                   POGS_NAN_FOUND,  // Encountered nan.
-                  POGS_ERROR };    // Generic error, check logs.
+                  POGS_ERROR,      // Generic error, check logs.
+                  POGS_INTERRUPTED }; // Stopped by the iteration callback.
+
+// When to check the stopping criteria with the exact residuals, which costs
+// two extra multiplications by A per check. In all modes but
+// STOP_CHECK_ALWAYS, the exact residuals are also computed as soon as the
+// cheap residuals (|z12 - z| and rho |z - zprev|) pass the tolerances.
+enum StopCheckType { STOP_CHECK_ALWAYS,    // Every iteration.
+                     STOP_CHECK_PERIODIC,  // Every stop_check_iter iterations.
+                     STOP_CHECK_CHEAP,     // Only when the cheap ones pass.
+                     STOP_CHECK_ADAPTIVE }; // Interval doubles (up to
+                                            // stop_check_iter) while far from
+                                            // converged.
+
+// Anderson acceleration variants.
+enum AndersonType { ANDERSON_TYPE_I,   // Secant condition on dU^T.
+                    ANDERSON_TYPE_II }; // Least squares on the residuals.
+
+// Progress of one iteration, passed to the iteration callback and recorded
+// by PogsTrace. The residuals and tolerances are those of the stopping
+// criteria (in the equilibrated space).
+template <typename T>
+struct PogsIterate {
+  unsigned int k;    // Iteration.
+  unsigned int idx;  // Objective (in SolveBatch, otherwise 0).
+  T nrm_r, eps_pri;  // Primal residual and tolerance.
+  T nrm_s, eps_dua;  // Dual residual and tolerance.
+  T gap, eps_gap;    // Duality gap and tolerance.
+  T rho;
+  T optval;          // f(y) + g(x), or NaN if not requested.
+};
+
+template <typename T>
+class PogsTrace;
+
+// Wall time (in seconds) and number of calls of one phase of the solver.
+struct PogsPhaseStats {
+  double time;
+  size_t calls;
+};
+
+// Statistics of the last call to Solve (or SolveBatch), collected if
+// SetCollectStats(true). The setup phases (init, equil and factor) are only
+// nonzero for the call that initialized the solver.
+struct PogsStats {
+  PogsPhaseStats total;     // Whole call.
+  PogsPhaseStats init;      // Matrix setup (A.Init).
+  PogsPhaseStats equil;     // Equilibration.
+  PogsPhaseStats factor;    // Projector setup (P.Init), eg. A^T A.
+  PogsPhaseStats prox;      // Proximal operator evaluations.
+  PogsPhaseStats project;   // Projections onto y = Ax.
+  PogsPhaseStats residual;  // Products by A for the exact residuals.
+  PogsPhaseStats rho;       // Rho updates.
+  size_t num_mul;           // Products by A or A^T.
+  size_t proj_iter;         // Inner iterations of the projector (CGLS).
+  size_t prox_iter;         // Inner iterations of the iterative proximal
+                            // operators (kLogistic, kNegEntr and kExp).
+  size_t prox_iter_exact;   // The same, had they all been exact.
+  size_t bytes_alloc;       // Bytes of host memory allocated.
+};
 
 
 // Proximal Operator Graph Solver.
@@ -43,17 +108,64 @@ class Pogs {
   T *_de, *_z, *_zt, _rho;
   bool _done_init;
 
+  // Workspace arena, sized in _Init and shared by the solver loop and the
+  // projector, so that repeated calls to Solve do not allocate.
+  T *_work;
+  size_t _work_size;
+  FunctionSoA<T> _f, _g;
+  unsigned int _num_alloc;
+  size_t _bytes_alloc;
+
+  // Anderson acceleration workspace, allocated on demand in Solve.
+  T *_aa_work;
+  size_t _aa_work_size;
+
   // Setup matrix _A and solver _LS
   int _Init();
 
+  // Bytes of host memory allocated so far by the solver, _A and _P.
+  size_t _BytesAlloc() const {
+    return _bytes_alloc + _A.BytesAlloc() + _P.BytesAlloc();
+  }
+
   // Output.
   T *_x, *_y, *_mu, *_lambda, _optval;
   unsigned int _final_iter;
 
+  // Multiplications by A in the last solve, in total and for the exact
+  // residuals.
+  size_t _num_mul, _num_mul_res;
+
+  // Certificate of infeasibility (mu, lambda) or unboundedness (x, y).
+  T *_cert;
+
+  // Statistics of the last solve.
+  PogsStats _stats;
+
+ public:
+  // Iteration callback, return false to stop the solve.
+  typedef bool (*Callback)(const PogsIterate<T> &it, void *data);
+
+ private:
+  Callback _callback;
+  void *_callback_data;
+  bool _callback_optval;
+  PogsTrace<T> *_trace;
+
+  // Output of SolveBatch, the k-th solution is stored at offset k * n (x, mu)
+  // or k * m (y, lambda).
+  std::vector<T> _x_batch, _y_batch, _mu_batch, _lambda_batch, _optval_batch;
+  std::vector<unsigned int> _final_iter_batch;
+
   // Parameters.
-  T _abs_tol, _rel_tol;
-  unsigned int _max_iter, _init_iter, _verbose;
-  bool _adaptive_rho, _gap_stop, _init_x, _init_lambda;
+  T _abs_tol, _rel_tol, _inf_tol;
+  unsigned int _max_iter, _init_iter, _verbose, _stop_check_iter;
+  StopCheckType _stop_check;
+  unsigned int _anderson_mem;
+  AndersonType _anderson_type;
+  RhoPolicy<T> *_rho_policy;
+  bool _adaptive_rho, _gap_stop, _collect_stats, _inexact_prox, _init_x,
+      _init_lambda;
 
  public:
   // Constructor and Destructor.
@@ -64,32 +176,131 @@ class Pogs {
   PogsStatus Solve(const std::vector<FunctionObj<T> >& f,
                    const std::vector<FunctionObj<T> >& g);
 
+  // Solve for an objective given in structure-of-arrays form, where
+  // parameters that are shared by all elements are stored (and evaluated) as
+  // scalars. f and g are used in place and must outlive the call. The GPU
+  // solver returns POGS_ERROR if f or g has block or custom functions.
+  PogsStatus Solve(const FunctionSoA<T>& f, const FunctionSoA<T>& g);
+
+  // Solve for K objectives (f[k], g[k]) at once. The K ADMM instances are
+  // advanced in lockstep, each starting from the solver's current state (as
+  // Solve would), and sharing the projections and multiplications by A so
+  // that A is streamed through once per iteration for all instances. The
+  // solver state itself is left unchanged and SetInitX/SetInitLambda are
+  // ignored. Solutions are retrieved with GetBatchX(k), etc. Every status is
+  // POGS_ERROR unless anderson_mem = 0, inf_tol = 0 and stop_check =
+  // STOP_CHECK_ALWAYS. The GPU version solves the objectives one after
+  // another (each from the current state), without sharing the products.
+  std::vector<PogsStatus> SolveBatch(
+      const std::vector<std::vector<FunctionObj<T> > >& f,
+      const std::vector<std::vector<FunctionObj<T> > >& g);
+  std::vector<PogsStatus> SolveBatch(const std::vector<FunctionSoA<T> >& f,
+                                     const std::vector<FunctionSoA<T> >& g);
+
   // Getters for solution variables and parameters.
   const T*     GetX()           const { return _x; }
   const T*     GetY()           const { return _y; }
   const T*     GetLambda()      const { return _lambda; }
   const T*     GetMu()          const { return _mu; }
+  // If Solve returns POGS_INFEASIBLE, a ray (mu, lambda) with mu = -A^T lambda
+  // along which the dual objective increases without bound. If it returns
+  // POGS_UNBOUNDED, a ray (x, y) with y = Ax along which the primal objective
+  // decreases without bound. Of length n + m (null in the GPU version).
+  const T*     GetCertificate() const { return _cert; }
   T            GetOptval()      const { return _optval; }
   unsigned int GetFinalIter()   const { return _final_iter; }
+  size_t       GetNumMul()      const { return _num_mul; }
+  size_t       GetNumMulResidual() const { return _num_mul_res; }
   T            GetRho()         const { return _rho; }
   T            GetRelTol()      const { return _rel_tol; }
   T            GetAbsTol()      const { return _abs_tol; }
+  T            GetInfTol()      const { return _inf_tol; }
   unsigned int GetMaxIter()     const { return _max_iter; }
   unsigned int GetInitIter()    const { return _init_iter; }
   unsigned int GetVerbose()     const { return _verbose; }
+  StopCheckType GetStopCheck()  const { return _stop_check; }
+  unsigned int GetStopCheckIter() const { return _stop_check_iter; }
   bool         GetAdaptiveRho() const { return _adaptive_rho; }
   bool         GetGapStop()     const { return _gap_stop; }
+  unsigned int GetAndersonMem() const { return _anderson_mem; }
+  AndersonType GetAndersonType() const { return _anderson_type; }
+  // Heap allocations made so far by the solver (not counting those of the
+  // matrix and the projector), including the conversion of f and g and the
+  // state of the rho policy.
+  unsigned int GetNumAlloc() const {
+    return _num_alloc + _f.NumAlloc() + _g.NumAlloc() +
+        _rho_policy->NumAlloc();
+  }
+  const PogsStats& GetStats()   const { return _stats; }
+  bool         GetCollectStats() const { return _collect_stats; }
+  bool         GetInexactProx() const { return _inexact_prox; }
+  const RhoPolicy<T>& GetRhoPolicy() const { return *_rho_policy; }
+
+  // Getters for the k-th solution of the last call to SolveBatch.
+  const T* GetBatchX(size_t k)      const { return &_x_batch[k * _A.Cols()]; }
+  const T* GetBatchY(size_t k)      const { return &_y_batch[k * _A.Rows()]; }
+  const T* GetBatchLambda(size_t k) const {
+    return &_lambda_batch[k * _A.Rows()];
+  }
+  const T* GetBatchMu(size_t k)     const { return &_mu_batch[k * _A.Cols()]; }
+  T GetBatchOptval(size_t k)        const { return _optval_batch[k]; }
+  unsigned int GetBatchFinalIter(size_t k) const {
+    return _final_iter_batch[k];
+  }
 
 
   // Setters for parameters and initial values.
   void SetRho(T rho)                       { _rho = rho; }
   void SetAbsTol(T abs_tol)                { _abs_tol = abs_tol; }
+  // Tolerance of the infeasibility and unboundedness certificates (0 = no
+  // detection). Each check costs two multiplications by A, every 10
+  // iterations. Only used by the CPU solver, the GPU solver returns
+  // POGS_ERROR if inf_tol > 0.
+  void SetInfTol(T inf_tol)                { _inf_tol = inf_tol; }
   void SetRelTol(T rel_tol)                { _rel_tol = rel_tol; }
   void SetMaxIter(unsigned int max_iter)   { _max_iter = max_iter; }
   void SetInitIter(unsigned int init_iter) { _init_iter = init_iter; }
   void SetVerbose(unsigned int verbose)    { _verbose = verbose; }
+  void SetStopCheck(StopCheckType stop_check) { _stop_check = stop_check; }
+  void SetStopCheckIter(unsigned int iter) { _stop_check_iter = iter; }
   void SetAdaptiveRho(bool adaptive_rho)   { _adaptive_rho = adaptive_rho; }
   void SetGapStop(bool gap_stop)           { _gap_stop = gap_stop; }
+  void SetCollectStats(bool collect_stats) { _collect_stats = collect_stats; }
+  // Evaluates the iterative proximal operators (kLogistic, kNegEntr and kExp)
+  // with fewer inner steps while the residuals are far above the tolerances,
+  // as the projection tolerance is relaxed in the early iterations. Only
+  // used by the CPU solver.
+  void SetInexactProx(bool inexact_prox)   { _inexact_prox = inexact_prox; }
+  // Calls callback(it, data) after the stopping criteria are evaluated at
+  // every iteration. If it returns false (and the solve has not converged),
+  // the solve stops with status POGS_INTERRUPTED. The objective it.optval is
+  // only evaluated if optval is true. Pass null to remove the callback.
+  void SetCallback(Callback callback, void *data, bool optval = false) {
+    _callback = callback;
+    _callback_data = data;
+    _callback_optval = optval;
+  }
+  // Records every iteration in trace (not owned), pass null to stop.
+  void SetTrace(PogsTrace<T> *trace)       { _trace = trace; }
+  // Anderson acceleration with a history of mem iterates (0 = off). Only
+  // implemented by the CPU solver, the GPU solver returns POGS_ERROR if
+  // mem > 0.
+  void SetAndersonMem(unsigned int mem)    { _anderson_mem = mem; }
+  void SetAndersonType(AndersonType type)  { _anderson_type = type; }
+  // Rule used to update rho when adaptive rho is enabled. The solver keeps its
+  // own copy of the policy. The GPU solver only implements RHO_HEURISTIC and
+  // returns POGS_ERROR for any other policy.
+  void SetRhoPolicy(RhoPolicyType type) {
+    _num_alloc += _rho_policy->NumAlloc() + 1;
+    delete _rho_policy;
+    _rho_policy = NewRhoPolicy<T>(type);
+  }
+  void SetRhoPolicy(const RhoPolicy<T> &policy) {
+    RhoPolicy<T> *rho_policy = policy.Clone();
+    _num_alloc += _rho_policy->NumAlloc() + 1;
+    delete _rho_policy;
+    _rho_policy = rho_policy;
+  }
   void SetInitX(const T *x) {
     memcpy(_x, x, _A.Cols() * sizeof(T));
     _init_x = true;
@@ -122,6 +333,8 @@ inline std::string PogsStatusString(PogsStatus status) {
       return "Reached max iter";
     case POGS_NAN_FOUND:
       return "Encountered NaN";
+    case POGS_INTERRUPTED:
+      return "Interrupted";
     case POGS_ERROR:
     default:
       return "Error";  
@@ -0,0 +1,204 @@
+#ifndef POGS_PATH_H_
+#define POGS_PATH_H_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "pogs.h"
+#include "prox_lib.h"
+
+namespace pogs {
+
+// Defaults.
+const double kKktTol = 1e-2;
+
+// Regularization path driver. Solves
+//
+//   minimize    f(y) + lambda_k g(x)
+//   subject to  y = Ax
+//
+// for a decreasing sequence lambda_1 > lambda_2 > ..., where lambda_k g is
+// obtained by scaling the parameters c, d and e of every term of g. Each
+// problem is warm started from the solution (z, zt, rho) of the previous one.
+//
+// Terms of the form c |a x_j| (ie. h = kAbs, b = 0, d = 0) are screened with
+// the sequential strong rule: x_j is fixed to zero at lambda_k if
+//
+//   |mu_j(lambda_{k-1})| < c |a| (2 lambda_k - lambda_{k-1}).
+//
+// After each solve the KKT condition |mu_j| <= lambda_k c |a| is checked for
+// the screened variables, and the problem is solved again with any violators
+// added back.
+//
+// If stop_tol > 0, the path stops early at the first lambda_k with
+//
+//   max_j |x_j(lambda_k) - x_j(lambda_{k-1})| < stop_tol ||x(lambda_k)||_1,
+//
+// and only the first GetNumSolved() points are solved.
+template <typename T, typename M, typename P>
+class PogsPath {
+ private:
+  Pogs<T, M, P> _pogs;
+  size_t _m, _n;
+
+  // Output, the k-th solution is stored at offset k * n (x, mu) or k * m (y).
+  std::vector<T> _x, _y, _mu, _optval;
+  std::vector<unsigned int> _final_iter, _num_screened, _num_violations;
+  std::vector<unsigned int> _num_alloc;
+  size_t _num_solved;
+
+  // Parameters.
+  T _kkt_tol, _stop_tol;
+  bool _screen;
+
+ public:
+  PogsPath(const M &A)
+      : _pogs(A), _m(A.Rows()), _n(A.Cols()), _num_solved(0),
+        _kkt_tol(static_cast<T>(kKktTol)), _stop_tol(static_cast<T>(0)),
+        _screen(true) { }
+
+  // Solve along the path lambda, which should be decreasing. Returns the
+  // status of each solved point.
+  std::vector<PogsStatus> Solve(const std::vector<FunctionObj<T> > &f,
+                                const std::vector<FunctionObj<T> > &g,
+                                const std::vector<T> &lambda);
+
+  // Underlying solver, use it to set tolerances, verbosity, etc.
+  Pogs<T, M, P>& Solver() { return _pogs; }
+
+  // Number of points solved by the last call to Solve.
+  size_t GetNumSolved() const { return _num_solved; }
+
+  // Getters for the k-th point on the path.
+  const T* GetX(size_t k)   const { return &_x[k * _n]; }
+  const T* GetY(size_t k)   const { return &_y[k * _m]; }
+  const T* GetMu(size_t k)  const { return &_mu[k * _n]; }
+  T GetOptval(size_t k)     const { return _optval[k]; }
+  // Total ADMM iterations, including re-solves after KKT violations.
+  unsigned int GetFinalIter(size_t k)    const { return _final_iter[k]; }
+  unsigned int GetNumScreened(size_t k)  const { return _num_screened[k]; }
+  unsigned int GetNumViolations(size_t k) const {
+    return _num_violations[k];
+  }
+  // Heap allocations made by the solver and by the conversion of g while
+  // solving the k-th point.
+  unsigned int GetNumAlloc(size_t k)     const { return _num_alloc[k]; }
+  T GetKktTol()                          const { return _kkt_tol; }
+  T GetStopTol()                         const { return _stop_tol; }
+  bool GetScreen()                       const { return _screen; }
+
+  // Setters for parameters.
+  void SetKktTol(T kkt_tol) { _kkt_tol = kkt_tol; }
+  void SetStopTol(T stop_tol) { _stop_tol = stop_tol; }
+  void SetScreen(bool screen) { _screen = screen; }
+};
+
+template <typename T, typename M, typename P>
+std::vector<PogsStatus> PogsPath<T, M, P>::Solve(
+    const std::vector<FunctionObj<T> > &f,
+    const std::vector<FunctionObj<T> > &g, const std::vector<T> &lambda) {
+  size_t K = lambda.size();
+  _x.assign(K * _n, static_cast<T>(0));
+  _y.assign(K * _m, static_cast<T>(0));
+  _mu.assign(K * _n, static_cast<T>(0));
+  _optval.assign(K, static_cast<T>(0));
+  _final_iter.assign(K, 0u);
+  _num_screened.assign(K, 0u);
+  _num_violations.assign(K, 0u);
+  _num_alloc.assign(K, 0u);
+  _num_solved = 0;
+  std::vector<PogsStatus> status(K);
+
+  // Penalty weights c |a| of the terms eligible for screening, 0 otherwise.
+  std::vector<T> weight(_n, static_cast<T>(0));
+  for (size_t j = 0; j < _n; ++j) {
+    if (g[j].h == kAbs && g[j].b == static_cast<T>(0) &&
+        g[j].d == static_cast<T>(0))
+      weight[j] = g[j].c * std::abs(g[j].a);
+  }
+
+  // f is the same along the path and is converted once. Parameters that are
+  // shared by all elements (eg. c = lambda_k when nothing is screened) are
+  // stored as scalars.
+  // The storage of g is allocated up front for all elements, since screening
+  // turns its scalar parameters into per-element ones.
+  FunctionSoA<T> f_soa, g_soa;
+  f_soa.Assign(f);
+  g_soa.Reserve(_n);
+
+  std::vector<FunctionObj<T> > g_k(g);
+  std::vector<bool> active(_n);
+  for (size_t k = 0; k < K; ++k) {
+    T lambda_k = lambda[k];
+    unsigned int num_alloc = _pogs.GetNumAlloc() + g_soa.NumAlloc();
+
+    // Sequential strong rule, based on the previous solution.
+    for (size_t j = 0; j < _n; ++j) {
+      active[j] = true;
+      if (_screen && k > 0 && weight[j] > static_cast<T>(0) &&
+          std::abs(_mu[(k - 1) * _n + j]) <
+          weight[j] * (2 * lambda_k - lambda[k - 1])) {
+        active[j] = false;
+        ++_num_screened[k];
+      }
+    }
+
+    for (;;) {
+      for (size_t j = 0; j < _n; ++j) {
+        if (active[j]) {
+          g_k[j] = g[j];
+          g_k[j].c *= lambda_k;
+          g_k[j].d *= lambda_k;
+          g_k[j].e *= lambda_k;
+        } else {
+          g_k[j] = FunctionObj<T>(kIndEq0);
+        }
+      }
+      g_soa.Assign(g_k);
+      status[k] = _pogs.Solve(f_soa, g_soa);
+      _final_iter[k] += _pogs.GetFinalIter();
+
+      // Check KKT conditions of the screened variables.
+      unsigned int num_violations = 0;
+      const T *mu = _pogs.GetMu();
+      for (size_t j = 0; j < _n; ++j) {
+        if (!active[j] && std::abs(mu[j]) >
+            (1 + _kkt_tol) * lambda_k * weight[j]) {
+          active[j] = true;
+          ++num_violations;
+        }
+      }
+      _num_violations[k] += num_violations;
+      if (num_violations == 0)
+        break;
+    }
+
+    std::copy(_pogs.GetX(), _pogs.GetX() + _n, _x.begin() + k * _n);
+    std::copy(_pogs.GetY(), _pogs.GetY() + _m, _y.begin() + k * _m);
+    std::copy(_pogs.GetMu(), _pogs.GetMu() + _n, _mu.begin() + k * _n);
+    _optval[k] = _pogs.GetOptval();
+    _num_alloc[k] = _pogs.GetNumAlloc() + g_soa.NumAlloc() - num_alloc;
+    _num_solved = k + 1;
+
+    // Stop once the solution no longer changes along the path.
+    if (_stop_tol > static_cast<T>(0) && k > 0) {
+      const T *x = &_x[k * _n], *x_prev = &_x[(k - 1) * _n];
+      T max_diff = static_cast<T>(0), asum = static_cast<T>(0);
+      for (size_t j = 0; j < _n; ++j) {
+        max_diff = std::max(max_diff, std::abs(x[j] - x_prev[j]));
+        asum += std::abs(x[j]);
+      }
+      if (max_diff < _stop_tol * asum)
+        break;
+    }
+  }
+
+  status.resize(_num_solved);
+  return status;
+}
+
+}  // namespace pogs
+
+#endif  // POGS_PATH_H_
+
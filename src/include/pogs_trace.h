@@ -0,0 +1,91 @@
+#ifndef POGS_TRACE_H_
+#define POGS_TRACE_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "pogs.h"
+
+namespace pogs {
+
+// Binary trace of the convergence history, attached with Pogs::SetTrace.
+// Iterations are stored as raw PogsIterate<T> records in a ring buffer of
+// fixed capacity, so recording an iteration is a copy of a few words, with
+// no formatting and no allocation.
+//
+// Without a sink, the ring buffer keeps the last capacity iterations. With a
+// sink, the buffer is written to it (with a single fwrite) whenever it fills
+// up and on Flush, so that the full history is kept. The file starts with a
+// header { char magic[8] = "POGSTRC", uint32 record size, uint32 sizeof(T) }
+// followed by the records.
+template <typename T>
+class PogsTrace {
+ private:
+  std::vector<PogsIterate<T> > _buf;
+  size_t _head, _size, _num_push;
+  FILE *_sink;
+
+  // Writes the records in order to the sink and empties the buffer.
+  void WriteSink() {
+    size_t tail = (_head + _buf.size() - _size) % _buf.size();
+    size_t first = std::min(_size, _buf.size() - tail);
+    fwrite(&_buf[tail], sizeof(PogsIterate<T>), first, _sink);
+    fwrite(&_buf[0], sizeof(PogsIterate<T>), _size - first, _sink);
+    _size = 0;
+  }
+
+ public:
+  PogsTrace(size_t capacity, FILE *sink = 0)
+      : _buf(capacity > 0 ? capacity : 1), _head(0), _size(0), _num_push(0),
+        _sink(sink) {
+    if (_sink) {
+      char magic[8] = "POGSTRC";
+      unsigned int sizes[2] = { sizeof(PogsIterate<T>), sizeof(T) };
+      fwrite(magic, 1, sizeof(magic), _sink);
+      fwrite(sizes, sizeof(unsigned int), 2, _sink);
+    }
+  }
+
+  ~PogsTrace() { Flush(); }
+
+  void Push(const PogsIterate<T> &it) {
+    if (_sink && _size == _buf.size())
+      WriteSink();
+    _buf[_head] = it;
+    _head = _head + 1 == _buf.size() ? 0 : _head + 1;
+    if (_size < _buf.size())
+      ++_size;
+    ++_num_push;
+  }
+
+  // Writes the buffered records to the sink (if any).
+  void Flush() {
+    if (_sink && _size > 0) {
+      WriteSink();
+      fflush(_sink);
+    }
+  }
+
+  // Discards all records.
+  void Clear() { _head = _size = _num_push = 0; }
+
+  // Number of records in the buffer, oldest first.
+  size_t Size() const { return _size; }
+  size_t Capacity() const { return _buf.size(); }
+  const PogsIterate<T>& operator[](size_t i) const {
+    return _buf[(_head + _buf.size() - _size + i) % _buf.size()];
+  }
+
+  // Total number of records pushed, and number overwritten (without a sink).
+  size_t NumPush() const { return _num_push; }
+  size_t NumDropped() const {
+    return _sink ? 0 : _num_push - _size;
+  }
+};
+
+}  // namespace pogs
+
+#endif  // POGS_TRACE_H_
+
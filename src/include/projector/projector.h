@@ -1,6 +1,8 @@
 #ifndef PROJECTOR_PROJECTOR_H_ 
 #define PROJECTOR_PROJECTOR_H_ 
 
+#include <cstddef>
+
 namespace pogs {
 
 // Minimizes ||Ax - y0||^2  + s ||x - x0||^2
@@ -11,15 +13,45 @@ class Projector {
 
   void *_info;
 
+  // Scratch space borrowed from the owner (eg. Pogs), may be null.
+  T *_work;
+
+  // Inner iterations (of iterative projectors) and bytes of host memory
+  // allocated so far.
+  size_t _num_iter, _bytes_alloc;
+
  public:
-  Projector() : _done_init(false), _info(0) { };
+  Projector()
+      : _done_init(false), _info(0), _work(0), _num_iter(0),
+        _bytes_alloc(0) { };
   virtual ~Projector() { };
   
   virtual int Init() = 0;
 
   virtual int Project(const T *x0, const T *y0, T s, T *x, T *y, T tol) = 0;
+
+  // Projects K points at once, where the j-th point is stored at
+  // (x0 + j * ld, y0 + j * ld) and its projection at (x + j * ld, y + j * ld).
+  // Defaults to K calls to Project.
+  virtual int ProjectBatch(size_t K, const T *x0, const T *y0, size_t ld, T s,
+                           T *x, T *y, T tol) {
+    for (size_t j = 0; j < K; ++j) {
+      int err = Project(x0 + j * ld, y0 + j * ld, s, x + j * ld, y + j * ld,
+          tol);
+      if (err)
+        return err;
+    }
+    return 0;
+  }
+
+  // Number of elements of scratch space needed by Project. If no workspace
+  // is set, Project allocates (and frees) its own scratch on every call.
+  virtual size_t WorkspaceSize() const { return 0; }
+  void SetWorkspace(T *work) { _work = work; }
   
   bool IsInit() { return _done_init; }
+  size_t NumIter() const { return _num_iter; }
+  size_t BytesAlloc() const { return _bytes_alloc; }
 };
 
 }  // namespace pogs
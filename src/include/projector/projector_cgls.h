@@ -7,7 +7,7 @@ namespace pogs {
 
 // Minimizes ||Ax - y0||_2^2  + s ||x - x0||_2^2
 template <typename T, typename M>
-class ProjectorCgls : Projector<T, M> {
+class ProjectorCgls : public Projector<T, M> {
  private:
   const M& _A;
 
@@ -22,6 +22,8 @@ class ProjectorCgls : Projector<T, M> {
   int Init();
 
   int Project(const T *x0, const T *y0, T s, T *x, T *y, T tol);
+
+  size_t WorkspaceSize() const;
 };
 
 }  // namespace pogs
@@ -7,7 +7,7 @@ namespace pogs {
 
 // Minimizes ||Ax - y0||^2  + s ||x - x0||^2
 template <typename T, typename M>
-class ProjectorDirect : Projector<T, M> {
+class ProjectorDirect : public Projector<T, M> {
  private:
   const M& _A;
 
@@ -22,6 +22,9 @@ class ProjectorDirect : Projector<T, M> {
   int Init();
 
   int Project(const T *x0, const T *y0, T s, T *x, T *y, T tol);
+
+  int ProjectBatch(size_t K, const T *x0, const T *y0, size_t ld, T s, T *x,
+                   T *y, T tol);
 };
 
 }  // namespace pogs
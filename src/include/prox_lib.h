@@ -20,6 +20,7 @@
 #endif
 
 #include "interface_defs.h"
+#include "parallel.h"
 
 // List of functions supported by the proximal operator library.
 enum Function { kAbs,       // f(x) = |x|
@@ -334,13 +335,10 @@ __DEVICE__ inline T ProxZero(T v, T rho) {
   return v;
 }
 
-// Evaluates the proximal operator of f.
+// Evaluates the proximal operator of h.
 template <typename T>
-__DEVICE__ inline T ProxEval(const FunctionObj<T> &f_obj, T v, T rho) {
-  const T a = f_obj.a, b = f_obj.b, c = f_obj.c, d = f_obj.d, e = f_obj.e;
-  v = a * (v * rho - d) / (e + rho) - b;
-  rho = (e + rho) / (c * a * a);
-  switch (f_obj.h) {
+__DEVICE__ inline T ProxEvalH(Function h, T v, T rho) {
+  switch (h) {
     case kAbs: v = ProxAbs(v, rho); break;
     case kNegEntr: v = ProxNegEntr(v, rho); break;
     case kExp: v = ProxExp(v, rho); break;
@@ -358,6 +356,16 @@ __DEVICE__ inline T ProxEval(const FunctionObj<T> &f_obj, T v, T rho) {
     case kSquare: v = ProxSquare(v, rho); break;
     case kZero: default: v = ProxZero(v, rho); break;
   }
+  return v;
+}
+
+// Evaluates the proximal operator of f.
+template <typename T>
+__DEVICE__ inline T ProxEval(const FunctionObj<T> &f_obj, T v, T rho) {
+  const T a = f_obj.a, b = f_obj.b, c = f_obj.c, d = f_obj.d, e = f_obj.e;
+  v = a * (v * rho - d) / (e + rho) - b;
+  rho = (e + rho) / (c * a * a);
+  v = ProxEvalH(f_obj.h, v, rho);
   return (v + b) / a;
 }
 
@@ -453,13 +461,10 @@ __DEVICE__ inline T FuncZero(T x) {
   return 0;
 }
 
-// Evaluates the function f.
+// Evaluates the function h.
 template <typename T>
-__DEVICE__ inline T FuncEval(const FunctionObj<T> &f_obj, T x) {
-  T dx = f_obj.d * x;
-  T ex = f_obj.e * x * x / 2;
-  x = f_obj.a * x - f_obj.b;
-  switch (f_obj.h) {
+__DEVICE__ inline T FuncEvalH(Function h, T x) {
+  switch (h) {
     case kAbs: x = FuncAbs(x); break;
     case kNegEntr: x = FuncNegEntr(x); break;
     case kExp: x = FuncExp(x); break;
@@ -477,6 +482,16 @@ __DEVICE__ inline T FuncEval(const FunctionObj<T> &f_obj, T x) {
     case kSquare: x = FuncSquare(x); break;
     case kZero: default: x = FuncZero(x); break;
   }
+  return x;
+}
+
+// Evaluates the function f.
+template <typename T>
+__DEVICE__ inline T FuncEval(const FunctionObj<T> &f_obj, T x) {
+  T dx = f_obj.d * x;
+  T ex = f_obj.e * x * x / 2;
+  x = f_obj.a * x - f_obj.b;
+  x = FuncEvalH(f_obj.h, x);
   return f_obj.c * x + dx + ex;
 }
 
@@ -596,15 +611,10 @@ __DEVICE__ inline T ProjSubgradZero(T v, T x) {
   return static_cast<T>(0.);
 }
 
-// Evaluates the projection of v onto the subgradient of f at x.
+// Evaluates the projection of v onto the subgradient of h at axb.
 template <typename T>
-__DEVICE__ inline T ProjSubgradEval(const FunctionObj<T> &f_obj, T v, T x) {
-  const T a = f_obj.a, b = f_obj.b, c = f_obj.c, d = f_obj.d, e = f_obj.e;
-  if (a == static_cast<T>(0.) || c == static_cast<T>(0.))
-    return d + e * x;
-  v = static_cast<T>(1.) / (a * c) * (v - d - e * x);
-  T axb = a * x - b;
-  switch (f_obj.h) {
+__DEVICE__ inline T ProjSubgradEvalH(Function h, T v, T axb) {
+  switch (h) {
     case kAbs: v = ProjSubgradAbs(v, axb); break;
     case kNegEntr: v = ProjSubgradNegEntr(v, axb); break;
     case kExp: v = ProjSubgradExp(v, axb); break;
@@ -622,10 +632,110 @@ __DEVICE__ inline T ProjSubgradEval(const FunctionObj<T> &f_obj, T v, T x) {
     case kSquare: v = ProjSubgradSquare(v, axb); break;
     case kZero: default: v = ProjSubgradZero(v, axb); break;
   }
+  return v;
+}
+
+// Evaluates the projection of v onto the subgradient of f at x.
+template <typename T>
+__DEVICE__ inline T ProjSubgradEval(const FunctionObj<T> &f_obj, T v, T x) {
+  const T a = f_obj.a, b = f_obj.b, c = f_obj.c, d = f_obj.d, e = f_obj.e;
+  if (a == static_cast<T>(0.) || c == static_cast<T>(0.))
+    return d + e * x;
+  v = static_cast<T>(1.) / (a * c) * (v - d - e * x);
+  T axb = a * x - b;
+  v = ProjSubgradEvalH(f_obj.h, v, axb);
   return a * c * v + d + e * x;
 }
 
 
+// Domain and recession function definitions
+//
+// Used to verify infeasibility and unboundedness certificates. Since these
+// are evaluated at limits of iterates, arguments with |v| <= tol are treated
+// as zero.
+
+// Returns the interval [lo, hi] containing dom h.
+template <typename T>
+inline void DomainH(Function h, T *lo, T *hi) {
+  const T kInf = std::numeric_limits<T>::infinity();
+  *lo = -kInf;
+  *hi = kInf;
+  switch (h) {
+    case kIndBox01: *lo = static_cast<T>(0.); *hi = static_cast<T>(1.); break;
+    case kIndEq0: *lo = *hi = static_cast<T>(0.); break;
+    case kIndGe0: case kNegEntr: case kNegLog: case kRecipr:
+      *lo = static_cast<T>(0.); break;
+    case kIndLe0: *hi = static_cast<T>(0.); break;
+    default: break;
+  }
+}
+
+// Returns true if h is an indicator function, which is not scaled by c.
+inline bool IsIndicator(Function h) {
+  return h == kIndBox01 || h == kIndEq0 || h == kIndGe0 || h == kIndLe0;
+}
+
+// Returns sup {v x : x in dom f}, the support function of the domain of
+// c * h(a * x - b) + d * x + (e / 2) * x^2. For c = 0 (and h not an
+// indicator) the domain is the whole line.
+template <typename T>
+inline T DomainSupport(const FunctionObj<T> &f_obj, T v, T tol) {
+  if (std::abs(v) <= tol)
+    return static_cast<T>(0.);
+  if (f_obj.c == static_cast<T>(0.) && !IsIndicator(f_obj.h))
+    return std::numeric_limits<T>::infinity();
+  T lo, hi;
+  DomainH(f_obj.h, &lo, &hi);
+  if (f_obj.a == static_cast<T>(0.))
+    return std::numeric_limits<T>::infinity();
+  // a * x - b in [lo, hi].
+  lo = (lo + f_obj.b) / f_obj.a;
+  hi = (hi + f_obj.b) / f_obj.a;
+  if (f_obj.a < static_cast<T>(0.))
+    std::swap(lo, hi);
+  return v > static_cast<T>(0.) ? v * hi : v * lo;
+}
+
+// Returns the recession function of h at t, ie. lim_{s -> inf} h(s t) / s.
+template <typename T>
+inline T RecessionH(Function h, T t, T tol) {
+  const T kInf = std::numeric_limits<T>::infinity();
+  const T kNil = static_cast<T>(0.);
+  bool pos = t > tol, neg = t < -tol;
+  switch (h) {
+    case kAbs: case kHuber: return pos || neg ? std::abs(t) : kNil;
+    case kExp: return pos ? kInf : kNil;
+    case kIdentity: return pos || neg ? t : kNil;
+    case kIndBox01: case kIndEq0: case kSquare: return pos || neg ? kInf : kNil;
+    case kIndGe0: case kNegLog: case kRecipr: return neg ? kInf : kNil;
+    case kIndLe0: return pos ? kInf : kNil;
+    case kLogistic: case kMaxPos0: return pos ? t : kNil;
+    case kMaxNeg0: return neg ? -t : kNil;
+    case kNegEntr: return pos || neg ? kInf : kNil;
+    case kZero: default: return kNil;
+  }
+}
+
+// Returns the recession function of c * h(a * x - b) + d * x + (e / 2) * x^2
+// at v.
+template <typename T>
+inline T RecessionEval(const FunctionObj<T> &f_obj, T v, T tol) {
+  if (std::abs(v) <= tol)
+    return static_cast<T>(0.);
+  if (f_obj.e > static_cast<T>(0.))
+    return std::numeric_limits<T>::infinity();
+  T av = f_obj.a * v;
+  T h_rec = RecessionH(f_obj.h, av, std::abs(f_obj.a) * tol);
+  // Indicator functions are not scaled by c.
+  T c = IsIndicator(f_obj.h) ? static_cast<T>(1.) : f_obj.c;
+  if (c == static_cast<T>(0.))
+    h_rec = static_cast<T>(0.);
+  else
+    h_rec *= c;
+  return h_rec + f_obj.d * v;
+}
+
+
 // Evaluates the proximal operator Prox{f_obj[i]}(x_in[i]) -> x_out[i].
 //
 // @param f_obj Vector of function objects.
@@ -635,10 +745,12 @@ __DEVICE__ inline T ProjSubgradEval(const FunctionObj<T> &f_obj, T v, T x) {
 template <typename T>
 void ProxEval(const std::vector<FunctionObj<T> > &f_obj, T rho, const T *x_in,
               T *x_out) {
+  size_t size = f_obj.size();
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel for schedule(static, ParallelChunk<T>(size)) \
+    if (size >= kParallelMinSize)
 #endif
-  for (unsigned int i = 0; i < f_obj.size(); ++i)
+  for (size_t i = 0; i < size; ++i)
     x_out[i] = ProxEval(f_obj[i], x_in[i], rho);
 }
 
@@ -651,11 +763,13 @@ void ProxEval(const std::vector<FunctionObj<T> > &f_obj, T rho, const T *x_in,
 // @returns Evaluation of sum of functions.
 template <typename T>
 T FuncEval(const std::vector<FunctionObj<T> > &f_obj, const T* x_in) {
+  size_t size = f_obj.size();
   T sum = 0;
 #ifdef _OPENMP
-#pragma omp parallel for reduction(+:sum)
+#pragma omp parallel for schedule(static, ParallelChunk<T>(size)) \
+    reduction(+:sum) if (size >= kParallelMinSize)
 #endif
-  for (unsigned int i = 0; i < f_obj.size(); ++i)
+  for (size_t i = 0; i < size; ++i)
     sum += FuncEval(f_obj[i], x_in[i]);
   return sum;
 }
@@ -670,10 +784,12 @@ T FuncEval(const std::vector<FunctionObj<T> > &f_obj, const T* x_in) {
 template <typename T>
 void ProjSubgradEval(const std::vector<FunctionObj<T> > &f_obj, const T *x_in,
                      const T *v_in, T *v_out) {
+  size_t size = f_obj.size();
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel for schedule(static, ParallelChunk<T>(size)) \
+    if (size >= kParallelMinSize)
 #endif
-  for (unsigned int i = 0; i < f_obj.size(); ++i)
+  for (size_t i = 0; i < size; ++i)
     v_out[i] = ProjSubgradEval(f_obj[i], v_in[i], x_in[i]);
 }
 
@@ -0,0 +1,306 @@
+#ifndef PROX_LIB_BLOCK_H_
+#define PROX_LIB_BLOCK_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "prox_lib.h"
+
+// List of block functions h : R^k -> R, evaluated jointly over a block of k
+// consecutive elements, ie. functions that are not separable. They are
+// applied as c * h(a .* x - b) + sum_i (d_i * x_i + (1/2) e_i * x_i^2), with
+// the parameters a, b, d and e of each element (see FunctionSoA), so that
+// group lasso, second order cone and simplex constraints need not be modeled
+// with additional rows of A.
+enum BlockFunction { kBlockNorm2,        // h(x) = ||x||_2
+                     kBlockIndSoc,       // h(x) = I(||x_{1:k-1}||_2 <= x_0)
+                     kBlockIndSimplex }; // h(x) = I(x >= 0, sum_i x_i = 1)
+
+// Returns true if h is an indicator function, which is not scaled by c.
+inline bool BlockIndicator(BlockFunction h) {
+  return h == kBlockIndSoc || h == kBlockIndSimplex;
+}
+
+namespace {
+
+// Maximum number of iterations of the root finding methods below. All of
+// them converge monotonically, typically in a handful of iterations.
+const unsigned int kBlockMaxIter = 50u;
+
+// Returns the root t >= t0 of the secular equation
+//
+//   ||g ./ (t + lam)||_2 = 1,
+//
+// where t0 + lam > 0 and ||g ./ (t0 + lam)||_2 >= 1. Newton's method is
+// applied to 1 / ||g ./ (t + lam)||_2 - 1, which is concave and increasing in
+// t (cf. the trust region subproblem), so that the iterates increase
+// monotonically to the root. If all lam are equal, the first step is exact.
+template <typename T>
+inline T SecularRoot(size_t k, const T *g, const T *lam, T t) {
+  const T kEps = 4 * std::numeric_limits<T>::epsilon();
+  for (unsigned int iter = 0; iter < kBlockMaxIter; ++iter) {
+    T ssq = 0, dssq = 0;
+    for (size_t i = 0; i < k; ++i) {
+      T p = g[i] / (t + lam[i]);
+      ssq += p * p;
+      dssq += p * p / (t + lam[i]);
+    }
+    T nrm = std::sqrt(ssq);
+    if (nrm - 1 <= kEps || dssq == 0)
+      break;
+    T dt = (nrm - 1) * ssq / dssq;
+    t += dt;
+    if (dt <= kEps * t)
+      break;
+  }
+  return t;
+}
+
+// Returns the Euclidean norm of x.
+template <typename T>
+inline T BlockNorm2(size_t k, const T *x) {
+  T ssq = 0;
+  for (size_t i = 0; i < k; ++i)
+    ssq += x[i] * x[i];
+  return std::sqrt(ssq);
+}
+
+}  // namespace
+
+
+// Weighted proximal operators
+//
+//   u = argmin_u h(u) + (1/2) sum_i w_i * (u_i - z_i)^2,
+//
+// with weights w_i > 0. The weights are needed since the quadratic terms of
+// the elements of a block (e_i + rho) / a_i^2 differ after equilibration.
+// The array u may alias z, while w is overwritten.
+
+// h(u) = ||u||_2. The solution is u = 0 if ||w .* z||_2 <= 1, and
+// u_i = t z_i / (t + 1 / w_i) with t = ||u||_2 otherwise.
+template <typename T>
+inline void ProxBlockNorm2(size_t k, const T *z, T *w, T *u) {
+  T ssq = 0;
+  for (size_t i = 0; i < k; ++i) {
+    ssq += w[i] * z[i] * w[i] * z[i];
+    w[i] = 1 / w[i];
+  }
+  T t = 0;
+  if (ssq > 1)
+    t = SecularRoot(k, z, w, static_cast<T>(0.));
+  for (size_t i = 0; i < k; ++i)
+    u[i] = t * z[i] / (t + w[i]);
+}
+
+// h(u) = I(||u_{1:k-1}||_2 <= u_0). If z is neither in the cone nor in its
+// (weighted) polar cone, the projection lies on the boundary, with
+// u_0 = s, u_i = s * p_i and p_i = w_i z_i / ((w_i + w_0) s - w_0 z_0) for
+// i > 0, where s solves ||p||_2 = 1.
+template <typename T>
+inline void ProxBlockIndSoc(size_t k, const T *z, T *w, T *u) {
+  T z0 = z[0], w0 = w[0];
+  T nrm = BlockNorm2(k - 1, z + 1);
+  T ssq_w = 0;
+  for (size_t i = 1; i < k; ++i)
+    ssq_w += w[i] * z[i] * w[i] * z[i];
+  if (nrm <= z0) {
+    for (size_t i = 0; i < k; ++i)
+      u[i] = z[i];
+    return;
+  }
+  if (std::sqrt(ssq_w) <= -w0 * z0) {
+    for (size_t i = 0; i < k; ++i)
+      u[i] = static_cast<T>(0.);
+    return;
+  }
+  // p_i = g_i / (s + lam_i), with g and lam stored in u and w.
+  for (size_t i = 1; i < k; ++i) {
+    T wi = w[i];
+    u[i] = wi * z[i] / (wi + w0);
+    w[i] = -w0 * z0 / (wi + w0);
+  }
+  T s = z0 == 0 ? BlockNorm2(k - 1, u + 1)
+      : SecularRoot(k - 1, u + 1, w + 1, std::max(z0, static_cast<T>(0.)));
+  u[0] = s;
+  for (size_t i = 1; i < k; ++i)
+    u[i] = s * u[i] / (s + w[i]);
+}
+
+// h(u) = I(u >= 0, sum_i u_i = 1). The solution is u_i = max(0, z_i - l / w_i)
+// where l solves sum_i u_i = 1. The sum is convex, piecewise linear and
+// decreasing in l, so Newton's method from the left converges monotonically,
+// in at most k steps.
+template <typename T>
+inline void ProxBlockIndSimplex(size_t k, const T *z, const T *w, T *u) {
+  T sum_z = 0, sum_w = 0, l_min = std::numeric_limits<T>::infinity();
+  for (size_t i = 0; i < k; ++i) {
+    sum_z += z[i];
+    sum_w += 1 / w[i];
+    l_min = std::min(l_min, w[i] * z[i]);
+  }
+  T l = std::min((sum_z - 1) / sum_w, l_min);
+  for (size_t iter = 0; iter <= k; ++iter) {
+    T sum = 0, sum_act = 0;
+    for (size_t i = 0; i < k; ++i) {
+      T u_i = z[i] - l / w[i];
+      if (u_i > 0) {
+        sum += u_i;
+        sum_act += 1 / w[i];
+      }
+    }
+    if (sum <= 1 || sum_act == 0)
+      break;
+    T l_next = l + (sum - 1) / sum_act;
+    if (l_next <= l)
+      break;
+    l = l_next;
+  }
+  for (size_t i = 0; i < k; ++i)
+    u[i] = std::max(z[i] - l / w[i], static_cast<T>(0.));
+}
+
+template <typename T>
+inline void ProxBlockH(BlockFunction h, size_t k, const T *z, T *w, T *u) {
+  switch (h) {
+    case kBlockNorm2: ProxBlockNorm2(k, z, w, u); break;
+    case kBlockIndSoc: ProxBlockIndSoc(k, z, w, u); break;
+    case kBlockIndSimplex: default: ProxBlockIndSimplex(k, z, w, u); break;
+  }
+}
+
+
+// Function definitions. As in prox_lib.h, indicator functions evaluate to 0.
+template <typename T>
+inline T FuncBlockH(BlockFunction h, size_t k, const T *u) {
+  return h == kBlockNorm2 ? BlockNorm2(k, u) : static_cast<T>(0.);
+}
+
+
+// Projection of v onto the subdifferential of h at u, in place.
+
+template <typename T>
+inline void ProjSubgradBlockNorm2(size_t k, const T *u, T *v) {
+  T nrm = BlockNorm2(k, u);
+  if (nrm > 0) {
+    for (size_t i = 0; i < k; ++i)
+      v[i] = u[i] / nrm;
+  } else {
+    T scale = 1 / std::max(BlockNorm2(k, v), static_cast<T>(1.));
+    for (size_t i = 0; i < k; ++i)
+      v[i] *= scale;
+  }
+}
+
+// The normal cone of the second order cone is {0} in the interior, the polar
+// cone at the apex and the ray (-1, u_{1:k-1} / ||u_{1:k-1}||_2) on the
+// boundary.
+template <typename T>
+inline void ProjSubgradBlockIndSoc(size_t k, const T *u, T *v) {
+  T nrm_u = BlockNorm2(k - 1, u + 1);
+  if (nrm_u < u[0]) {
+    for (size_t i = 0; i < k; ++i)
+      v[i] = static_cast<T>(0.);
+  } else if (nrm_u == 0) {
+    // v := -Proj_K(-v).
+    T nrm_v = BlockNorm2(k - 1, v + 1);
+    if (nrm_v <= -v[0]) {
+      return;
+    } else if (nrm_v <= v[0]) {
+      for (size_t i = 0; i < k; ++i)
+        v[i] = static_cast<T>(0.);
+    } else {
+      T alpha = (nrm_v - v[0]) / 2;
+      v[0] = -alpha;
+      for (size_t i = 1; i < k; ++i)
+        v[i] *= alpha / nrm_v;
+    }
+  } else {
+    T dot = -v[0];
+    for (size_t i = 1; i < k; ++i)
+      dot += v[i] * u[i] / nrm_u;
+    T alpha = std::max(dot / 2, static_cast<T>(0.));
+    v[0] = -alpha;
+    for (size_t i = 1; i < k; ++i)
+      v[i] = alpha * u[i] / nrm_u;
+  }
+}
+
+// The normal cone of the simplex at u is {l - mu : mu >= 0, mu_i = 0 for
+// u_i > 0}. The projection is v_i = l for u_i > 0 and v_i = min(l, v_i)
+// otherwise, where l is found as in ProxBlockIndSimplex.
+template <typename T>
+inline void ProjSubgradBlockIndSimplex(size_t k, const T *u, T *v) {
+  T l = 0;
+  for (size_t i = 0; i < k; ++i)
+    l += v[i];
+  l /= k;
+  for (size_t iter = 0; iter <= k; ++iter) {
+    T sum = 0;
+    size_t num = 0;
+    for (size_t i = 0; i < k; ++i) {
+      if (u[i] > 0 || v[i] > l) {
+        sum += v[i];
+        ++num;
+      }
+    }
+    if (num == 0 || sum / num <= l)
+      break;
+    l = sum / num;
+  }
+  for (size_t i = 0; i < k; ++i)
+    v[i] = u[i] > 0 ? l : std::min(l, v[i]);
+}
+
+template <typename T>
+inline void ProjSubgradBlockH(BlockFunction h, size_t k, const T *u, T *v) {
+  switch (h) {
+    case kBlockNorm2: ProjSubgradBlockNorm2(k, u, v); break;
+    case kBlockIndSoc: ProjSubgradBlockIndSoc(k, u, v); break;
+    case kBlockIndSimplex: default: ProjSubgradBlockIndSimplex(k, u, v);
+  }
+}
+
+
+// Domain and recession function definitions (cf. prox_lib.h), where entries
+// of y with |y_i| <= tol are treated as zero.
+
+// Returns sup {y^T u : u in dom h}.
+template <typename T>
+inline T DomainSupportBlockH(BlockFunction h, size_t k, const T *y, T tol) {
+  const T kInf = std::numeric_limits<T>::infinity();
+  T y_max = -kInf, ssq = 0;
+  for (size_t i = 0; i < k; ++i) {
+    T y_i = std::abs(y[i]) <= tol ? static_cast<T>(0.) : y[i];
+    y_max = std::max(y_max, y_i);
+    ssq += i > 0 || h != kBlockIndSoc ? y_i * y_i : static_cast<T>(0.);
+  }
+  T y0 = std::abs(y[0]) <= tol ? static_cast<T>(0.) : y[0];
+  switch (h) {
+    case kBlockNorm2: return ssq > 0 ? kInf : static_cast<T>(0.);
+    case kBlockIndSoc:
+      return std::sqrt(ssq) <= -y0 + tol ? static_cast<T>(0.) : kInf;
+    case kBlockIndSimplex: default: return y_max;
+  }
+}
+
+// Returns the recession function of h at y.
+template <typename T>
+inline T RecessionBlockH(BlockFunction h, size_t k, const T *y, T tol) {
+  const T kInf = std::numeric_limits<T>::infinity();
+  T ssq = 0;
+  for (size_t i = 0; i < k; ++i) {
+    T y_i = std::abs(y[i]) <= tol ? static_cast<T>(0.) : y[i];
+    ssq += i > 0 || h != kBlockIndSoc ? y_i * y_i : static_cast<T>(0.);
+  }
+  T y0 = std::abs(y[0]) <= tol ? static_cast<T>(0.) : y[0];
+  switch (h) {
+    case kBlockNorm2: return std::sqrt(ssq);
+    case kBlockIndSoc:
+      return std::sqrt(ssq) <= y0 + tol ? static_cast<T>(0.) : kInf;
+    case kBlockIndSimplex: default: return ssq > 0 ? kInf : static_cast<T>(0.);
+  }
+}
+
+#endif  // PROX_LIB_BLOCK_H_
@@ -0,0 +1,130 @@
+#ifndef PROX_LIB_PIECEWISE_H_
+#define PROX_LIB_PIECEWISE_H_
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "prox_lib_simd.h"
+#include "util.h"
+
+// Convex piecewise-quadratic function h : R -> R with breakpoints
+// t_0 < t_1 < ... < t_{k-1}, which is given on piece i, ie. on
+// [t_{i-1}, t_i] with t_{-1} = -inf and t_k = +inf, by
+//
+//   h(x) = (1/2) q_i * x^2 + l_i * x + c_i,
+//
+// with q_i >= 0. The constants c_i are chosen so that h is continuous and
+// h(0) = 0, and h is convex if its derivative does not decrease at the
+// breakpoints, ie. q_{j-1} * t_j + l_{j-1} <= q_j * t_j + l_j (with the
+// pieces numbered from 0 to k). Piecewise-linear functions have q = 0.
+//
+// PiecewiseFunction is a function object for FunctionSoA::AddCustom, so that
+// a piecewise cost of a_i * x - b_i takes a single row of A, rather than one
+// row per breakpoint with kMaxPos0. The proximal operator and the function
+// locate the piece of their argument by a binary search with a fixed number
+// of steps, ceil(log2(k + 1)), and no branches, so that the loops over a
+// segment remain vectorizable (with gathers).
+template <typename T>
+class PiecewiseFunction {
+ private:
+  // Breakpoints, padded with -inf and +inf, so that piece i lies in
+  // [_t[i], _t[i + 1]], and coefficients q, l and c of the k + 1 pieces.
+  std::vector<T> _t, _q, _l, _c;
+  size_t _k;
+
+  // Returns the number of j in [0, k) with key(j) < w, where key is
+  // nondecreasing, by a binary search whose steps depend only on k.
+  template <typename K>
+  __SIMD_INLINE__ size_t LowerBound(const K &key, T w) const {
+    size_t base = 0, n = _k;
+    while (n > 1) {
+      size_t half = n / 2;
+      base = key(base + half - 1) < w ? base + half : base;
+      n -= half;
+    }
+    return base + (n == 1 && key(base) < w ? 1 : 0);
+  }
+
+  // Key of the proximal operator, rho * x + h'(x) at x = t_j on piece j + 1.
+  struct ProxKey {
+    const T *t, *q, *l;
+    T rho;
+    __SIMD_INLINE__ T operator()(size_t j) const {
+      return (q[j + 1] + rho) * t[j + 1] + l[j + 1];
+    }
+  };
+
+  // Key of the function, the breakpoint t_j.
+  struct BreakKey {
+    const T *t;
+    __SIMD_INLINE__ T operator()(size_t j) const { return t[j + 1]; }
+  };
+
+ public:
+  // Breakpoints t (k values, strictly increasing), slopes l and curvatures q
+  // of the k + 1 pieces. If q is empty, h is piecewise-linear.
+  PiecewiseFunction(const std::vector<T> &t, const std::vector<T> &l,
+                    const std::vector<T> &q = std::vector<T>())
+      : _q(q), _l(l), _c(l.size(), static_cast<T>(0)), _k(t.size()) {
+    const T kInf = std::numeric_limits<T>::infinity();
+    ASSERT(l.size() == _k + 1);
+    if (_q.empty())
+      _q.resize(_k + 1, static_cast<T>(0));
+    ASSERT(_q.size() == _k + 1);
+    _t.reserve(_k + 2);
+    _t.push_back(-kInf);
+    _t.insert(_t.end(), t.begin(), t.end());
+    _t.push_back(kInf);
+    for (size_t i = 0; i <= _k; ++i)
+      ASSERT(_q[i] >= static_cast<T>(0));
+    for (size_t j = 1; j <= _k; ++j) {
+      ASSERT(_t[j] < _t[j + 1]);
+      ASSERT(_q[j - 1] * _t[j] + _l[j - 1] <= _q[j] * _t[j] + _l[j]);
+    }
+
+    // Continuity at the breakpoints, starting from the piece that contains 0.
+    size_t p = LowerBound(BreakKey{_t.data()}, static_cast<T>(0));
+    for (size_t i = p; i < _k; ++i) {
+      T x = _t[i + 1];
+      _c[i + 1] = _c[i] + (_q[i] - _q[i + 1]) * x * x / 2 +
+          (_l[i] - _l[i + 1]) * x;
+    }
+    for (size_t i = p; i > 0; --i) {
+      T x = _t[i];
+      _c[i - 1] = _c[i] + (_q[i] - _q[i - 1]) * x * x / 2 +
+          (_l[i] - _l[i - 1]) * x;
+    }
+  }
+
+  // Number of breakpoints.
+  size_t NumBreaks() const { return _k; }
+
+  // argmin_x h(x) + (rho / 2) (x - v)^2. The minimizer lies on the piece i
+  // for which rho * v is in the range of rho * x + h'(x) over [t_{i-1}, t_i],
+  // which is found by a search over the breakpoints, as this function of x
+  // is increasing. The stationary point of piece i is then clamped to it.
+  __SIMD_INLINE__ T Prox(T v, T rho) const {
+    ProxKey key = { _t.data(), _q.data(), _l.data(), rho };
+    size_t i = LowerBound(key, rho * v);
+    T x = (rho * v - _l[i]) / (_q[i] + rho);
+    return Min(Max(x, _t[i]), _t[i + 1]);
+  }
+
+  __SIMD_INLINE__ T Func(T x) const {
+    size_t i = LowerBound(BreakKey{_t.data()}, x);
+    return (_q[i] * x / 2 + _l[i]) * x + _c[i];
+  }
+
+  // Projection of v onto [h'(x-), h'(x+)], which is a single point unless x
+  // is a breakpoint.
+  __SIMD_INLINE__ T ProjSubgrad(T v, T x) const {
+    size_t i = LowerBound(BreakKey{_t.data()}, x);
+    size_t i_hi = x == _t[i + 1] ? i + 1 : i;
+    T lo = _q[i] * x + _l[i];
+    T hi = _q[i_hi] * x + _l[i_hi];
+    return Min(Max(v, lo), hi);
+  }
+};
+
+#endif  // PROX_LIB_PIECEWISE_H_
@@ -0,0 +1,303 @@
+#ifndef PROX_LIB_SIMD_H_
+#define PROX_LIB_SIMD_H_
+
+#include <stdint.h>
+
+#include <cstring>
+
+#include "prox_lib.h"
+
+// Vectorizable variants of the proximal operators in prox_lib.h that call
+// transcendental functions. Scalar exp and log calls, and loops with data
+// dependent exits, keep the compiler from vectorizing the loops of the
+// FunctionSoA kernels. The functions below are branch free, with fixed trip
+// counts, and use polynomial approximations of exp and log accurate to a few
+// ulps, so that the kernels in function_soa.h vectorize under #pragma omp simd
+// (with -fopenmp-simd, -fno-trapping-math and -fno-math-errno, which the
+// Makefile sets, so also without -fopenmp). They agree with the scalar
+// versions to within Tol<T>().
+
+// Each function below is inlined into the loops of the FunctionSoA kernels,
+// since a call to it prevents the loop from being vectorized. The inliner's
+// size limits would otherwise leave some out of line, as the kernels of all
+// functions h are instantiated in a single parallel region.
+#ifdef __GNUC__
+#define __SIMD_INLINE__ inline __attribute__((always_inline))
+#else
+#define __SIMD_INLINE__ inline
+#endif
+
+namespace {
+//  Reinterpret the bits of a floating point number as an integer and back.
+__SIMD_INLINE__ uint64_t AsBits(double x) {
+  uint64_t u;
+  memcpy(&u, &x, sizeof(u));
+  return u;
+}
+__SIMD_INLINE__ uint32_t AsBits(float x) {
+  uint32_t u;
+  memcpy(&u, &x, sizeof(u));
+  return u;
+}
+__SIMD_INLINE__ double DoubleFromBits(uint64_t u) {
+  double x;
+  memcpy(&x, &u, sizeof(x));
+  return x;
+}
+__SIMD_INLINE__ float FloatFromBits(uint32_t u) {
+  float x;
+  memcpy(&x, &u, sizeof(x));
+  return x;
+}
+
+//  Evaluate e^x, as exp(x) = 2^k exp(r) with |r| <= log(2) / 2. The integer
+//  k is rounded by adding and subtracting 1.5 * 2^52, which also leaves k in
+//  the low bits of the sum, so 2^k is formed without a float to int
+//  conversion. Arguments are clamped to the range where 2^k is normal.
+__SIMD_INLINE__ double ExpSimd(double x) {
+  const double kMagic = 6755399441055744.0;
+  const double kLn2Hi = 6.93147180369123816490e-01;
+  const double kLn2Lo = 1.90821492927058770002e-10;
+  x = x < -708.0 ? -708.0 : x;
+  x = x > 709.0 ? 709.0 : x;
+  double k = x * 1.44269504088896338700 + kMagic;
+  uint64_t k_bits = AsBits(k);
+  k -= kMagic;
+  double r = (x - k * kLn2Hi) - k * kLn2Lo;
+  // Taylor series of exp(r) up to r^12, evaluated with Estrin's scheme, which
+  // has a shorter dependency chain than Horner's rule.
+  double r2 = r * r, r4 = r2 * r2, r8 = r4 * r4;
+  double p01 = 1.0 + r;
+  double p23 = 1.0 / 2.0 + r * (1.0 / 6.0);
+  double p45 = 1.0 / 24.0 + r * (1.0 / 120.0);
+  double p67 = 1.0 / 720.0 + r * (1.0 / 5040.0);
+  double p89 = 1.0 / 40320.0 + r * (1.0 / 362880.0);
+  double p1011 = 1.0 / 3628800.0 + r * (1.0 / 39916800.0);
+  double p03 = p01 + r2 * p23;
+  double p47 = p45 + r2 * p67;
+  double p811 = p89 + r2 * (p1011 + r2 * (1.0 / 479001600.0));
+  double p = (p03 + r4 * p47) + r8 * p811;
+  return p * DoubleFromBits((k_bits + 1023u) << 52);
+}
+
+__SIMD_INLINE__ float ExpSimd(float x) {
+  const float kMagic = 12582912.0f;
+  const float kLn2Hi = 6.93145752e-01f;
+  const float kLn2Lo = 1.42860677e-06f;
+  x = x < -87.0f ? -87.0f : x;
+  x = x > 88.0f ? 88.0f : x;
+  float k = x * 1.44269504f + kMagic;
+  uint32_t k_bits = AsBits(k);
+  k -= kMagic;
+  float r = (x - k * kLn2Hi) - k * kLn2Lo;
+  // Taylor series of exp(r) up to r^7, evaluated with Estrin's scheme.
+  float r2 = r * r, r4 = r2 * r2;
+  float p01 = 1.0f + r;
+  float p23 = 1.0f / 2.0f + r * (1.0f / 6.0f);
+  float p45 = 1.0f / 24.0f + r * (1.0f / 120.0f);
+  float p67 = 1.0f / 720.0f + r * (1.0f / 5040.0f);
+  float p = (p01 + r2 * p23) + r4 * (p45 + r2 * p67);
+  return p * FloatFromBits((k_bits + 127u) << 23);
+}
+
+//  Evaluate log(x) for normal x > 0, as log(x) = k log(2) + log(m) with m in
+//  [sqrt(1/2), sqrt(2)), where log(m) = 2 atanh((m - 1) / (m + 1)). The
+//  exponent k is converted to floating point by placing it in the mantissa
+//  of 2^52 (or 2^23).
+__SIMD_INLINE__ double LogSimd(double x) {
+  const double kLn2Hi = 6.93147180369123816490e-01;
+  const double kLn2Lo = 1.90821492927058770002e-10;
+  uint64_t bits = AsBits(x);
+  double k = DoubleFromBits((bits >> 52) | 0x4330000000000000ull)
+      - (4503599627370496.0 + 1023.0);
+  double m = DoubleFromBits(
+      (bits & 0x000fffffffffffffull) | 0x3ff0000000000000ull);
+  bool big = m > 1.41421356237309504880;
+  m = big ? 0.5 * m : m;
+  k = big ? k + 1.0 : k;
+  double s = (m - 1.0) / (m + 1.0), s2 = s * s;
+  // Series of atanh(s) / s up to s^18.
+  double p = 1.0 / 19.0;
+  p = p * s2 + 1.0 / 17.0;
+  p = p * s2 + 1.0 / 15.0;
+  p = p * s2 + 1.0 / 13.0;
+  p = p * s2 + 1.0 / 11.0;
+  p = p * s2 + 1.0 / 9.0;
+  p = p * s2 + 1.0 / 7.0;
+  p = p * s2 + 1.0 / 5.0;
+  p = p * s2 + 1.0 / 3.0;
+  p = p * s2 + 1.0;
+  return k * kLn2Hi + (k * kLn2Lo + 2.0 * s * p);
+}
+
+__SIMD_INLINE__ float LogSimd(float x) {
+  uint32_t bits = AsBits(x);
+  float k = FloatFromBits((bits >> 23) | 0x4b000000u)
+      - (8388608.0f + 127.0f);
+  float m = FloatFromBits((bits & 0x007fffffu) | 0x3f800000u);
+  bool big = m > 1.41421356f;
+  m = big ? 0.5f * m : m;
+  k = big ? k + 1.0f : k;
+  float s = (m - 1.0f) / (m + 1.0f), s2 = s * s;
+  // Series of atanh(s) / s up to s^8.
+  float p = 1.0f / 9.0f;
+  p = p * s2 + 1.0f / 7.0f;
+  p = p * s2 + 1.0f / 5.0f;
+  p = p * s2 + 1.0f / 3.0f;
+  p = p * s2 + 1.0f;
+  return k * 6.93147181e-01f + 2.0f * s * p;
+}
+
+// LambertW(Exp(x)), as LambertWExp. The root w > 0 of w + log(w) = x is found
+// with a fixed number of steps of Fritsch's iteration, which converges with
+// fourth order and needs a log instead of an exp per step. The initial guess
+// is e^x for x < -2, the series of LambertWExp about the branch point for
+// x < 0.5, x for x < log(3) and x - log(x) beyond. From this guess three
+// steps give w to within a few ulps for x in [-700, 100]. For x > 100 the
+// approximation of LambertWExp is returned, so that the two agree.
+// ref: F. N. Fritsch, R. E. Shafer and W. P. Crowley, Algorithm 443.
+template <typename T, unsigned int S>
+__SIMD_INLINE__ T LambertWExpSimd(T x) {
+  const T kOne = static_cast<T>(1);
+  // Approximation for x in [100, 700].
+  T log_x = LogSimd(x > kOne ? x : kOne);
+  T w_big = static_cast<T>(-0.36962844)
+      + x
+      - static_cast<T>(0.97284858) * log_x
+      + static_cast<T>(1.3437973) / log_x;
+
+  T exp_x = ExpSimd(x);
+  T p = Sqrt(static_cast<T>(2.0)
+      * (static_cast<T>(2.718281828459045) * exp_x + kOne));
+  T w = static_cast<T>(-1.0)
+      + p * (static_cast<T>(1.0)
+          + p * (static_cast<T>(-1.0 / 3.0)
+              + p * static_cast<T>(11.0 / 72.0)));
+  w = x < static_cast<T>(-2) ? exp_x : w;
+  w = x < static_cast<T>(0.5) ? w
+      : x < static_cast<T>(1.098612288668110) ? x : x - log_x;
+
+#ifdef __GNUC__
+#pragma GCC unroll 3
+#endif
+  for (unsigned int i = 0u; i < S; i++) {
+    T z = x - w - LogSimd(w);
+    T w1 = w + kOne;
+    T q = static_cast<T>(2) * w1 * (w1 + static_cast<T>(2.0 / 3.0) * z);
+    w *= kOne + z * (q - z) / (w1 * (q - static_cast<T>(2) * z));
+  }
+  return x > static_cast<T>(100) ? w_big : w;
+}
+}  // namespace
+
+// Accuracy of the proximal operators of kLogistic, kNegEntr and kExp, which
+// are evaluated with a fixed number of steps of an iterative method. Fewer
+// steps are exact enough while ADMM is far from converged (see
+// Pogs::SetInexactProx). The errors are relative to max(1, |x|).
+enum ProxAccuracy { kProxCoarse,   // One step, error below 5e-2.
+                    kProxMedium,   // Two steps, error below 1e-6.
+                    kProxExact };  // Within Tol<T>() of prox_lib.h.
+
+// Returns the lowest accuracy with an error below tol.
+template <typename T>
+inline ProxAccuracy ProxAccuracyTol(T tol) {
+  return tol >= static_cast<T>(1e-1) ? kProxCoarse
+      : tol >= static_cast<T>(1e-6) ? kProxMedium : kProxExact;
+}
+
+// Number of steps of ProxLogisticSimd and of LambertWExpSimd for accuracy P.
+// In single precision two steps of either are as accurate as more, so float
+// takes the medium path for kProxExact.
+template <typename T>
+inline constexpr unsigned int LogisticSteps(ProxAccuracy P) {
+  return P == kProxCoarse ? 1u : P == kProxMedium || sizeof(T) == 4 ? 2u : 4u;
+}
+
+template <typename T>
+inline constexpr unsigned int LambertWSteps(ProxAccuracy P) {
+  return P == kProxCoarse ? 1u : P == kProxMedium || sizeof(T) == 4 ? 2u : 3u;
+}
+
+// ProxNegEntr and ProxExp evaluate LambertWExp in double precision. Here it
+// is evaluated in the precision of T, which is within Tol<float>() for float
+// and keeps the vectors of the float kernels twice as wide.
+template <ProxAccuracy P, typename T>
+__SIMD_INLINE__ T ProxNegEntrSimd(T v, T rho) {
+  return LambertWExpSimd<T, LambertWSteps<T>(P)>(
+      (rho * v - 1) + LogSimd(rho)) / rho;
+}
+
+template <ProxAccuracy P, typename T>
+__SIMD_INLINE__ T ProxExpSimd(T v, T rho) {
+  return v - LambertWExpSimd<T, LambertWSteps<T>(P)>(v - LogSimd(rho));
+}
+
+// Safeguarded iteration of ProxLogistic, with a fixed number of Halley steps
+// in place of the Newton steps and the guarded method. For small rho the root
+// may lie in a tail of the sigmoid, where steps from the piecewise guess move
+// x by about one per step, so the guess is improved with the root of
+// e^x = rho (v - x), approximated by x = log(rho) + log(v - log(rho)), and
+// with its reflection for the tail where 1 - 1 / (1 + e^-x) ~ e^-x. The
+// iterates stay in the bracket [l, u]. Three steps converge for rho in
+// [1e-12, 1e12] and |v| up to 1e6, and one more is taken as a margin.
+template <ProxAccuracy P, typename T>
+__SIMD_INLINE__ T ProxLogisticSimd(T v, T rho) {
+  const unsigned int kSteps = LogisticSteps<T>(P);
+  // Initial guess based on piecewise approximation.
+  T x = v < static_cast<T>(-2.5) ? v
+      : (rho * v - static_cast<T>(0.5)) / (static_cast<T>(0.2) + rho);
+  x = v > static_cast<T>(2.5) + 1 / rho ? v - 1 / rho : x;
+  T log_rho = LogSimd(rho);
+  T v_tail = v - log_rho;
+  T x_tail = log_rho + LogSimd(v_tail > 1 ? v_tail : static_cast<T>(1));
+  v_tail = 1 / rho - v - log_rho;
+  T x_tail_pos = -log_rho - LogSimd(v_tail > 1 ? v_tail : static_cast<T>(1));
+
+  // The root is negative if f(0) = 1 / 2 - rho v > 0, and positive otherwise.
+  T l = v - 1 / rho, u = v;
+  bool neg = rho * v < static_cast<T>(0.5);
+  u = neg && u > 0 ? 0 : u;
+  l = !neg && l < 0 ? 0 : l;
+  x = neg && x_tail < x ? x_tail : x;
+  x = !neg && x_tail_pos > x ? x_tail_pos : x;
+  x = x > u ? u : x;
+  x = x < l ? l : x;
+
+  // Halley iteration.
+#ifdef __GNUC__
+#pragma GCC unroll 4
+#endif
+  for (unsigned int i = 0; i < kSteps; ++i) {
+    // With e = exp(-|x|) and q = 1 + e, the sigmoid is n / q, where n = 1
+    // for x >= 0 and n = e otherwise. Then f = f_q / q, f' = g_q / q^2 and
+    // f'' = h_q / q^3, so that the Halley step 2 f f' / (2 f'^2 - f f'')
+    // takes a single division and e does not overflow.
+    T e = ExpSimd(x < 0 ? x : -x);
+    T q = 1 + e;
+    T n = x < 0 ? e : static_cast<T>(1);
+    T f_q = n + rho * (x - v) * q;
+    T g_q = e + rho * q * q;
+    T h_q = e * (q - 2 * n);
+    l = f_q < 0 ? x : l;
+    u = f_q < 0 ? u : x;
+    x = x - 2 * f_q * g_q * q / (2 * g_q * g_q - f_q * h_q);
+    x = x > u ? u : x;
+    x = x < l ? l : x;
+  }
+  return x;
+}
+
+// Evaluates the proximal operator of h, as ProxEvalH, with the vectorizable
+// variants for the functions that have one, to accuracy P.
+template <ProxAccuracy P = kProxExact, typename T>
+__SIMD_INLINE__ T ProxEvalSimdH(Function h, T v, T rho) {
+  switch (h) {
+    case kNegEntr: return ProxNegEntrSimd<P>(v, rho);
+    case kExp: return ProxExpSimd<P>(v, rho);
+    case kLogistic: return ProxLogisticSimd<P>(v, rho);
+    default: return ProxEvalH(h, v, rho);
+  }
+}
+
+#endif  // PROX_LIB_SIMD_H_
+
@@ -0,0 +1,275 @@
+#ifndef RHO_POLICY_H_
+#define RHO_POLICY_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "parallel.h"
+
+namespace pogs {
+
+// Built-in rho policies.
+enum RhoPolicyType { RHO_HEURISTIC,           // Multiplicative bumps (default).
+                     RHO_RESIDUAL_BALANCING,  // Balance pri/dua residuals.
+                     RHO_SPECTRAL };          // Barzilai-Borwein estimates.
+
+// State of the ADMM iteration passed to RhoPolicy::Update, after the
+// projection and before the dual update. All vectors are of length size and
+// live in the equilibrated space, with z = (x, y). In terms of the iterates,
+//
+//   lambda_hat = rho (zprev - zt - z12)   in the subdifferential of f + g
+//                                         at z12,
+//   lambda     = rho (zt + alpha z12 + (1 - alpha) zprev - z)
+//                                         in the normal cone of {y = Ax} at z.
+template <typename T>
+struct RhoInfo {
+  unsigned int k;
+  T nrm_r, nrm_s, eps_pri, eps_dua, alpha;
+  size_t size;
+  const T *z, *z12, *zprev, *zt;
+};
+
+// Interface for rules that update the penalty parameter rho between
+// iterations. Since the projection does not depend on rho, policies are free
+// to change it at any iteration.
+template <typename T>
+class RhoPolicy {
+ public:
+  virtual ~RhoPolicy() { }
+
+  // Called at the start of every solve with the initial rho.
+  virtual void Reset(T rho) = 0;
+
+  // Updates rho and returns the factor by which the scaled dual variable zt
+  // must be multiplied (ie. old rho / new rho).
+  virtual T Update(const RhoInfo<T> &info, T *rho) = 0;
+
+  // Returns a new copy of the policy (owned by the caller).
+  virtual RhoPolicy<T>* Clone() const = 0;
+
+  // Number of heap allocations made so far by Update.
+  virtual unsigned int NumAlloc() const { return 0u; }
+
+ protected:
+  // Limits on rho.
+  static T RhoMin() { return static_cast<T>(1e-4); }
+  static T RhoMax() { return static_cast<T>(1e4); }
+};
+
+// Heuristic from the original POGS: rho is bumped by a factor delta, which
+// grows while the bumps go in the same direction, whenever one residual is
+// below (a shrinking fraction xi of) its tolerance and the other is not.
+template <typename T>
+class RhoPolicyHeuristic : public RhoPolicy<T> {
+ private:
+  T _delta, _xi;
+  unsigned int _kd, _ku;
+
+ public:
+  RhoPolicyHeuristic() { Reset(static_cast<T>(1)); }
+
+  void Reset(T rho) {
+    _delta = static_cast<T>(1.05);
+    _xi = static_cast<T>(1.);
+    _kd = _ku = 0u;
+  }
+
+  T Update(const RhoInfo<T> &info, T *rho) {
+    const T kDeltaMin   = static_cast<T>(1.05);
+    const T kGamma      = static_cast<T>(1.01);
+    const T kTau        = static_cast<T>(0.8);
+    const T kKappa      = static_cast<T>(0.9);
+
+    T zt_scale = static_cast<T>(1.);
+    if (info.nrm_s < _xi * info.eps_dua && info.nrm_r > _xi * info.eps_pri &&
+        kTau * static_cast<T>(info.k) > static_cast<T>(_kd)) {
+      if (*rho < this->RhoMax()) {
+        *rho *= _delta;
+        zt_scale = 1 / _delta;
+        _delta = kGamma * _delta;
+        _ku = info.k;
+      }
+    } else if (info.nrm_s > _xi * info.eps_dua &&
+        info.nrm_r < _xi * info.eps_pri &&
+        kTau * static_cast<T>(info.k) > static_cast<T>(_ku)) {
+      if (*rho > this->RhoMin()) {
+        *rho /= _delta;
+        zt_scale = _delta;
+        _delta = kGamma * _delta;
+        _kd = info.k;
+      }
+    } else if (info.nrm_s < _xi * info.eps_dua &&
+        info.nrm_r < _xi * info.eps_pri) {
+      _xi *= kKappa;
+    } else {
+      _delta = kDeltaMin;
+    }
+    return zt_scale;
+  }
+
+  RhoPolicy<T>* Clone() const { return new RhoPolicyHeuristic<T>(*this); }
+};
+
+// Residual balancing (Boyd et al., 2011, Sec. 3.4.1), applied to the
+// residuals normalized by their tolerances: rho is multiplied (divided) by
+// tau whenever the primal (dual) residual exceeds mu times the other.
+template <typename T>
+class RhoPolicyResidualBalancing : public RhoPolicy<T> {
+ private:
+  T _mu, _tau;
+
+ public:
+  RhoPolicyResidualBalancing(T mu = static_cast<T>(10),
+                             T tau = static_cast<T>(2))
+      : _mu(mu), _tau(tau) { }
+
+  void Reset(T rho) { }
+
+  T Update(const RhoInfo<T> &info, T *rho) {
+    T r = info.nrm_r / info.eps_pri;
+    T s = info.nrm_s / info.eps_dua;
+    if (r > _mu * s && *rho < this->RhoMax()) {
+      *rho *= _tau;
+      return 1 / _tau;
+    } else if (s > _mu * r && *rho > this->RhoMin()) {
+      *rho /= _tau;
+      return _tau;
+    }
+    return static_cast<T>(1.);
+  }
+
+  RhoPolicy<T>* Clone() const {
+    return new RhoPolicyResidualBalancing<T>(*this);
+  }
+};
+
+// Spectral adaptive ADMM (Xu, Figueiredo and Goldstein, 2017). Every
+// freq iterations, the curvature of f + g is estimated from the changes in
+// (z12, lambda_hat), and the curvature of the graph indicator from the
+// changes in (z, lambda), using hybrid Barzilai-Borwein step sizes. An
+// estimate is only used if the correlation between the changes exceeds
+// eps_cor, and rho is set to the geometric mean of the reliable estimates.
+template <typename T>
+class RhoPolicySpectral : public RhoPolicy<T> {
+ private:
+  unsigned int _freq;
+  T _eps_cor;
+
+  // Iterates at the last update.
+  std::vector<T> _z0, _z120, _lambda0, _lambda_hat0;
+  std::vector<T> _lambda, _lambda_hat;
+  bool _have_prev;
+  unsigned int _num_alloc;
+
+  // Resizes v, returns the number of allocations (0 or 1).
+  static unsigned int Resize(std::vector<T> *v, size_t size) {
+    size_t capacity = v->capacity();
+    v->resize(size);
+    return v->capacity() != capacity;
+  }
+
+  // Hybrid BB estimate from dot products of the changes (du, dl). Returns
+  // false if the estimate is unreliable.
+  static bool Estimate(T du_du, T du_dl, T dl_dl, T eps_cor, T *est) {
+    if (!(du_dl > 0) || !(du_du > 0) || !(dl_dl > 0))
+      return false;
+    T cor = du_dl / std::sqrt(du_du * dl_dl);
+    if (cor <= eps_cor)
+      return false;
+    T sd = dl_dl / du_dl;
+    T mg = du_dl / du_du;
+    *est = 2 * mg > sd ? mg : sd - mg / 2;
+    return true;
+  }
+
+ public:
+  RhoPolicySpectral(unsigned int freq = 2u, T eps_cor = static_cast<T>(0.2))
+      : _freq(freq), _eps_cor(eps_cor), _have_prev(false), _num_alloc(0) { }
+
+  void Reset(T rho) { _have_prev = false; }
+
+  T Update(const RhoInfo<T> &info, T *rho) {
+    if (info.k % _freq != 0)
+      return static_cast<T>(1.);
+
+    size_t size = info.size;
+    _num_alloc += Resize(&_lambda, size) + Resize(&_lambda_hat, size);
+    const T kOneMinusAlpha = static_cast<T>(1) - info.alpha;
+    T rho_ = *rho;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(size)) \
+    if (size >= kParallelMinSize)
+#endif
+    for (size_t i = 0; i < size; ++i) {
+      _lambda_hat[i] = rho_ * (info.zprev[i] - info.zt[i] - info.z12[i]);
+      _lambda[i] = rho_ * (info.zt[i] + info.alpha * info.z12[i] +
+          kOneMinusAlpha * info.zprev[i] - info.z[i]);
+    }
+
+    T zt_scale = static_cast<T>(1.);
+    if (_have_prev) {
+      T hh = 0, hl = 0, ll = 0, gg = 0, gl = 0, mm = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, ParallelChunk<T>(size)) \
+    reduction(+:hh, hl, ll, gg, gl, mm) if (size >= kParallelMinSize)
+#endif
+      for (size_t i = 0; i < size; ++i) {
+        T dh = info.z12[i] - _z120[i];
+        T dl = _lambda_hat[i] - _lambda_hat0[i];
+        T dg = info.z[i] - _z0[i];
+        T dm = _lambda[i] - _lambda0[i];
+        hh += dh * dh;
+        hl += dh * dl;
+        ll += dl * dl;
+        gg += dg * dg;
+        gl += dg * dm;
+        mm += dm * dm;
+      }
+      T alpha, beta;
+      bool alpha_ok = Estimate(hh, hl, ll, _eps_cor, &alpha);
+      bool beta_ok = Estimate(gg, gl, mm, _eps_cor, &beta);
+      T rho_new = rho_;
+      if (alpha_ok && beta_ok)
+        rho_new = std::sqrt(alpha * beta);
+      else if (alpha_ok)
+        rho_new = alpha;
+      else if (beta_ok)
+        rho_new = beta;
+      rho_new = std::min(std::max(rho_new, this->RhoMin()), this->RhoMax());
+      zt_scale = rho_ / rho_new;
+      *rho = rho_new;
+    }
+
+    _num_alloc += Resize(&_z0, size) + Resize(&_z120, size);
+    std::copy(info.z, info.z + size, _z0.begin());
+    std::copy(info.z12, info.z12 + size, _z120.begin());
+    _lambda0.swap(_lambda);
+    _lambda_hat0.swap(_lambda_hat);
+    _have_prev = true;
+    return zt_scale;
+  }
+
+  // The iterates are discarded by Reset, so they are not copied.
+  RhoPolicy<T>* Clone() const {
+    return new RhoPolicySpectral<T>(_freq, _eps_cor);
+  }
+
+  unsigned int NumAlloc() const { return _num_alloc; }
+};
+
+// Returns a new instance of a built-in policy (owned by the caller).
+template <typename T>
+RhoPolicy<T>* NewRhoPolicy(RhoPolicyType type) {
+  switch (type) {
+    case RHO_RESIDUAL_BALANCING: return new RhoPolicyResidualBalancing<T>();
+    case RHO_SPECTRAL: return new RhoPolicySpectral<T>();
+    case RHO_HEURISTIC: default: return new RhoPolicyHeuristic<T>();
+  }
+}
+
+}  // namespace pogs
+
+#endif  // RHO_POLICY_H_
+
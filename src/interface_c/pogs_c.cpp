@@ -3,33 +3,49 @@
 #include "pogs.h"
 #include "pogs_c.h"
 
-template <typename T, ORD O>
-int Pogs(size_t m, size_t n, const T *A,
-         const T *f_a, const T *f_b, const T *f_c, const T *f_d, const T *f_e,
-         const FUNCTION *f_h,
-         const T *g_a, const T *g_b, const T *g_c, const T *g_d, const T *g_e,
-         const FUNCTION *g_h,
+// Sets the parameters of f from spec, passing scalars through as scalars.
+template <typename T, typename S>
+void PopulateFunctionSoA(const S &spec, size_t size, FunctionSoA<T> *f) {
+  f->Resize(size);
+  if (spec.h_vec) {
+    std::vector<Function> h(size);
+    for (size_t i = 0; i < size; ++i)
+      h[i] = static_cast<Function>(spec.h_vec[i]);
+    f->SetH(h.data());
+  } else {
+    f->SetH(static_cast<Function>(spec.h));
+  }
+  if (spec.a_vec) f->SetA(spec.a_vec); else f->SetA(spec.a);
+  if (spec.b_vec) f->SetB(spec.b_vec); else f->SetB(spec.b);
+  if (spec.c_vec) f->SetC(spec.c_vec); else f->SetC(spec.c);
+  if (spec.d_vec) f->SetD(spec.d_vec); else f->SetD(spec.d);
+  if (spec.e_vec) f->SetE(spec.e_vec); else f->SetE(spec.e);
+}
+
+// Returns the spec with all parameters given as arrays.
+template <typename T, typename S>
+S ArraySpec(const T *a, const T *b, const T *c, const T *d, const T *e,
+            const FUNCTION *h) {
+  S spec = { ZERO, 1, 0, 1, 0, 0, h, a, b, c, d, e };
+  return spec;
+}
+
+template <typename T, typename S>
+int Pogs(const pogs::MatrixDense<T> &A_, const S &f_spec, const S &g_spec,
          T rho, T abs_tol, T rel_tol, unsigned int max_iter, unsigned int verbose,
          bool adaptive_rho, bool gap_stop, T *x, T *y, T *l, T *optval,
          unsigned int *final_iter) {
+  size_t m = A_.Rows(), n = A_.Cols();
+
   // Create pogs struct.
-  char ord = O == ROW_MAJ ? 'r' : 'c';
-  pogs::MatrixDense<T> A_(ord, m, n, A);
   pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_);
 
-  std::vector<FunctionObj<T> > f;
-  std::vector<FunctionObj<T> > g;
+  FunctionSoA<T> f;
+  FunctionSoA<T> g;
 
   // Set f and g.
-  f.reserve(m);
-  for (unsigned int i = 0; i < m; ++i)
-    f.emplace_back(static_cast<Function>(f_h[i]), f_a[i], f_b[i], f_c[i],
-        f_d[i], f_e[i]);
-
-  g.reserve(n);
-  for (unsigned int i = 0; i < n; ++i)
-    g.emplace_back(static_cast<Function>(g_h[i]), g_a[i], g_b[i], g_c[i],
-         g_d[i], g_e[i]);
+  PopulateFunctionSoA(f_spec, m, &f);
+  PopulateFunctionSoA(g_spec, n, &g);
 
   // Set parameters.
   pogs_data.SetRho(rho);
@@ -45,13 +61,36 @@ int Pogs(size_t m, size_t n, const T *A,
   *optval = pogs_data.GetOptval();
   *final_iter = pogs_data.GetFinalIter();
 
-  memcpy(x, pogs_data.GetX(), n);
-  memcpy(y, pogs_data.GetY(), m);
-  memcpy(l, pogs_data.GetLambda(), m);
+  memcpy(x, pogs_data.GetX(), n * sizeof(T));
+  memcpy(y, pogs_data.GetY(), m * sizeof(T));
+  memcpy(l, pogs_data.GetLambda(), m * sizeof(T));
 
   return err;
 }
 
+template <typename T, ORD O, typename S>
+int Pogs(size_t m, size_t n, const T *A, const S &f_spec, const S &g_spec,
+         T rho, T abs_tol, T rel_tol, unsigned int max_iter, unsigned int verbose,
+         bool adaptive_rho, bool gap_stop, T *x, T *y, T *l, T *optval,
+         unsigned int *final_iter) {
+  char ord = O == ROW_MAJ ? 'r' : 'c';
+  pogs::MatrixDense<T> A_(ord, m, n, A);
+  return Pogs<T>(A_, f_spec, g_spec, rho, abs_tol, rel_tol, max_iter,
+      verbose, adaptive_rho, gap_stop, x, y, l, optval, final_iter);
+}
+
+// Same as above, but equilibrates A in place rather than in a copy.
+template <typename T, ORD O, typename S>
+int PogsInPlace(size_t m, size_t n, T *A, const S &f_spec, const S &g_spec,
+                T rho, T abs_tol, T rel_tol, unsigned int max_iter,
+                unsigned int verbose, bool adaptive_rho, bool gap_stop, T *x,
+                T *y, T *l, T *optval, unsigned int *final_iter) {
+  char ord = O == ROW_MAJ ? 'r' : 'c';
+  pogs::MatrixDense<T> A_(ord, m, n, A, pogs::MatrixDense<T>::IN_PLACE);
+  return Pogs<T>(A_, f_spec, g_spec, rho, abs_tol, rel_tol, max_iter,
+      verbose, adaptive_rho, gap_stop, x, y, l, optval, final_iter);
+}
+
 extern "C" {
 int PogsD(enum ORD ord, size_t m, size_t n, const double *A,
           const double *f_a, const double *f_b, const double *f_c,
@@ -62,15 +101,17 @@ int PogsD(enum ORD ord, size_t m, size_t n, const double *A,
           unsigned int verbose, int adaptive_rho, int gap_stop,
           double *x, double *y, double *l, double *optval,
           unsigned int *final_iter) {
+  FunctionSpecD f = ArraySpec<double, FunctionSpecD>(
+      f_a, f_b, f_c, f_d, f_e, f_h);
+  FunctionSpecD g = ArraySpec<double, FunctionSpecD>(
+      g_a, g_b, g_c, g_d, g_e, g_h);
   if (ord == COL_MAJ) {
-    return Pogs<double, COL_MAJ>(m, n, A, f_a, f_b, f_c, f_d, f_e, f_h,
-        g_a, g_b, g_c, g_d, g_e, g_h, rho, abs_tol, rel_tol, max_iter,
-        verbose, static_cast<bool>(adaptive_rho),
+    return Pogs<double, COL_MAJ>(m, n, A, f, g, rho, abs_tol, rel_tol,
+        max_iter, verbose, static_cast<bool>(adaptive_rho),
         static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
   } else {
-    return Pogs<double, ROW_MAJ>(m, n, A, f_a, f_b, f_c, f_d, f_e, f_h,
-        g_a, g_b, g_c, g_d, g_e, g_h, rho, abs_tol, rel_tol, max_iter,
-        verbose, static_cast<bool>(adaptive_rho),
+    return Pogs<double, ROW_MAJ>(m, n, A, f, g, rho, abs_tol, rel_tol,
+        max_iter, verbose, static_cast<bool>(adaptive_rho),
         static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
   }
 }
@@ -84,18 +125,89 @@ int PogsS(enum ORD ord, size_t m, size_t n, const float *A,
           unsigned int verbose, int adaptive_rho, int gap_stop,
           float *x, float *y, float *l, float *optval,
           unsigned int *final_iter) {
+  FunctionSpecS f = ArraySpec<float, FunctionSpecS>(
+      f_a, f_b, f_c, f_d, f_e, f_h);
+  FunctionSpecS g = ArraySpec<float, FunctionSpecS>(
+      g_a, g_b, g_c, g_d, g_e, g_h);
   if (ord == COL_MAJ) {
-    return Pogs<float, COL_MAJ>(m, n, A, f_a, f_b, f_c, f_d, f_e, f_h,
-        g_a, g_b, g_c, g_d, g_e, g_h, rho, abs_tol, rel_tol, max_iter,
-        verbose, static_cast<bool>(adaptive_rho),
+    return Pogs<float, COL_MAJ>(m, n, A, f, g, rho, abs_tol, rel_tol,
+        max_iter, verbose, static_cast<bool>(adaptive_rho),
         static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
   } else {
-    return Pogs<float, ROW_MAJ>(m, n, A, f_a, f_b, f_c, f_d, f_e, f_h,
-        g_a, g_b, g_c, g_d, g_e, g_h, rho, abs_tol, rel_tol, max_iter,
-        verbose, static_cast<bool>(adaptive_rho),
+    return Pogs<float, ROW_MAJ>(m, n, A, f, g, rho, abs_tol, rel_tol,
+        max_iter, verbose, static_cast<bool>(adaptive_rho),
         static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
   }
 }
 
+int PogsSpecD(enum ORD ord, size_t m, size_t n, const double *A,
+              const struct FunctionSpecD *f, const struct FunctionSpecD *g,
+              double rho, double abs_tol, double rel_tol,
+              unsigned int max_iter, unsigned int verbose, int adaptive_rho,
+              int gap_stop, double *x, double *y, double *l, double *optval,
+              unsigned int *final_iter) {
+  if (ord == COL_MAJ) {
+    return Pogs<double, COL_MAJ>(m, n, A, *f, *g, rho, abs_tol, rel_tol,
+        max_iter, verbose, static_cast<bool>(adaptive_rho),
+        static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
+  } else {
+    return Pogs<double, ROW_MAJ>(m, n, A, *f, *g, rho, abs_tol, rel_tol,
+        max_iter, verbose, static_cast<bool>(adaptive_rho),
+        static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
+  }
+}
+
+int PogsSpecS(enum ORD ord, size_t m, size_t n, const float *A,
+              const struct FunctionSpecS *f, const struct FunctionSpecS *g,
+              float rho, float abs_tol, float rel_tol,
+              unsigned int max_iter, unsigned int verbose, int adaptive_rho,
+              int gap_stop, float *x, float *y, float *l, float *optval,
+              unsigned int *final_iter) {
+  if (ord == COL_MAJ) {
+    return Pogs<float, COL_MAJ>(m, n, A, *f, *g, rho, abs_tol, rel_tol,
+        max_iter, verbose, static_cast<bool>(adaptive_rho),
+        static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
+  } else {
+    return Pogs<float, ROW_MAJ>(m, n, A, *f, *g, rho, abs_tol, rel_tol,
+        max_iter, verbose, static_cast<bool>(adaptive_rho),
+        static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
+  }
 }
 
+int PogsSpecInPlaceD(enum ORD ord, size_t m, size_t n, double *A,
+                     const struct FunctionSpecD *f,
+                     const struct FunctionSpecD *g, double rho,
+                     double abs_tol, double rel_tol, unsigned int max_iter,
+                     unsigned int verbose, int adaptive_rho, int gap_stop,
+                     double *x, double *y, double *l, double *optval,
+                     unsigned int *final_iter) {
+  if (ord == COL_MAJ) {
+    return PogsInPlace<double, COL_MAJ>(m, n, A, *f, *g, rho, abs_tol,
+        rel_tol, max_iter, verbose, static_cast<bool>(adaptive_rho),
+        static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
+  } else {
+    return PogsInPlace<double, ROW_MAJ>(m, n, A, *f, *g, rho, abs_tol,
+        rel_tol, max_iter, verbose, static_cast<bool>(adaptive_rho),
+        static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
+  }
+}
+
+int PogsSpecInPlaceS(enum ORD ord, size_t m, size_t n, float *A,
+                     const struct FunctionSpecS *f,
+                     const struct FunctionSpecS *g, float rho, float abs_tol,
+                     float rel_tol, unsigned int max_iter,
+                     unsigned int verbose, int adaptive_rho, int gap_stop,
+                     float *x, float *y, float *l, float *optval,
+                     unsigned int *final_iter) {
+  if (ord == COL_MAJ) {
+    return PogsInPlace<float, COL_MAJ>(m, n, A, *f, *g, rho, abs_tol,
+        rel_tol, max_iter, verbose, static_cast<bool>(adaptive_rho),
+        static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
+  } else {
+    return PogsInPlace<float, ROW_MAJ>(m, n, A, *f, *g, rho, abs_tol,
+        rel_tol, max_iter, verbose, static_cast<bool>(adaptive_rho),
+        static_cast<bool>(gap_stop), x, y, l, optval, final_iter);
+  }
+}
+
+}
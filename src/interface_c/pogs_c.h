@@ -33,6 +33,11 @@
 // - real_t *l         : Array for dual vector lambda.
 // - real_t *optval    : Pointer to single real for f(y^*) + g(x^*).
 //
+// PogsSpecD/PogsSpecS take f and g as function specs instead, see below.
+// PogsSpecInPlaceD/PogsSpecInPlaceS equilibrate A in place, rather than in a
+// copy of A, so that on return A holds the scaled matrix
+// D * A * E / ||D * A * E||_F.
+//
 // Author: Chris Fougner (fougner@stanford.edu)
 //
 
@@ -57,6 +62,24 @@ enum FUNCTION { ABS,       // f(x) = |x|
                 SQUARE,    // f(x) = (1/2) x^2
                 ZERO };    // f(x) = 0
 
+// Function spec, in which each parameter is either a scalar that is shared
+// by all elements (h, a-e) or an array with one value per element (h_vec,
+// a_vec-e_vec). An array is used if its pointer is non-null, otherwise the
+// scalar is broadcast to all elements without forming an array.
+struct FunctionSpecD {
+  enum FUNCTION h;
+  double a, b, c, d, e;
+  const enum FUNCTION *h_vec;
+  const double *a_vec, *b_vec, *c_vec, *d_vec, *e_vec;
+};
+
+struct FunctionSpecS {
+  enum FUNCTION h;
+  float a, b, c, d, e;
+  const enum FUNCTION *h_vec;
+  const float *a_vec, *b_vec, *c_vec, *d_vec, *e_vec;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -79,6 +102,36 @@ int PogsS(enum ORD ord, size_t m, size_t n, const float *A,
           unsigned int verbose, int adaptive_rho, int gap_stop,
           float *x, float *y, float *l, float *optval, unsigned int * final_iter);
 
+int PogsSpecD(enum ORD ord, size_t m, size_t n, const double *A,
+              const struct FunctionSpecD *f, const struct FunctionSpecD *g,
+              double rho, double abs_tol, double rel_tol,
+              unsigned int max_iter, unsigned int verbose, int adaptive_rho,
+              int gap_stop, double *x, double *y, double *l, double *optval,
+              unsigned int *final_iter);
+
+int PogsSpecS(enum ORD ord, size_t m, size_t n, const float *A,
+              const struct FunctionSpecS *f, const struct FunctionSpecS *g,
+              float rho, float abs_tol, float rel_tol,
+              unsigned int max_iter, unsigned int verbose, int adaptive_rho,
+              int gap_stop, float *x, float *y, float *l, float *optval,
+              unsigned int *final_iter);
+
+int PogsSpecInPlaceD(enum ORD ord, size_t m, size_t n, double *A,
+                     const struct FunctionSpecD *f,
+                     const struct FunctionSpecD *g, double rho,
+                     double abs_tol, double rel_tol, unsigned int max_iter,
+                     unsigned int verbose, int adaptive_rho, int gap_stop,
+                     double *x, double *y, double *l, double *optval,
+                     unsigned int *final_iter);
+
+int PogsSpecInPlaceS(enum ORD ord, size_t m, size_t n, float *A,
+                     const struct FunctionSpecS *f,
+                     const struct FunctionSpecS *g, float rho, float abs_tol,
+                     float rel_tol, unsigned int max_iter,
+                     unsigned int verbose, int adaptive_rho, int gap_stop,
+                     float *x, float *y, float *l, float *optval,
+                     unsigned int *final_iter);
+
 // TODO: Add interface for sparse version.
 
 #ifdef __cplusplus
@@ -42,6 +42,10 @@
 %                   speed up conversion.
 %                 + quiet (default false): Set flag to true, to disable
 %                   output to console.
+%                 + in_place (default false): Set flag to true, to
+%                   equilibrate A in place instead of in a copy. As pogs
+%                   may not modify its inputs, A is still copied (once,
+%                   as with in_place false), and is unchanged on return.
 %
 %   Outputs:
 %   x         - The partial solution x^\star to the optimization problem.
@@ -49,13 +49,36 @@ inline T GetVal(const void *pr, size_t idx, mxClassID id) {
   }
 }
 
-// Populates a vector of function objects from a matlab struct
-// containing the fields (f, a, b, c, d). The latter 4 are optional,
-// while f is required. Each field (if present) is a vector of length n.
+// Sets parameter j (0 to 4 for a to e) of f_pogs to x, or to the n values
+// in data if data is non-null.
 template <typename T>
-int PopulateFunctionObj(const char fn_name[], const mxArray *f_mex,
+void SetParam(unsigned int j, T x, const void *data, mxClassID id,
+              unsigned int n, FunctionSoA<T> *f_pogs) {
+  std::vector<T> x_vec;
+  if (data != 0) {
+    x_vec.resize(n);
+    for (unsigned int i = 0; i < n; ++i)
+      x_vec[i] = GetVal<T>(data, i, id);
+  }
+  const T *x_ptr = data != 0 ? x_vec.data() : 0;
+  switch (j) {
+    case 0: if (x_ptr) f_pogs->SetA(x_ptr); else f_pogs->SetA(x); break;
+    case 1: if (x_ptr) f_pogs->SetB(x_ptr); else f_pogs->SetB(x); break;
+    case 2: if (x_ptr) f_pogs->SetC(x_ptr); else f_pogs->SetC(x); break;
+    case 3: if (x_ptr) f_pogs->SetD(x_ptr); else f_pogs->SetD(x); break;
+    case 4: default:
+      if (x_ptr) f_pogs->SetE(x_ptr); else f_pogs->SetE(x); break;
+  }
+}
+
+// Populates the functions f_pogs from a matlab struct containing the fields
+// (h, a, b, c, d, e). The fields a-e are optional, while h is required. Each
+// field (if present) is either a scalar, which is passed on as a scalar, or
+// a vector of length n.
+template <typename T>
+int PopulateFunctionSoA(const char fn_name[], const mxArray *f_mex,
                         unsigned int field_idx, unsigned int n,
-                        std::vector<FunctionObj<T> > *f_pogs) {
+                        FunctionSoA<T> *f_pogs) {
   const unsigned int kNumParam = 6u;
   char alpha[] = "h\0a\0b\0c\0d\0e\0";
 
@@ -109,22 +132,17 @@ int PopulateFunctionObj(const char fn_name[], const mxArray *f_mex,
   }
 
   // Populate f_pogs.
-#pragma omp parellel for
-  for (unsigned int i = 0; i < n; ++i) {
-#pragma unroll
-    for (unsigned int j = 0; j < kNumParam; ++j) {
-      if (param_data[j] != 0) {
-        if (j == 0) {
-          func_param = GetVal<Function>(param_data[j], i, param_id[j]);
-        } else {
-          real_params[j - 1] = GetVal<T>(param_data[j], i, param_id[j]);
-        }
-      }
-    }
-
-    f_pogs->push_back(FunctionObj<T>(func_param, real_params[0], real_params[1],
-        real_params[2], real_params[3], real_params[4]));
+  f_pogs->Resize(n);
+  if (param_data[0] != 0) {
+    std::vector<Function> h(n);
+    for (unsigned int i = 0; i < n; ++i)
+      h[i] = GetVal<Function>(param_data[0], i, param_id[0]);
+    f_pogs->SetH(h.data());
+  } else {
+    f_pogs->SetH(func_param);
   }
+  for (unsigned int j = 1; j < kNumParam; ++j)
+    SetParam(j - 1, real_params[j - 1], param_data[j], param_id[j], n, f_pogs);
   return 0;
 }
 
@@ -209,6 +227,24 @@ int PopulateParams(const mxArray *params, pogs::Pogs<T, M, P> *pogs_data) {
   return 0;
 }
 
+// Returns the storage of A, which is IN_PLACE if params has the field
+// in_place set to true. A MEX function must not modify its inputs, so an
+// IN_PLACE A is a copy of the input (see SolverWrapDn).
+template <typename T>
+typename pogs::MatrixDense<T>::Storage GetStorage(int nrhs,
+                                                  const mxArray *prhs[]) {
+  if (nrhs == 4) {
+    int in_place_idx = mxGetFieldNumber(prhs[3], "in_place");
+    if (in_place_idx != -1) {
+      mxArray *arr = mxGetFieldByNumber(prhs[3], 0, in_place_idx);
+      if (mxGetM(arr) == 1 && mxGetN(arr) == 1 &&
+          GetVal<bool>(mxGetData(arr), 0, mxGetClassID(arr)))
+        return pogs::MatrixDense<T>::IN_PLACE;
+    }
+  }
+  return pogs::MatrixDense<T>::COPY;
+}
+
 template <typename T1, typename T2>
 void IntToInt(size_t n, const T1 *in, T2 *out) {
 #ifdef _OPENMP
@@ -224,14 +260,16 @@ void SolverWrapDn(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   size_t m = mxGetM(prhs[0]);
   size_t n = mxGetN(prhs[0]);
 
-  // Initialize Pogs data structure
-  pogs::MatrixDense<T> A_('c', m, n, reinterpret_cast<T*>(mxGetData(prhs[0])));
+  // Initialize Pogs data structure. With in_place, the solver equilibrates a
+  // copy of the input in place, as the input itself must not be modified.
+  typename pogs::MatrixDense<T>::Storage storage = GetStorage<T>(nrhs, prhs);
+  mxArray *A_copy = storage == pogs::MatrixDense<T>::IN_PLACE ?
+      mxDuplicateArray(prhs[0]) : 0;
+  pogs::MatrixDense<T> A_('c', m, n,
+      reinterpret_cast<T*>(mxGetData(A_copy ? A_copy : prhs[0])), storage);
   pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_);
-  std::vector<FunctionObj<T> > f;
-  std::vector<FunctionObj<T> > g;
-
-  f.reserve(m);
-  g.reserve(n);
+  FunctionSoA<T> f;
+  FunctionSoA<T> g;
 
   int err = 0;
 
@@ -244,12 +282,10 @@ void SolverWrapDn(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   for (unsigned int i = 0; i < num_obj && !err; ++i) {
 
     // Populate function objects.
-    f.clear();
-    g.clear();
-    err = PopulateFunctionObj("f", prhs[1], i, m, &f);
+    err = PopulateFunctionSoA("f", prhs[1], i, m, &f);
     if (err)
       break;
-    err = PopulateFunctionObj("g", prhs[2], i, n, &g);
+    err = PopulateFunctionSoA("g", prhs[2], i, n, &g);
     if (err)
       break;
     
@@ -277,6 +313,9 @@ void SolverWrapDn(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
     if (nlhs >= 6)
       reinterpret_cast<T*>(mxGetData(plhs[5]))[i] = status;
   }
+
+  if (A_copy)
+    mxDestroyArray(A_copy);
 }
 
 template <typename T>
@@ -296,11 +335,8 @@ void SolverWrapSp(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   // Initialize Pogs data structure
   pogs::MatrixSparse<T> A('c', m, n, nnz, val, col_ptr, row_ind);
   pogs::PogsIndirect<T, pogs::MatrixSparse<T> > pogs_data(A);
-  std::vector<FunctionObj<T> > f;
-  std::vector<FunctionObj<T> > g;
-
-  f.reserve(m);
-  g.reserve(n);
+  FunctionSoA<T> f;
+  FunctionSoA<T> g;
 
   int err = 0;
 
@@ -312,12 +348,10 @@ void SolverWrapSp(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
   for (unsigned int i = 0; i < num_obj && !err; ++i) {
     // Populate function objects.
-    f.clear();
-    g.clear();
-    err = PopulateFunctionObj("f", prhs[1], i, m, &f);
+    err = PopulateFunctionSoA("f", prhs[1], i, m, &f);
     if (err)
       break;
-    err = PopulateFunctionObj("g", prhs[2], i, n, &g);
+    err = PopulateFunctionSoA("g", prhs[2], i, n, &g);
     if (err)
       break;
     
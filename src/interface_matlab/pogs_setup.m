@@ -32,7 +32,7 @@ if ~opt_gpu
   unix(sprintf('make cpu -C .. IFLAGS="-D__MEX__ %s"', omp_flag));
   eval(sprintf(['mex -largeArrayDims -I../include ' ...
                 'CFLAGS=''\\$CFLAGS -O3 %s'' ' ...
-                'CXXFLAGS=''\\$CXXFLAGS -std=c++11'' ' ...
+                'CXXFLAGS=''\\$CXXFLAGS -std=c++11 -fopenmp-simd'' ' ...
                 'LDFLAGS=''\\$LDFLAGS %s'' ' ...
                 'pogs_mex.cpp blas2cblas.cpp ../build/pogs.a -lmwblas  ' ...
                 '-output pogs'], omp_flag, omp_flag))
@@ -55,7 +55,7 @@ else
     eval(sprintf(['mex -largeArrayDims -I../include -I../gpu/include ' ...
                   '-D__CUDA__ -output pogs ' ...
                   'LDFLAGS=''\\$LDFLAGS -Wl,-rpath,%s'' ' ...
-                  'CXXFLAGS=''\\$CXXFLAGS -std=c++11'' ' ...
+                  'CXXFLAGS=''\\$CXXFLAGS -std=c++11 -fopenmp-simd'' ' ...
                   'pogs_mex.cpp ../build/pogs.a ' ...
                   '-L%s -lcudart -lcublas -lcusparse'], ...
                  cuda_lib, cuda_lib))
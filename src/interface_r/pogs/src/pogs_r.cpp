@@ -21,51 +21,63 @@ SEXP getListElement(SEXP list, const char *str) {
   return elmt;
 }
 
-void PopulateFunctionObj(SEXP f, unsigned int n,
-                         std::vector<FunctionObj<double> > *f_pogs) {
-  const unsigned int kNumParam = 6u;
-  char alpha[] = "h\0a\0b\0c\0d\0e\0";
-
-  SEXP param_data[kNumParam] = {R_NilValue};
-  #pragma unroll
-  for (unsigned int i = 0; i < kNumParam; ++i)
-    param_data[i] = getListElement(f, &alpha[i * 2]);
-
-  Function func_param;
-  double real_params[] = {1.0, 0.0, 1.0, 0.0, 0.0};
-
-  // Find index and pointer to data of (h, a, b, c, d, e) in struct if present.
-  #pragma unroll
-  for (unsigned int i = 0; i < kNumParam; ++i) {
-    if (param_data[i] != R_NilValue) {
-      // If parameter is scalar, then repeat it.
-      if (length(param_data[i]) == 1) {
-        if (i == 0) {
-          func_param = static_cast<Function>(REAL(param_data[i])[0]);
-        } else {
-          real_params[i - 1] = REAL(param_data[i])[0];
-        }
-        param_data[i] = R_NilValue;
-      }
+// Populates f_pogs from the list f with entries (h, a, b, c, d, e), each of
+// which is either a scalar or a vector of length n. Scalars are passed on as
+// scalars, without forming vectors.
+void PopulateFunctionSoA(SEXP f, unsigned int n,
+                         FunctionSoA<double> *f_pogs) {
+  f_pogs->Resize(n);
+
+  SEXP h = getListElement(f, "h");
+  if (h != R_NilValue) {
+    if (length(h) == 1) {
+      f_pogs->SetH(static_cast<Function>(REAL(h)[0]));
+    } else {
+      std::vector<Function> h_vec(n);
+      for (unsigned int i = 0; i < n; ++i)
+        h_vec[i] = static_cast<Function>(REAL(h)[i]);
+      f_pogs->SetH(h_vec.data());
     }
   }
 
-  // Populate f_pogs.
-  #pragma omp parellel for
-  for (unsigned int i = 0; i < n; ++i) {
-    #pragma unroll
-    for (unsigned int j = 0; j < kNumParam; ++j) {
-      if (param_data[j] != R_NilValue) {
-        if (j == 0) {
-          func_param = static_cast<Function>(REAL(param_data[j])[i]);
-        } else {
-          real_params[j - 1] = REAL(param_data[j])[i];
-        }
-      }
-    }
+  SEXP a = getListElement(f, "a");
+  if (a != R_NilValue) {
+    if (length(a) == 1)
+      f_pogs->SetA(REAL(a)[0]);
+    else
+      f_pogs->SetA(REAL(a));
+  }
+
+  SEXP b = getListElement(f, "b");
+  if (b != R_NilValue) {
+    if (length(b) == 1)
+      f_pogs->SetB(REAL(b)[0]);
+    else
+      f_pogs->SetB(REAL(b));
+  }
 
-    f_pogs->push_back(FunctionObj<double>(func_param, real_params[0],
-         real_params[1], real_params[2], real_params[3], real_params[4]));
+  SEXP c = getListElement(f, "c");
+  if (c != R_NilValue) {
+    if (length(c) == 1)
+      f_pogs->SetC(REAL(c)[0]);
+    else
+      f_pogs->SetC(REAL(c));
+  }
+
+  SEXP d = getListElement(f, "d");
+  if (d != R_NilValue) {
+    if (length(d) == 1)
+      f_pogs->SetD(REAL(d)[0]);
+    else
+      f_pogs->SetD(REAL(d));
+  }
+
+  SEXP e = getListElement(f, "e");
+  if (e != R_NilValue) {
+    if (length(e) == 1)
+      f_pogs->SetE(REAL(e)[0]);
+    else
+      f_pogs->SetE(REAL(e));
   }
 }
 
@@ -111,27 +123,35 @@ void SolverWrap(SEXP A, SEXP fin, SEXP gin, SEXP params, SEXP x, SEXP y,
   size_t n = INTEGER(Adim)[1];
   unsigned int num_obj = length(fin);
 
-  pogs::MatrixDense<T> A_dense('c', m, n, REAL(A));
+  // With in_place = TRUE, A is equilibrated in place rather than in a copy.
+  // R shares A copy-on-write, so an A that another variable may refer to is
+  // duplicated first, and only an A that nothing else refers to (eg. one
+  // created in the call to pogs) is scaled in place.
+  SEXP in_place = getListElement(params, "in_place");
+  typename pogs::MatrixDense<T>::Storage storage = pogs::MatrixDense<T>::COPY;
+  int num_protect = 0;
+  if (in_place != R_NilValue && LOGICAL(in_place)[0]) {
+    storage = pogs::MatrixDense<T>::IN_PLACE;
+    if (MAYBE_SHARED(A)) {
+      PROTECT(A = duplicate(A));
+      ++num_protect;
+    }
+  }
+  pogs::MatrixDense<T> A_dense('c', m, n, REAL(A), storage);
 
   // Initialize Pogs data structure
   pogs::PogsDirect<T, pogs::MatrixDense<T> > pogs_data(A_dense);
-  std::vector<FunctionObj<T> > f, g;
-
-  f.reserve(m);
-  g.reserve(n);
+  FunctionSoA<T> f, g;
 
   // Populate parameters.
   PopulateParams(params, &pogs_data);
 
-  // Allocate space for factors if more than one objective.
-  int err = 0;
-
-  for (unsigned int i = 0; i < num_obj && !err; ++i) {
+  // The objectives are solved one after another, each warm started from the
+  // solution of the previous one.
+  for (unsigned int i = 0; i < num_obj; ++i) {
     // Populate function objects.
-    f.clear();
-    g.clear();
-    PopulateFunctionObj(VECTOR_ELT(fin, i), m, &f);
-    PopulateFunctionObj(VECTOR_ELT(gin, i), n, &g);
+    PopulateFunctionSoA(VECTOR_ELT(fin, i), m, &f);
+    PopulateFunctionSoA(VECTOR_ELT(gin, i), n, &g);
 
     // Run solver.
     INTEGER(status)[i] = pogs_data.Solve(f, g);
@@ -144,6 +164,8 @@ void SolverWrap(SEXP A, SEXP fin, SEXP gin, SEXP params, SEXP x, SEXP y,
 
     REAL(opt)[i] = pogs_data.GetOptval();
   }
+
+  UNPROTECT(num_protect);
 }
 
 extern "C" {